@@ -1,4 +1,5 @@
 #include "macros.hlsli"
+#include "instancing.hlsli"
 
 struct VSOutput
 {
@@ -11,13 +12,12 @@ cbuffer SystemCBuf : REG_SYSTEMCBUF
     float4x4 viewProjection;
 };
 
-cbuffer EntityCBuf : REG_ENTITYCBUF
-{
-    float4x4 transform;
-};
+StructuredBuffer<float4x4> casterInstances : REG_INSTANCES;
 
-VSOutput main(float3 position : POSITION, float2 texCoord : TEXCOORD)
+VSOutput main(float3 position : POSITION, float2 texCoord : TEXCOORD, uint instanceID : SV_InstanceID)
 {
+    float4x4 transform = casterInstances[instanceOffset + instanceID];
+
     VSOutput vso;
     vso.position = mul(float4(position, 1.0f), mul(transform, viewProjection));
     vso.texCoord = texCoord;
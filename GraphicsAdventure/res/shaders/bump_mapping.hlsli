@@ -33,7 +33,7 @@ float2 ParallaxMapping(float sampledDepth, float heightScale, float2 uv, float3
     return uv - p;
 }
 
-float2 SteepParallaxMapping(Texture2D<float> depthMap, SamplerState sam, float depthScale, float2 uv, float3 pixelToViewTS)
+float2 SteepParallaxMapping(Texture2DArray<float> depthMap, uint slice, SamplerState sam, float depthScale, float2 uv, float3 pixelToViewTS)
 {
     const float minLayers = 8.0f;
     const float maxLayers = 32.0f;
@@ -48,20 +48,20 @@ float2 SteepParallaxMapping(Texture2D<float> depthMap, SamplerState sam, float d
     float2 deltaUV = p / (pixelToViewTS.z * numLayers);
     
     float2 curUV = uv;
-    float curDepthMapValue = depthMap.Sample(sam, curUV);
+    float curDepthMapValue = depthMap.Sample(sam, float3(curUV, slice));
 
     [unroll(32)]
     while (curDepthMapValue > curLayerDepth)
     {
         curUV -= deltaUV;
-        curDepthMapValue = depthMap.Sample(sam, curUV);
+        curDepthMapValue = depthMap.Sample(sam, float3(curUV, slice));
         curLayerDepth += layerDepth;
     }
     
     return curUV;
 }
 
-float2 ParallaxOcclusionMapping(Texture2D<float> depthMap, SamplerState sam, float depthScale, float2 uv, float3 pixelToViewTS)
+float2 ParallaxOcclusionMapping(Texture2DArray<float> depthMap, uint slice, SamplerState sam, float depthScale, float2 uv, float3 pixelToViewTS)
 {
     const float minLayers = 8.0f;
     const float maxLayers = 32.0f;
@@ -76,20 +76,20 @@ float2 ParallaxOcclusionMapping(Texture2D<float> depthMap, SamplerState sam, flo
     float2 deltaUV = p / (pixelToViewTS.z * numLayers);;
     
     float2 curUV = uv;
-    float curDepthMapValue = depthMap.Sample(sam, curUV);
+    float curDepthMapValue = depthMap.Sample(sam, float3(curUV, slice));
 
     [unroll(32)]
     while (curDepthMapValue > curLayerDepth)
     {
         curUV -= deltaUV;
-        curDepthMapValue = depthMap.Sample(sam, curUV);
+        curDepthMapValue = depthMap.Sample(sam, float3(curUV, slice));
         curLayerDepth += layerDepth;
     }
     
     float2 prevUV = curUV + deltaUV;
     
     float afterHeight = curLayerDepth - curDepthMapValue;
-    float beforeHeight = curLayerDepth - layerDepth - depthMap.Sample(sam, prevUV);
+    float beforeHeight = curLayerDepth - layerDepth - depthMap.Sample(sam, float3(prevUV, slice));
     
     float weight = afterHeight / (afterHeight - beforeHeight);
     float2 finalUV = lerp(curUV, prevUV, weight);
@@ -1,4 +1,6 @@
 #include "macros.hlsli"
+#include "instancing.hlsli"
+#include "material.hlsli"
 #include "phong.hlsli"
 #include "texturing_manual_filter.hlsli"
 #include "bump_mapping.hlsli"
@@ -14,6 +16,7 @@ struct VSOutput
     float3 pixelWorldSpacePos : PIXEL_WORLD_SPACE_POS;
     float pixelViewSpaceDepth : PIXEL_VIEW_SPACE_POS_DEPTH; // for csm
     float3 viewPos : VIEW_POS;
+    nointerpolation uint instance : INSTANCE;
 };
 
 static const uint s_numCascades = 5;
@@ -32,29 +35,12 @@ cbuffer SystemCBuf : REG_SYSTEMCBUF
     } dirLight;
 };
 
-cbuffer EntityCBuf : REG_ENTITYCBUF
-{
-    struct
-    {
-        float4 color;
-        float2 tiling;
-        float shininess;
-        bool enableNormalMapping;
-        bool enableParallaxMapping;
-        float depthMapScale;
-        int p0;
-        int p1;
-    } mat;
-    
-    bool receiveShadows;
-    float p2;
-    float p3;
-    float p4;
-};
+StructuredBuffer<EntityInstance> entityInstances : REG_INSTANCES;
 
-Texture2D<float4> diffuseMap : register(t0);
-Texture2D<float3> normalMap : register(t1);
-Texture2D<float> depthMap : register(t2);
+// TexturePool arrays, the slices come with the instance
+Texture2DArray<float4> diffuseMap : register(t0);
+Texture2DArray<float3> normalMap : register(t1);
+Texture2DArray<float> depthMap : register(t2);
 SamplerState samplerState : register(s0);
 
 Texture2DArray<float> dirLightShadowMaps : register(t3);
@@ -62,6 +48,9 @@ SamplerState dirLightShadowMapsSampler : register(s1);
 
 float4 main(VSOutput input) : SV_Target
 {
+    EntityInstance instance = entityInstances[input.instance];
+    bool receiveShadows = instance.receiveShadows;
+    
     float3 tangent = normalize(input.tangent);
     float3 bitangent = normalize(input.bitangent);
     float3 normal = normalize(input.normal);
@@ -72,16 +61,16 @@ float4 main(VSOutput input) : SV_Target
     {
         float3x3 tbn = TBNOrthogonalized(tangent, normal);
         if (mat.enableParallaxMapping)
-            uv = ParallaxOcclusionMapping(depthMap, samplerState, mat.depthMapScale, uv, mul(pixelToView, transpose(tbn)));
+            uv = ParallaxOcclusionMapping(depthMap, instance.depthSlice, samplerState, mat.depthMapScale, uv, mul(pixelToView, transpose(tbn)));
         
         if (uv.x > mat.tiling.x || uv.y > mat.tiling.y || uv.x < 0.0 || uv.y < 0.0)
             clip(-1);
         
-        normal = NormalMapping(normalMap.Sample(samplerState, uv), tbn);
+        normal = NormalMapping(normalMap.Sample(samplerState, float3(uv, instance.normalSlice)), tbn);
         //normal = NormalMap(normalMap.Sample(mapSampler, uv).xyz, tangent, bitangent, normal);
     }
     
-    float4 textureMapCol = diffuseMap.Sample(samplerState, uv) * mat.color;
+    float4 textureMapCol = diffuseMap.Sample(samplerState, float3(uv, instance.diffuseSlice)) * mat.color;
     
     clip(textureMapCol.a - EPSILON);
     
@@ -1,4 +1,5 @@
 #include "macros.hlsli"
+#include "instancing.hlsli"
 
 struct VSInput
 {
@@ -19,6 +20,7 @@ struct VSOutput
     float3 pixelWorldSpacePos : PIXEL_WORLD_SPACE_POS;
     float pixelViewSpaceDepth : PIXEL_VIEW_SPACE_POS_DEPTH; // for csm
     float3 viewPos : VIEW_POS;
+    nointerpolation uint instance : INSTANCE;
 };
 
 cbuffer SystemCBuf : REG_SYSTEMCBUF
@@ -29,24 +31,27 @@ cbuffer SystemCBuf : REG_SYSTEMCBUF
     float p0;
 };
 
-cbuffer EntityCBuf : REG_ENTITYCBUF
-{
-    float4x4 transform;
-    float4x4 normalMatrix;
-};
+StructuredBuffer<EntityInstance> entityInstances : REG_INSTANCES;
 
-VSOutput main(VSInput input)
+VSOutput main(VSInput input, uint instanceID : SV_InstanceID)
 {
-    float4 pixelWorldSpacePos = mul(float4(input.position, 1.0f), transform);
+    uint instance = instanceOffset + instanceID;
+    float4x4 transform = entityInstances[instance].transform;
+    float4x4 normalMatrix = entityInstances[instance].normalMatrix;
+
+    // precise, the depth pre-pass computes the same position and the colour pass tests EQUAL against it
+    precise float4 pixelWorldSpacePos = mul(float4(input.position, 1.0f), transform);
+    precise float4 clipPos = mul(pixelWorldSpacePos, viewProjection);
     
     VSOutput vso;
-    vso.position = mul(pixelWorldSpacePos, viewProjection);
+    vso.position = clipPos;
     vso.uv = input.uv;
     vso.tangent = mul(input.tangent, (float3x3) normalMatrix);
     vso.bitangent = mul(input.bitangent, (float3x3) normalMatrix);
     vso.normal = mul(input.normal, (float3x3) normalMatrix);
     vso.pixelWorldSpacePos = pixelWorldSpacePos.xyz;
     vso.viewPos = viewPos;
+    vso.instance = instance;
     vso.pixelViewSpaceDepth = mul(pixelWorldSpacePos, view).z;
     
     return vso;
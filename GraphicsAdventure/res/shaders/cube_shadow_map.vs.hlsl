@@ -1,11 +1,9 @@
 #include "macros.hlsli"
+#include "instancing.hlsli"
 
-cbuffer EntityCBuf : REG_ENTITYCBUF
-{
-    float4x4 transform;
-};
+StructuredBuffer<float4x4> casterInstances : REG_INSTANCES;
 
-float4 main(float3 position : POSITION) : SV_Position
+float4 main(float3 position : POSITION, uint instanceID : SV_InstanceID) : SV_Position
 {
-    return mul(float4(position, 1.0f), transform);
+    return mul(float4(position, 1.0f), casterInstances[instanceOffset + instanceID]);
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#include "macros.hlsli"
+#include "instancing.hlsli"
+
+cbuffer SystemCBuf : REG_SYSTEMCBUF
+{
+    float4x4 viewProjection;
+};
+
+StructuredBuffer<float4x4> prepassInstances : REG_INSTANCES;
+
+// position only. the colour pass tests EQUAL against this depth, so the math has to match phong.vs and csm_test.vs exactly
+float4 main(float3 position : POSITION, uint instanceID : SV_InstanceID) : SV_Position
+{
+    float4x4 transform = prepassInstances[instanceOffset + instanceID];
+
+    precise float4 pixelWorldSpacePos = mul(float4(position, 1.0f), transform);
+    precise float4 clipPos = mul(pixelWorldSpacePos, viewProjection);
+    return clipPos;
+}
@@ -0,0 +1,18 @@
+#include "macros.hlsli"
+
+// SV_InstanceID restarts at 0 for every draw, instanceOffset is where the instances of the draw start in the instance buffer
+cbuffer InstanceCBuf : REG_INSTANCECBUF
+{
+    uint instanceOffset;
+    uint3 pInstance;
+};
+
+struct EntityInstance
+{
+    float4x4 transform;
+    float4x4 normalMatrix;
+    bool receiveShadows;
+    uint diffuseSlice;
+    uint normalSlice;
+    uint depthSlice;
+};
@@ -1,6 +1,9 @@
 
 #define REG_SYSTEMCBUF register(b0)
 #define REG_ENTITYCBUF register(b1)
+#define REG_INSTANCECBUF register(b2)
+#define REG_MATERIALCBUF register(b3)
+#define REG_INSTANCES register(t6)
 
 #define PI 3.1416
 #define EPSILON 0.0001
\ No newline at end of file
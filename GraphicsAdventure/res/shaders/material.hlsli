@@ -0,0 +1,19 @@
+#include "macros.hlsli"
+
+struct Material
+{
+    float4 color;
+    float2 tiling;
+    float shininess;
+    bool enableNormalMapping;
+    bool enableParallaxMapping;
+    float depthMapScale;
+    int p0;
+    int p1;
+};
+
+// one buffer per unique material, written when the material is interned
+cbuffer MaterialCBuf : REG_MATERIALCBUF
+{
+    Material mat;
+};
@@ -0,0 +1,62 @@
+// Fused final pass without ops. the post_process_*.ps.hlsl variants define the ops they run and include this file,
+// PostProcessChain picks the compiled variant
+
+#ifndef COMPOSITE
+#define COMPOSITE 0
+#endif
+
+#ifndef GAMMA
+#define GAMMA 0
+#endif
+
+#define EPSILON 0.0001
+
+cbuffer SystemCBuf : register(b0)
+{
+    float gamma;
+    float2 uvScale; // rendered size / scene target size
+    float p0;
+};
+
+Texture2D tex : register(t0);
+SamplerState samplerState : register(s0);
+
+#if COMPOSITE
+Texture2D accumulationMap : register(t1);
+Texture2D revealMap : register(t2);
+#endif
+
+float4 main(float2 texCoord : TEXCOORD) : SV_Target
+{
+    // the target is bigger than what was rendered, keep the bilinear footprint inside the rendered corner
+    float2 size;
+    tex.GetDimensions(size.x, size.y);
+    float2 uv = min(texCoord * uvScale, uvScale - 0.5f / size);
+
+    float4 color = tex.Sample(samplerState, uv);
+
+#if COMPOSITE
+    // weighted blended oit resolve with the over operator, the targets have the scene's size and scale
+    float revealage = revealMap.Sample(samplerState, uv).x;
+    if (1.0f - revealage > EPSILON)
+    {
+        float4 accumulation = accumulationMap.Sample(samplerState, uv);
+
+        // suppress overflow
+        float3 magnitude = abs(accumulation.rgb);
+        if (isinf(max(max(magnitude.x, magnitude.y), magnitude.z)))
+            accumulation.rgb = accumulation.aaa;
+
+        float3 averageCol = accumulation.rgb / max(accumulation.a, EPSILON);
+        float alpha = 1.0f - revealage;
+        color = float4(averageCol * alpha + color.rgb * (1.0f - alpha), alpha + color.a * (1.0f - alpha));
+    }
+#endif
+
+#if GAMMA
+    // only when the output view isn't _SRGB
+    color.rgb = pow(color.rgb, 1.0f / gamma);
+#endif
+
+    return color;
+}
@@ -0,0 +1,4 @@
+// post_process.ps.hlsl with oit composite
+#define COMPOSITE 1
+#define GAMMA 0
+#include "post_process.ps.hlsl"
@@ -0,0 +1,4 @@
+// post_process.ps.hlsl with oit composite and gamma
+#define COMPOSITE 1
+#define GAMMA 1
+#include "post_process.ps.hlsl"
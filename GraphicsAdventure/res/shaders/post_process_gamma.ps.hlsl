@@ -0,0 +1,4 @@
+// post_process.ps.hlsl with gamma
+#define COMPOSITE 0
+#define GAMMA 1
+#include "post_process.ps.hlsl"
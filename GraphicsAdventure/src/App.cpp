@@ -13,6 +13,8 @@ using namespace GDX11;
 using namespace Microsoft::WRL;
 using namespace DirectX;
 
+#define CAPTURE_FILE "frame.gacap"
+
 namespace GA
 {
 	App::App()
@@ -28,6 +30,7 @@ namespace GA
 		}
 
 		m_context = std::make_unique<GDX11Context>();
+		m_sharedResources = std::make_unique<GA::Utils::SharedResourceCache>(m_context.get());
 
 		SetSwapChain();
 		SetBuffers();
@@ -40,7 +43,7 @@ namespace GA
 		vp.Height = (float)m_window->GetDesc().height;
 		vp.MinDepth = 0.0f;
 		vp.MaxDepth = 1.0f;
-		m_context->GetDeviceContext()->RSSetViewports(1, &vp);
+		m_context->GetStateCache().SetViewport(vp);
 
 		m_imguiManager.Set(m_window.get(), m_context.get());
 
@@ -55,8 +58,9 @@ namespace GA
 		m_camController.Set(&m_camera, XMFLOAT3(0.0f, 0.0f, 0.0f), 8.0f, 0.8f, 5.0f, 15.0f);
 
 		m_scene = std::make_unique<Scene>();
-		//m_lambertianRenderGraph = std::make_unique<LambertianRenderGraph>(m_scene.get(), m_context.get(), &m_camera, m_window->GetDesc().width, m_window->GetDesc().height);
-		m_csmTestRenderGraph = std::make_unique<CSMTestRenderGraph>(m_scene.get(), m_context.get(), &m_camera, m_window->GetDesc().width, m_window->GetDesc().height);
+		//m_lambertianRenderGraph = std::make_unique<LambertianRenderGraph>(m_scene.get(), m_context.get(), m_sharedResources.get(), &m_camera, m_window->GetDesc().width, m_window->GetDesc().height);
+		m_csmTestRenderGraph = std::make_unique<CSMTestRenderGraph>(m_scene.get(), m_context.get(), m_sharedResources.get(), &m_camera, m_window->GetDesc().width, m_window->GetDesc().height);
+		m_gpuTimer = std::make_unique<GpuFrameTimer>(m_context.get());
 
 		for (int z = -1; z <= 1; z++)
 		{
@@ -82,13 +86,16 @@ namespace GA
 					e.AddComponent<TransformComponent>(XMFLOAT3(x * 1.5f, y * 1.5f, z * 1.5f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
 
 					auto& mesh = e.AddComponent<MeshComponent>();
-					mesh.vb = m_resLib.Get<Buffer>("cube.vb");
-					mesh.ib = m_resLib.Get<Buffer>("cube.ib");
+					mesh.vb = m_geometryPool->GetVB(m_cubeMesh->arena);
+					mesh.ib = m_geometryPool->GetIB(m_cubeMesh->arena);
+					mesh.geometry = m_cubeMesh;
 					mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 					mesh.receiveShadows = true;
 					mesh.castShadows = true;
+					e.AddComponent<StaticTag>();
 
-					auto& mat = e.AddComponent<MaterialComponent>();
+					// filled before it's added, the scene tags the entity opaque or transparent on construction
+					MaterialComponent mat = {};
 					mat.color = color;
 					mat.tiling = { 1.0f, 1.0f };
 					mat.shininess = 150.0f;
@@ -97,6 +104,7 @@ namespace GA
 					mat.depthMap = nullptr;
 					mat.samplerState = m_resLib.Get<SamplerState>("anisotropic_wrap");
 					mat.depthMapScale = 0.1f;
+					e.AddComponent<MaterialComponent>(mat);
 				}
 			}
 		}
@@ -106,13 +114,15 @@ namespace GA
 			e.AddComponent<TransformComponent>(XMFLOAT3(0.0f, -2.5f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(20.0f, 1.0f, 20.0f));
 
 			auto& mesh = e.AddComponent<MeshComponent>();
-			mesh.vb = m_resLib.Get<Buffer>("plane.vb");
-			mesh.ib = m_resLib.Get<Buffer>("plane.ib");
+			mesh.vb = m_geometryPool->GetVB(m_planeMesh->arena);
+			mesh.ib = m_geometryPool->GetIB(m_planeMesh->arena);
+			mesh.geometry = m_planeMesh;
 			mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 			mesh.receiveShadows = true;
 			mesh.castShadows = true;
+			e.AddComponent<StaticTag>();
 
-			auto& mat = e.AddComponent<MaterialComponent>();
+			MaterialComponent mat = {};
 			mat.color = { 1.0f, 1.0f, 1.0f, 1.0f };
 			mat.tiling = { 10.0f, 10.0f };
 			mat.shininess = 150.0f;
@@ -121,6 +131,7 @@ namespace GA
 			mat.depthMap = nullptr;
 			mat.samplerState = m_resLib.Get<SamplerState>("anisotropic_wrap");
 			mat.depthMapScale = 0.1f;
+			e.AddComponent<MaterialComponent>(mat);
 		}
 
 		{
@@ -222,6 +233,9 @@ namespace GA
 		//	mat.samplerState = m_resLib.Get<SamplerState>("anisotropic_wrap");
 		//	mat.depthMapScale = 0.1f;
 		//}
+
+		m_staticBatcher = std::make_unique<StaticBatcher>(m_scene.get(), m_context.get(), m_geometryPool.get());
+		m_staticBatcher->Build("res/static_batches.bake");
 	}
 
 	void App::Run()
@@ -257,69 +271,159 @@ namespace GA
 
 	void App::OnUpdate()
 	{
+		// a dragged window edge sends a burst of resize events, only the last one of the frame is applied
+		if (m_pendingResize.pending)
+		{
+			m_pendingResize.pending = false;
+			m_camera.SetAspect((float)m_pendingResize.width / m_pendingResize.height);
+
+			//m_lambertianRenderGraph->ResizeViews(m_pendingResize.width, m_pendingResize.height);
+			m_csmTestRenderGraph->ResizeViews(m_pendingResize.width, m_pendingResize.height);
+		}
+
 		m_camController.ProcessInput(m_window.get(), m_time.GetDeltaTime());
+
+		// only arenas that meshes streamed out of badly get moved
+		m_geometryPool->Compact();
 	}
 
 	void App::OnRender()
 	{
+		m_context->GetStateCache().ResetStats();
+		m_context->ResetSubmissionStats();
+
+		// results are a few frames old, a scale change shows up in them late. the controller's cooldown covers that
+		if (m_gpuTimer->GetNewResult(m_gpuMs))
+			m_csmTestRenderGraph->SetResolutionScale(m_dynamicResolution.Update(m_gpuMs));
+
+		// the timer's queries stay out of the capture
+		m_gpuTimer->Begin();
+		if (m_capture.requested)
+			m_context->BeginCapture();
+
 		//m_lambertianRenderGraph->Execute();
 		m_csmTestRenderGraph->Execute();
+
+		if (m_capture.requested)
+		{
+			m_capture.written = m_context->EndCapture(CAPTURE_FILE);
+			m_capture.requested = false;
+			m_capture.done = true;
+		}
+		m_gpuTimer->End();
 	}
 
 	void App::OnImGuiRender()
 	{
 		m_imguiManager.Begin();
 		ImGui::DragFloat3("Light position", &pointLightPos->x, 0.1f);
+
+		const auto& bindStats = m_context->GetStateCache().GetStats();
+		ImGui::Text("Context binds issued: %u, skipped: %u", bindStats.issued, bindStats.skipped);
+		const auto& submissionStats = m_context->GetSubmissionStats();
+		ImGui::Text("Draws: %u, instances: %llu, maps: %u, %llu bytes", submissionStats.draws, (unsigned long long)submissionStats.instances,
+			submissionStats.maps, (unsigned long long)submissionStats.mapBytes);
+		ImGui::Text("Updates: %u, %llu bytes", submissionStats.updates, (unsigned long long)submissionStats.updateBytes);
+		ImGui::Text("Pipeline states: %zu", GDX11::PipelineState::GetCacheSize());
+		const auto& sharedStats = m_sharedResources->GetStats();
+		ImGui::Text("Shared resources: %u, hits: %u, misses: %u", sharedStats.objects, sharedStats.hits, sharedStats.misses);
+
+		if (ImGui::CollapsingHeader("Geometry pool"))
+		{
+			auto stats = m_geometryPool->GetStats();
+			ImGui::Text("Arenas: %u, allocations: %u, compactions: %u", stats.arenas, stats.allocations, stats.compactions);
+			ImGui::Text("Vertices used: %u, free: %u", stats.usedVertices, stats.freeVertices);
+			ImGui::Text("Indices used: %u, free: %u", stats.usedIndices, stats.freeIndices);
+			ImGui::Text("Fragmentation: %.2f", stats.fragmentation);
+		}
+
+		if (ImGui::CollapsingHeader("Static batching"))
+		{
+			const auto& stats = m_staticBatcher->GetStats();
+			ImGui::Text("%u meshes merged into %u chunks, %u buffers", stats.sourceMeshes, stats.chunks, stats.buffers);
+			ImGui::Text("Vertices: %u, indices: %u", stats.vertices, stats.indices);
+			ImGui::Text("%s in %.3f ms", stats.fromBake ? "Loaded from bake" : "Merged", stats.ms);
+		}
+
+		if (ImGui::CollapsingHeader("Dynamic resolution"))
+		{
+			bool enabled = m_dynamicResolution.IsEnabled();
+			if (ImGui::Checkbox("Enabled", &enabled))
+			{
+				m_dynamicResolution.SetEnabled(enabled);
+				m_csmTestRenderGraph->SetResolutionScale(m_dynamicResolution.GetScale());
+			}
+
+			auto desc = m_dynamicResolution.GetDesc();
+			bool changed = ImGui::SliderFloat("Target ms", &desc.targetMs, 2.0f, 33.0f);
+			changed |= ImGui::SliderFloat("Min scale", &desc.minScale, 0.25f, 1.0f);
+			if (changed)
+				m_dynamicResolution.SetDesc(desc);
+
+			const auto& stats = m_dynamicResolution.GetStats();
+			ImGui::Text("Gpu: %.2f ms, average: %.2f ms", m_gpuMs, stats.frameMs);
+			ImGui::Text("Scale: %.3f, %ux%u, %u changes", m_csmTestRenderGraph->GetResolutionScale(),
+				m_csmTestRenderGraph->GetRenderWidth(), m_csmTestRenderGraph->GetRenderHeight(), stats.changes);
+		}
+
+		if (ImGui::CollapsingHeader("Depth pre-pass"))
+		{
+			auto& prepass = m_csmTestRenderGraph->GetDepthPrepass();
+			int mode = (int)prepass.GetMode();
+			if (ImGui::Combo("Mode", &mode, "Auto\0On\0Off\0"))
+				prepass.SetMode((DepthPrepass::Mode)mode);
+
+			const auto& stats = prepass.GetStats();
+			ImGui::Text("Overdraw: %.2f", stats.overdraw);
+			ImGui::Text("%s, draws: %u, batches: %u", stats.probing ? "Probing" : (stats.active ? "Active" : "Inactive"), stats.draws, stats.batches);
+		}
+
+		if (ImGui::CollapsingHeader("Draw list"))
+		{
+			const auto& stats = m_csmTestRenderGraph->GetDrawList().GetStats();
+			ImGui::Text("Draws: %u, instanced batches: %u, culled: %u", stats.draws, stats.batches, stats.culled);
+			ImGui::Text("Sort: %.3f ms, %s, %u radix passes, %u skipped", stats.sortMs, stats.alreadySorted ? "already sorted" : "unsorted", stats.radixPasses, stats.skippedPasses);
+
+			const auto& ring = m_csmTestRenderGraph->GetConstantRingStats();
+			ImGui::Text("Constant ring: %u allocations, %u bytes, %u maps, %u wraps, %u grows", ring.allocations, ring.bytes, ring.maps, ring.wraps, ring.grows);
+
+			const auto& materials = m_csmTestRenderGraph->GetMaterialStats();
+			ImGui::Text("Materials: %u, created: %u, released: %u", materials.materials, materials.created, materials.released);
+
+			const auto textures = m_csmTestRenderGraph->GetTextureStats();
+			ImGui::Text("Texture arrays: %u, %u textures in %u slices, %u grows", textures.arrays, textures.textures, textures.slices, textures.grows);
+
+			const auto& frameGraph = m_csmTestRenderGraph->GetFrameGraph().GetStats();
+			ImGui::Text("Frame graph: %u passes, %u culled, %u compiles", frameGraph.passes, frameGraph.culled, frameGraph.compiles);
+			ImGui::Text("Transients: %u in %u textures, %.1f MB instead of %.1f MB", frameGraph.transients, frameGraph.physical,
+				frameGraph.physicalBytes / (1024.0f * 1024.0f), frameGraph.transientBytes / (1024.0f * 1024.0f));
+		}
+
+		if (ImGui::CollapsingHeader("Frame capture"))
+		{
+			if (ImGui::Button("Capture frame"))
+				m_capture.requested = true;
+
+			if (m_capture.done)
+				ImGui::Text(m_capture.written ? "Written to " CAPTURE_FILE : "Couldn't write " CAPTURE_FILE);
+		}
 		m_imguiManager.End();
 	}
 
 	void App::SetBuffers()
 	{
+		m_geometryPool = std::make_unique<GA::Utils::GeometryPool>(m_context.get(), (uint32_t)sizeof(GA::Utils::Vertex));
+
 		{
 			auto vert = GA::Utils::CreateCubeVerticesEx();
 			auto ind = GA::Utils::CreateCubeIndicesEx();
-
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = (uint32_t)vert.size() * sizeof(GA::Utils::Vertex);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(GA::Utils::Vertex);
-			m_resLib.Add("cube.vb", Buffer::Create(m_context.get(), desc, vert.data()));
-
-			desc = {};
-			desc.ByteWidth = (uint32_t)ind.size() * sizeof(uint32_t);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(uint32_t);
-			m_resLib.Add("cube.ib", Buffer::Create(m_context.get(), desc, ind.data()));
+			m_cubeMesh = m_geometryPool->Allocate(vert.data(), (uint32_t)vert.size(), ind.data(), (uint32_t)ind.size());
 		}
 
-
 		{
 			auto vert = GA::Utils::CreatePlaneVerticesEx();
 			auto ind = GA::Utils::CreatePlaneIndicesEx();
-
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = (uint32_t)vert.size() * sizeof(GA::Utils::Vertex);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(GA::Utils::Vertex);
-			m_resLib.Add("plane.vb", Buffer::Create(m_context.get(), desc, vert.data()));
-
-			desc = {};
-			desc.ByteWidth = (uint32_t)ind.size() * sizeof(uint32_t);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(uint32_t);
-			m_resLib.Add("plane.ib", Buffer::Create(m_context.get(), desc, ind.data()));
+			m_planeMesh = m_geometryPool->Allocate(vert.data(), (uint32_t)vert.size(), ind.data(), (uint32_t)ind.size());
 		}
 	}
 
@@ -339,7 +443,7 @@ namespace GA
 				desc.BorderColor[i] = 0.0f;
 			desc.MinLOD = 0.0f;
 			desc.MaxLOD = D3D11_FLOAT32_MAX;
-			m_resLib.Add("anisotropic_wrap", SamplerState::Create(m_context.get(), desc));
+			m_resLib.Add("anisotropic_wrap", m_sharedResources->GetSamplerState(desc));
 		}
 
 		{
@@ -356,7 +460,7 @@ namespace GA
 				desc.BorderColor[i] = 0.0f;
 			desc.MinLOD = 0.0f;
 			desc.MaxLOD = D3D11_FLOAT32_MAX;
-			m_resLib.Add("anisotropic_clamp", SamplerState::Create(m_context.get(), desc));
+			m_resLib.Add("anisotropic_clamp", m_sharedResources->GetSamplerState(desc));
 		}
 
 		{
@@ -525,10 +629,9 @@ namespace GA
 	{
 		if (event.GetWidth() == 0 || event.GetHeight() == 0) return false;
 
-		m_camera.SetAspect((float)m_window->GetDesc().width / m_window->GetDesc().height);
-
-		//m_lambertianRenderGraph->ResizeViews(event.GetWidth(), event.GetHeight());
-		m_csmTestRenderGraph->ResizeViews(event.GetWidth(), event.GetHeight());
+		m_pendingResize.width = event.GetWidth();
+		m_pendingResize.height = event.GetHeight();
+		m_pendingResize.pending = true;
 		return false;
 	}
 }
\ No newline at end of file
@@ -4,12 +4,17 @@
 #include <GDX11.h>
 #include "ImGui/ImGuiManager.h"
 #include "Utils/ResourceLibrary.h"
+#include "Utils/SharedResourceCache.h"
+#include "Utils/GeometryPool.h"
 #include "Scene/Camera.h"
 #include "Utils/EditorCameraController.h"
 #include "Core/Time.h"
 #include "Scene/Scene.h"
+#include "Scene/StaticBatcher.h"
 #include "RenderGraph/LambertianRenderGraph.h"
 #include "RenderGraph/CSMTestRenderGraph.h"
+#include "RenderGraph/GpuFrameTimer.h"
+#include "RenderGraph/DynamicResolution.h"
 
 namespace GA
 {
@@ -38,15 +43,44 @@ namespace GA
 		std::unique_ptr<GDX11::GDX11Context> m_context;
 
 		ImGuiManager m_imguiManager;
+		// immutable gpu objects every render graph pulls from, outlives them
+		std::unique_ptr<Utils::SharedResourceCache> m_sharedResources;
 		Utils::ResourceLibrary m_resLib;
 
+		// meshes of the GA::Utils::Vertex format. declared before the scene, its components free into the pool
+		std::unique_ptr<Utils::GeometryPool> m_geometryPool;
+		std::shared_ptr<Utils::GeometryAllocation> m_cubeMesh;
+		std::shared_ptr<Utils::GeometryAllocation> m_planeMesh;
+
 		Camera m_camera;
 		GA::Utils::EditorCameraController m_camController;
 
 		std::unique_ptr<Scene> m_scene;
+		std::unique_ptr<StaticBatcher> m_staticBatcher;
 		//std::unique_ptr<LambertianRenderGraph> m_lambertianRenderGraph;
 		std::unique_ptr<CSMTestRenderGraph> m_csmTestRenderGraph;
 
+		// gpu time of the render graph drives the scale it renders at
+		std::unique_ptr<GpuFrameTimer> m_gpuTimer;
+		DynamicResolution m_dynamicResolution;
+		float m_gpuMs = 0.0f;
+
+		// the next frame's submissions are written to a file for GraphicsAdventure --replay
+		struct
+		{
+			bool requested = false;
+			bool done = false;
+			bool written = false;
+		} m_capture;
+
+		// applied once at the start of the next frame
+		struct
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			bool pending = false;
+		} m_pendingResize;
+
 		// temp
 		DirectX::XMFLOAT3* pointLightPos;
 	};
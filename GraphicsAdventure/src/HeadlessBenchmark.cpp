@@ -0,0 +1,192 @@
+#include "HeadlessBenchmark.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Core/Time.h"
+#include "Utils/BasicMesh.h"
+#include "Scene/Entity.h"
+#include "Scene/Components.h"
+
+using namespace GDX11;
+using namespace DirectX;
+
+namespace GA
+{
+	HeadlessBenchmark::HeadlessBenchmark(const Desc& desc)
+		: m_desc(desc)
+	{
+		m_context = std::make_unique<GDX11Context>(m_desc.backend);
+		m_sharedResources = std::make_unique<Utils::SharedResourceCache>(m_context.get());
+		m_geometryPool = std::make_unique<Utils::GeometryPool>(m_context.get(), (uint32_t)sizeof(Utils::Vertex));
+
+		{
+			auto vert = Utils::CreateCubeVerticesEx();
+			auto ind = Utils::CreateCubeIndicesEx();
+			m_cubeMesh = m_geometryPool->Allocate(vert.data(), (uint32_t)vert.size(), ind.data(), (uint32_t)ind.size());
+		}
+
+		CameraDesc camDesc = {};
+		camDesc.fov = 60.0f;
+		camDesc.aspect = (float)m_desc.width / m_desc.height;
+		camDesc.nearZ = 0.1f;
+		camDesc.farZ = 500.0f;
+		camDesc.position = { 0.0f, 0.0f, 0.0f };
+		camDesc.rotation = { 0.0f, 0.0f, 0.0f };
+		m_camera.Set(camDesc);
+
+		m_scene = std::make_unique<Scene>();
+		if (m_desc.graph == Graph::Lambertian)
+			m_lambertianRenderGraph = std::make_unique<LambertianRenderGraph>(m_scene.get(), m_context.get(), m_sharedResources.get(), &m_camera, m_desc.width, m_desc.height);
+		else
+			m_csmTestRenderGraph = std::make_unique<CSMTestRenderGraph>(m_scene.get(), m_context.get(), m_sharedResources.get(), &m_camera, m_desc.width, m_desc.height);
+
+		CreateScene();
+	}
+
+	HeadlessBenchmark::Result HeadlessBenchmark::Run()
+	{
+		Result result = {};
+		result.minMs = FLT_MAX;
+
+		// the grid is about this far across, the camera circles just outside it
+		float radius = 1.5f * std::cbrt((float)m_desc.entities) + 5.0f;
+
+		Timer timer;
+		for (uint32_t frame = 0; frame < m_desc.warmupFrames + m_desc.frames; frame++)
+		{
+			float angle = frame * 0.01f;
+			m_camera.SetPosition({ radius * std::sin(angle), radius * 0.3f, -radius * std::cos(angle) });
+			m_camera.SetRotation({ 15.0f, -XMConvertToDegrees(angle), 0.0f });
+
+			m_context->ResetSubmissionStats();
+			m_context->GetStateCache().ResetStats();
+
+			timer.Mark();
+			Execute();
+			float ms = timer.Mark() * 1000.0f;
+
+			// nothing presents, the queued commands would pile up
+			m_context->GetDeviceContext()->Flush();
+
+			if (frame < m_desc.warmupFrames) continue;
+
+			const auto& submission = m_context->GetSubmissionStats();
+			const auto& binds = m_context->GetStateCache().GetStats();
+			result.averageMs += ms;
+			result.minMs = std::min(result.minMs, ms);
+			result.maxMs = std::max(result.maxMs, ms);
+			result.draws += submission.draws;
+			result.instances += submission.instances;
+			result.maps += submission.maps;
+			result.mapBytes += submission.mapBytes;
+			result.updates += submission.updates;
+			result.updateBytes += submission.updateBytes;
+			result.bindsIssued += binds.issued;
+			result.bindsSkipped += binds.skipped;
+
+			const auto& sort = GetDrawList().GetStats();
+			result.sortedDraws += sort.draws;
+			result.batches += sort.batches;
+			result.sortMs += sort.sortMs;
+			result.radixPasses += sort.radixPasses;
+			result.skippedPasses += sort.skippedPasses;
+			result.alreadySorted += sort.alreadySorted ? 1.0f : 0.0f;
+		}
+
+		float frames = (float)std::max(m_desc.frames, 1u);
+		result.averageMs /= frames;
+		result.draws /= frames;
+		result.instances /= frames;
+		result.maps /= frames;
+		result.mapBytes /= frames;
+		result.updates /= frames;
+		result.updateBytes /= frames;
+		result.bindsIssued /= frames;
+		result.bindsSkipped /= frames;
+		result.sortedDraws /= frames;
+		result.batches /= frames;
+		result.sortMs /= frames;
+		result.radixPasses /= frames;
+		result.skippedPasses /= frames;
+		result.alreadySorted /= frames;
+		return result;
+	}
+
+	void HeadlessBenchmark::Execute()
+	{
+		if (m_lambertianRenderGraph)
+			m_lambertianRenderGraph->Execute();
+		else
+			m_csmTestRenderGraph->Execute();
+	}
+
+	const DrawList& HeadlessBenchmark::GetDrawList() const
+	{
+		// the benchmark has one view, the last view's list is the only one
+		return m_lambertianRenderGraph ? m_lambertianRenderGraph->GetSolidDrawList() : m_csmTestRenderGraph->GetDrawList();
+	}
+
+	void HeadlessBenchmark::CreateScene()
+	{
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = 1;
+		texDesc.Height = 1;
+		texDesc.MipLevels = 1;
+		texDesc.ArraySize = 1;
+		texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = 0;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = 1;
+
+		uint32_t col = 0xffffffff;
+		auto white = ShaderResourceView::Create(m_context.get(), srvDesc, Texture2D::Create(m_context.get(), texDesc, &col));
+		auto sampler = m_sharedResources->GetSamplerState(CD3D11_SAMPLER_DESC(CD3D11_DEFAULT()));
+
+		uint32_t side = std::max((uint32_t)std::ceil(std::cbrt((float)m_desc.entities)), 1u);
+		float offset = (side - 1) * 0.75f;
+		for (uint32_t i = 0; i < m_desc.entities; i++)
+		{
+			uint32_t x = i % side;
+			uint32_t y = (i / side) % side;
+			uint32_t z = i / (side * side);
+
+			auto e = m_scene->CreateEntity();
+			e.AddComponent<TransformComponent>(XMFLOAT3(x * 1.5f - offset, y * 1.5f - offset, z * 1.5f - offset), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+			auto& mesh = e.AddComponent<MeshComponent>();
+			mesh.vb = m_geometryPool->GetVB(m_cubeMesh->arena);
+			mesh.ib = m_geometryPool->GetIB(m_cubeMesh->arena);
+			mesh.geometry = m_cubeMesh;
+			mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			mesh.receiveShadows = true;
+			mesh.castShadows = true;
+
+			// a few colours so the draw list has more than one material to sort
+			MaterialComponent mat = {};
+			mat.color = { (i % 4) / 3.0f, 1.0f, 1.0f, 1.0f };
+			mat.tiling = { 1.0f, 1.0f };
+			mat.shininess = 150.0f;
+			mat.diffuseMap = white;
+			mat.samplerState = sampler;
+			mat.depthMapScale = 0.1f;
+			e.AddComponent<MaterialComponent>(mat);
+		}
+
+		auto e = m_scene->CreateEntity();
+		e.AddComponent<TransformComponent>(XMFLOAT3(0.0f, 10.0f, -10.0f), XMFLOAT3(50.0f, -30.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+		auto& dirLight = e.AddComponent<DirectionalLightComponent>();
+		dirLight.color = { 1.0f, 1.0f, 1.0f };
+		dirLight.ambientIntensity = 0.2f;
+		dirLight.intensity = 1.0f;
+	}
+}
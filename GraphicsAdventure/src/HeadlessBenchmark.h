@@ -0,0 +1,78 @@
+#pragma once
+#include <GDX11.h>
+#include "Utils/SharedResourceCache.h"
+#include "Utils/GeometryPool.h"
+#include "Scene/Camera.h"
+#include "Scene/Scene.h"
+#include "RenderGraph/CSMTestRenderGraph.h"
+#include "RenderGraph/LambertianRenderGraph.h"
+
+namespace GA
+{
+	// Runs a render graph without a window or a gpu and measures the cpu cost of Execute(), on the counting backend
+	// or the d3d11 null driver (see GDX11Context::Backend). the scene is a grid of cubes orbited by the camera, so scene
+	// sizes the editor never reaches can be measured
+	class HeadlessBenchmark
+	{
+	public:
+		enum class Graph
+		{
+			CSMTest = 0,
+			Lambertian
+		};
+
+		struct Desc
+		{
+			Graph graph;
+			GDX11::GDX11Context::Backend backend; // Counting or NullDriver
+			uint32_t entities;
+			uint32_t frames;
+			uint32_t warmupFrames;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		// per measured frame
+		struct Result
+		{
+			float averageMs;
+			float minMs;
+			float maxMs;
+			float draws;
+			float instances;
+			float maps;
+			float mapBytes;
+			float updates;
+			float updateBytes;
+			float bindsIssued;
+			float bindsSkipped;
+			// of the main draw list
+			float sortedDraws;
+			float batches;
+			float sortMs;
+			float radixPasses;
+			float skippedPasses;
+			float alreadySorted; // fraction of frames the sort found nothing to do
+		};
+
+		HeadlessBenchmark(const Desc& desc);
+
+		Result Run();
+
+	private:
+		void CreateScene();
+		void Execute();
+		const DrawList& GetDrawList() const;
+
+		Desc m_desc;
+		std::unique_ptr<GDX11::GDX11Context> m_context;
+		std::unique_ptr<Utils::SharedResourceCache> m_sharedResources;
+		std::unique_ptr<Utils::GeometryPool> m_geometryPool;
+		std::shared_ptr<Utils::GeometryAllocation> m_cubeMesh;
+		Camera m_camera;
+		std::unique_ptr<Scene> m_scene;
+		// one of them, by Desc::graph
+		std::unique_ptr<CSMTestRenderGraph> m_csmTestRenderGraph;
+		std::unique_ptr<LambertianRenderGraph> m_lambertianRenderGraph;
+	};
+}
@@ -14,6 +14,7 @@ namespace GA
 	void ImGuiManager::Set(const GDX11::Window* window, const GDX11::GDX11Context* context)
 	{
 		m_window = window;
+		m_context = context;
 
 		// Setup ImGui Context
 		IMGUI_CHECKVERSION();
@@ -66,5 +67,8 @@ namespace GA
 			ImGui::UpdatePlatformWindows();
 			ImGui::RenderPlatformWindowsDefault();
 		}
+
+		// the dx11 backend binds its own state (and other windows' render targets) behind the state cache
+		m_context->GetStateCache().Invalidate();
 	}
 }
\ No newline at end of file
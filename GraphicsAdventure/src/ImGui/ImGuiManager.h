@@ -17,5 +17,6 @@ namespace GA
 
 	private:
 		const GDX11::Window* m_window;
+		const GDX11::GDX11Context* m_context;
 	};
 }
\ No newline at end of file
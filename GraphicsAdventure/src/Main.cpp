@@ -1,7 +1,127 @@
 #include "App.h"
+#include "HeadlessBenchmark.h"
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <vector>
 
-int main()
+// GraphicsAdventure --headless [entities] [frames] [--lambertian] [--null-driver]
+// renders without a window or a gpu and prints the cpu cost of a frame. runs the CSM test graph unless --lambertian is given.
+// submission goes to the counting backend, which validates and counts the calls without the d3d runtime. resources are
+// still created through d3d on WARP, so this runs on Windows only. --null-driver submits to the d3d11 null driver instead
+// to include the runtime's cost, that needs the Windows "Graphics Tools" optional feature (d3d11ref.dll)
+// --headless 100000 is the draw sorting benchmark: sort cost of the main draw list at 100k draws next to the
+// binds the StateCache issued and skipped thanks to the order
+static int RunHeadless(int argc, char** argv)
 {
+	GA::HeadlessBenchmark::Desc desc = {};
+	desc.graph = GA::HeadlessBenchmark::Graph::CSMTest;
+	desc.backend = GDX11::GDX11Context::Backend::Counting;
+
+	std::vector<const char*> counts;
+	for (int i = 2; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--lambertian") == 0)
+			desc.graph = GA::HeadlessBenchmark::Graph::Lambertian;
+		else if (std::strcmp(argv[i], "--null-driver") == 0)
+			desc.backend = GDX11::GDX11Context::Backend::NullDriver;
+		else
+			counts.push_back(argv[i]);
+	}
+
+	desc.entities = counts.size() > 0 ? (uint32_t)std::strtoul(counts[0], nullptr, 10) : 10000;
+	desc.frames = counts.size() > 1 ? (uint32_t)std::strtoul(counts[1], nullptr, 10) : 200;
+	desc.warmupFrames = 10;
+	desc.width = 1280;
+	desc.height = 720;
+
+	try
+	{
+		auto result = GA::HeadlessBenchmark(desc).Run();
+		std::cout << (desc.graph == GA::HeadlessBenchmark::Graph::Lambertian ? "Lambertian" : "CSM test") << " graph, "
+			<< desc.entities << " entities, " << desc.frames << " frames on the "
+			<< (desc.backend == GDX11::GDX11Context::Backend::NullDriver ? "null driver" : "counting backend") << "\n"
+			<< "Execute: " << result.averageMs << " ms average, " << result.minMs << " min, " << result.maxMs << " max\n"
+			<< "Draws: " << result.draws << ", instances: " << result.instances << "\n"
+			<< "Maps: " << result.maps << ", " << result.mapBytes << " bytes\n"
+			<< "Updates: " << result.updates << ", " << result.updateBytes << " bytes\n"
+			<< "Binds issued: " << result.bindsIssued << ", skipped: " << result.bindsSkipped << "\n"
+			<< "Draw list: " << result.sortedDraws << " draws, " << result.batches << " batches\n"
+			<< "Sort: " << result.sortMs << " ms, " << result.radixPasses << " radix passes, " << result.skippedPasses << " skipped, "
+			<< result.alreadySorted * 100.0f << "% of frames already sorted\n";
+	}
+	catch (const GDX11::GDX11Exception& e)
+	{
+		std::cerr << e.GetType() << "\n" << e.what() << "\n";
+		return 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+// GraphicsAdventure --replay file [iterations] [--null]
+// re-executes a frame written by the editor's frame capture and prints the cpu cost of every pass
+static int RunReplay(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "--replay needs a capture file\n";
+		return 1;
+	}
+
+	uint32_t iterations = 100;
+	auto backend = GDX11::GDX11Context::Backend::Hardware;
+	for (int i = 3; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--null") == 0)
+			backend = GDX11::GDX11Context::Backend::NullDriver;
+		else
+			iterations = (uint32_t)std::strtoul(argv[i], nullptr, 10);
+	}
+
+	try
+	{
+		GDX11::GDX11Context context(backend);
+		GDX11::FrameReplay replay(&context, argv[2]);
+		replay.Run(iterations);
+
+		std::cout << replay.GetObjectCount() << " objects, " << replay.GetCommandCount() << " commands, "
+			<< iterations << " iterations on the " << (backend == GDX11::GDX11Context::Backend::NullDriver ? "null driver" : "hardware") << " device\n";
+		for (const auto& pass : replay.GetPassStats())
+		{
+			if (pass.commands == 0) continue;
+			std::cout << std::left << std::setw(32) << pass.name << std::right << std::setw(10) << std::fixed << std::setprecision(4) << pass.ms << " ms"
+				<< std::setw(8) << pass.commands << " commands" << std::setw(6) << pass.draws << " draws\n";
+		}
+		std::cout << std::left << std::setw(32) << "Frame" << std::right << std::setw(10) << replay.GetFrameMs() << " ms\n";
+	}
+	catch (const GDX11::GDX11Exception& e)
+	{
+		std::cerr << e.GetType() << "\n" << e.what() << "\n";
+		return 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--headless") == 0)
+		return RunHeadless(argc, argv);
+	if (argc > 1 && std::strcmp(argv[1], "--replay") == 0)
+		return RunReplay(argc, argv);
+
 	try
 	{
 		GA::App().Run();
@@ -20,4 +140,4 @@ int main()
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 #include "Scene/Components.h"
 #include "entt/entt.hpp"
 #include "Utils/Macros.h"
+#include "RenderGraph/ShaderBindingIds.h"
+#include <algorithm>
 
 using namespace GDX11;
 using namespace DirectX;
@@ -10,20 +12,17 @@ using namespace Microsoft::WRL;
 // ------------ keys -------------
 
 #define RTV_MAIN                            "main"
-#define RTV_SCENE                           "scene"
-#define SRV_SCENE                           "scene"
-#define DSV_SCENE                           "scene"
+#define RTV_MAIN_SRGB                       "main_srgb"
 
-#define VS_FS_OUT_TC_POS                    "fullscreen_out_tc_pos"
-#define IL_FS_OUT_TC_POS                    "fullscreen_out_tc_pos"
 #define VS_DIRLIGHT_CSM                     "dirlight_csm"
 #define IL_DIRLIGHT_CSM                     "dirlight_csm"
 #define GS_DIRLIGHT_CSM                     "dirlight_csm"
 #define VS_CSM_TEST                         "csm_test"
+#define VS_DEPTH_PREPASS                    "depth_prepass"
+#define IL_DEPTH_PREPASS                    "depth_prepass"
 #define IL_CSM_TEST                         "csm_test"
 #define PS_CSM_TEST                         "csm_test"
 
-#define PS_GAMMA_CORRECTION                 "gamma_correction"
 #define PS_NULLPTR                          "null"
 #define GS_NULLPTR                          "null"
 
@@ -31,27 +30,28 @@ using namespace Microsoft::WRL;
 
 #define RS_CULL_NONE                        "cull_none"
 #define RS_DEPTH_SLOPE_SCALED_BIAS          "depth_slope_scaled_bias"
-#define SS_POINT_CLAMP                      "point_clamp"
+#define DSS_DEPTH_WRITE_ZERO_OP_EQUAL       "depth_write_zero_op_equal"
 #define SS_LINEAR_CLAMP                     "linear_clamp"
 
-#define VB_FS_QUAD                          "fs_quad.vb"
-#define IB_FS_QUAD                          "fs_quad.ib"
+#define PSO_DIRLIGHT_CSM                    "dirlight_csm"
+#define PSO_CSM_TEST                        "csm_test"
+#define PSO_CSM_TEST_EQUAL                  "csm_test_equal"
+#define PSO_DEPTH_PREPASS                   "depth_prepass"
 
-#define CB_PS_GAMMA_CORRECTION_SYSTEM       "gamma_correction.ps.SystemCBuf"
+#define DSV_DIRLIGHT_STATIC_SHADOW_MAP      "dirLight_static_shadow_map"
 
-#define DSV_DIRLIGHT_SHADOW_MAP             "dirLight_shadow_map"
-#define SRV_DIRLIGHT_SHADOW_MAP             "dirLight_shadow_map"
-#define RTV_DIRLIGHT_SHADOW_MAP             "dirLight_shadow_map"
-#define RTV_SRV_DIRLIGHT_SHADOW_MAP         "rtv_dirLight_shadow_map"
-
-#define CB_VS_DIRLIGHT_CSM_ENTITY           "dirlight_csm.vs.EntityCBuf"
 #define CB_GS_DIRLIGHT_CSM_SYSTEM           "dirlight_csm.gs.SystemCBuf"
 #define CB_VS_CSM_TEST_SYSTEM               "csm_test.vs.SystemCBuf"
-#define CB_VS_CSM_TEST_ENTITY               "csm_test.vs.EntityCBuf"
 #define CB_PS_CSM_TEST_SYSTEM               "csm_test.ps.SystemCBuf"
-#define CB_PS_CSM_TEST_ENTITY               "csm_test.ps.EntityCBuf"
+#define CR_INSTANCE                         "instance.ring"
 
 #define SHADOWMAP_SIZE 1024
+#define CONSTANT_RING_SIZE (1 << 20)
+
+#define DRAW_PASS_CSM_TEST                  0
+#define DRAW_PASS_STATIC_CASTERS            1
+#define DRAW_PASS_DYNAMIC_CASTERS           2
+#define DRAW_PASS_DEPTH_PREPASS             3
 
 #define GAMMA 2.2
 
@@ -156,36 +156,103 @@ namespace GA
 	};
 
 
-	CSMTestRenderGraph::CSMTestRenderGraph(Scene* scene, GDX11::GDX11Context* context, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight)
-		: System(scene), m_context(context), m_camera(camera)
+	CSMTestRenderGraph::CSMTestRenderGraph(Scene* scene, GDX11::GDX11Context* context, GA::Utils::SharedResourceCache* shared, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight)
+		: System(scene), m_context(context), m_shared(shared), m_camera(camera), m_frameGraph(context), m_postProcess(context, shared), m_resolutionScale(1.0f), m_renderWidth(0), m_renderHeight(0), m_textures(context), m_materials(context, &m_textures), m_entityInstances(context), m_depthPrepass(context), m_casterInstances(context), m_staticShadowCache(), m_staticCasterVersion(0)
 	{
 		m_renderable.connect(GetRegistry(), entt::collector.group<TransformComponent, MeshComponent, MaterialComponent>(entt::exclude<>));
+		m_opaque.connect(GetRegistry(), entt::collector.group<TransformComponent, MeshComponent, MaterialComponent, OpaqueTag>(entt::exclude<>));
 		m_dirLight.connect(GetRegistry(), entt::collector.group<TransformComponent, DirectionalLightComponent>(entt::exclude<>));
 
 		ResizeViews(windowWidth, windowHeight);
 		SetShaders();
 		SetStates();
+		SetPipelineStates();
 		SetBuffers();
 		SetLightDepthBuffers();
 	}
 
 	void CSMTestRenderGraph::Execute()
 	{
-		ShadowPass();
-		RenderPass();
-		GammaCorrectionPass();
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		ring->ResetStats();
+		ring->BeginFrame();
+
+		// materials interned last frame and not since go away, so do the ids of meshes no draw asked for
+		m_materials.Sweep();
+		m_meshIds.Sweep();
+
+		m_frameGraph.Reset();
+
+		// gamma is left to the hardware when the back buffer has an _SRGB view
+		bool srgb = m_resLib.Exist<RenderTargetView>(RTV_MAIN_SRGB);
+		FrameGraph::ImportedViews backbufferViews = {};
+		backbufferViews.rtv = m_resLib.Get<RenderTargetView>(srgb ? RTV_MAIN_SRGB : RTV_MAIN);
+		FrameResource backbuffer = m_frameGraph.Import("main", backbufferViews);
+
+		FrameResource shadowMap, scene, depth;
+
+		// cascades start from the static cache every frame, the working map doesn't have to outlive the frame
+		m_frameGraph.AddPass("dirlight_csm",
+			[&](FrameGraphBuilder& builder)
+			{
+				shadowMap = builder.Create("dirLight_shadow_map",
+					{ SHADOWMAP_SIZE, SHADOWMAP_SIZE, (uint32_t)GA::Utils::s_numCascades, DXGI_FORMAT_R32_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE });
+				builder.Write(shadowMap);
+			},
+			[&](const FrameGraph& graph) { ShadowPass(graph.GetDSV(shadowMap)); });
+
+		m_frameGraph.AddPass("csm_test",
+			[&](FrameGraphBuilder& builder)
+			{
+				scene = builder.Create("scene", { m_windowWidth, m_windowHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE });
+				depth = builder.Create("scene_depth", { m_windowWidth, m_windowHeight, 1, DXGI_FORMAT_D32_FLOAT, D3D11_BIND_DEPTH_STENCIL });
+				builder.Read(shadowMap);
+				builder.Write(scene);
+				builder.Write(depth);
+			},
+			[&](const FrameGraph& graph) { RenderPass(graph.GetRTV(scene), graph.GetDSV(depth), graph.GetSRV(shadowMap)); });
+
+		m_frameGraph.AddPass("post_process",
+			[&](FrameGraphBuilder& builder)
+			{
+				builder.Read(scene);
+				builder.Write(backbuffer);
+			},
+			[&](const FrameGraph& graph)
+			{
+				D3D11_VIEWPORT vp = {};
+				vp.TopLeftX = 0.0f;
+				vp.TopLeftY = 0.0f;
+				vp.Width = (float)m_windowWidth;
+				vp.Height = (float)m_windowHeight;
+				vp.MinDepth = 0.0f;
+				vp.MaxDepth = 1.0f;
+
+				// the scene target is allocated in a size class, only the rendered corner holds the frame
+				const auto& desc = graph.GetDesc(scene);
+				m_postProcess.Draw(srgb ? 0 : PostProcessChain::Gamma, { graph.GetSRV(scene) }, graph.GetRTV(backbuffer), vp,
+					{ (float)m_renderWidth / desc.width, (float)m_renderHeight / desc.height }, GAMMA);
+			});
+
+		m_frameGraph.Run();
+
+		// imgui draws into the back buffer next and writes encoded colours
+		m_resLib.Get<RenderTargetView>(RTV_MAIN)->Bind(nullptr);
 	}
 
-	void CSMTestRenderGraph::ShadowPass()
+	const ConstantRing::Stats& CSMTestRenderGraph::GetConstantRingStats() const
 	{
-		auto dsv = m_resLib.Get<DepthStencilView>(DSV_DIRLIGHT_SHADOW_MAP);
-		dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
-		auto rtv = m_resLib.Get<RenderTargetView>(RTV_DIRLIGHT_SHADOW_MAP);
-		rtv->Clear(0.0f, 0.0f, 0.0f, 0.0f);
+		return m_resLib.Get<ConstantRing>(CR_INSTANCE)->GetStats();
+	}
+
+	void CSMTestRenderGraph::ShadowPass(const std::shared_ptr<DepthStencilView>& dsv)
+	{
+		if (m_dirLight.empty() || m_renderable.empty())
+			dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
 
 		if (m_dirLight.empty()) return;
 
-		rtv->Bind(dsv.get());
+		UpdateShadowCasters();
 
 		D3D11_VIEWPORT vp = {};
 		vp.TopLeftX = 0.0f;
@@ -194,11 +261,7 @@ namespace GA
 		vp.Height = (float)SHADOWMAP_SIZE;
 		vp.MinDepth = 0.0f;
 		vp.MaxDepth = 1.0f;
-		m_context->GetDeviceContext()->RSSetViewports(1, &vp);
-
-		m_resLib.Get<RasterizerState>(RS_DEPTH_SLOPE_SCALED_BIAS)->Bind();
-		m_resLib.Get<BlendState>(S_DEFAULT)->Bind(nullptr, 0xff);
-		m_resLib.Get<DepthStencilState>(S_DEFAULT)->Bind(0xff);
+		m_context->GetStateCache().SetViewport(vp);
 
 		GA::Utils::CSMTestPSSystemCBuf psSysCbuf = {};
 		for each (const auto& e in m_dirLight)
@@ -223,326 +286,387 @@ namespace GA
 
 			if (m_renderable.empty()) continue;
 
-			auto vs = m_resLib.Get<VertexShader>(VS_DIRLIGHT_CSM);
-			auto gs = m_resLib.Get<GeometryShader>(GS_DIRLIGHT_CSM);
-			vs->Bind();
-			gs->Bind();
-			m_resLib.Get<PixelShader>(PS_NULLPTR)->Bind();
-			m_resLib.Get<InputLayout>(IL_DIRLIGHT_CSM)->Bind();
+			auto pso = m_resLib.Get<PipelineState>(PSO_DIRLIGHT_CSM);
+			pso->Bind();
+			const auto& vs = pso->GetDesc().vs;
+			const auto& gs = pso->GetDesc().gs;
 
 			{
 				auto cbuf = m_resLib.Get<Buffer>(CB_GS_DIRLIGHT_CSM_SYSTEM);
 				cbuf->SetData(psSysCbuf.dirLight.lightSpaces);
-				cbuf->GSBindAsCBuf(gs->GetResBinding("SystemCBuf"));
+				cbuf->GSBindAsCBuf(gs->GetBindings().Get(Binding::SystemCBuf));
 			}
 
-			// draw to depth map
-			for (const auto& e : m_renderable)
+			// cascades follow the camera, so the static cache only survives while the camera and light stand still
+			auto staticDsv = m_resLib.Get<DepthStencilView>(DSV_DIRLIGHT_STATIC_SHADOW_MAP);
+			if (!m_staticShadowCache.valid || m_staticShadowCache.version != m_staticCasterVersion ||
+				memcmp(m_staticShadowCache.lightSpaces.data(), ls.data(), sizeof(ls)) != 0)
 			{
-				const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(e);
+				staticDsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+				staticDsv->Bind();
+				DrawShadowCasters(vs, true);
 
-				if (!mesh.castShadows) continue;
-
-				{
-					XMFLOAT4X4 fTransform;
-					XMStoreFloat4x4(&fTransform, XMMatrixTranspose(transform.GetTransform()));
-					auto cbuf = m_resLib.Get<Buffer>(CB_VS_DIRLIGHT_CSM_ENTITY);
-					cbuf->SetData(&fTransform);
-					cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-				}
+				m_staticShadowCache.lightSpaces = ls;
+				m_staticShadowCache.version = m_staticCasterVersion;
+				m_staticShadowCache.valid = true;
+			}
 
-				mesh.vb->BindAsVB();
-				mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-				m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
+			m_context->GetStateCache().SetRenderTargets(0, nullptr, nullptr);
+			m_context->CopyResource(dsv->GetTexture2D()->GetNative(), staticDsv->GetTexture2D()->GetNative());
 
-				GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
-			}
+			// draw dynamic casters to depth map
+			dsv->Bind();
+			DrawShadowCasters(vs, false);
 		}
 
-		m_resLib.Get<GeometryShader>(GS_NULLPTR)->Bind();
 		m_resLib.Get<Buffer>(CB_PS_CSM_TEST_SYSTEM)->SetData(&psSysCbuf);
 	}
 
-	void CSMTestRenderGraph::RenderPass()
+	void CSMTestRenderGraph::UpdateShadowCasters()
+	{
+		m_casterDrawList.Clear();
+
+		bool changed = false;
+		for (const auto& e : m_renderable)
+		{
+			const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(e);
+
+			if (!mesh.castShadows) continue;
+
+			bool isStatic = GetRegistry().all_of<StaticTag>(e);
+			uint32_t pass = isStatic ? DRAW_PASS_STATIC_CASTERS : DRAW_PASS_DYNAMIC_CASTERS;
+			m_casterDrawList.Add(DrawKey::Make(pass, 0, 0, m_meshIds.Get(mesh.vb.get(), mesh.ib.get(), mesh.geometry.get()), 0), e);
+
+			if (isStatic)
+				changed |= m_staticCasterTransforms.Update(e, transform);
+		}
+
+		m_staticCasterTransforms.Sweep([&](entt::entity, const TransformComponent&) { changed = true; });
+
+		if (changed)
+			++m_staticCasterVersion;
+
+		m_casterDrawList.Sort();
+		m_casterDrawList.Batch(GetRegistry(), true);
+
+		m_casterInstances.Clear();
+		for (const auto& item : m_casterDrawList.GetItems())
+		{
+			XMFLOAT4X4 transform;
+			XMStoreFloat4x4(&transform, XMMatrixTranspose(GetRegistry().get<TransformComponent>(item.entity).GetTransform()));
+			m_casterInstances.Push(transform);
+		}
+
+		m_casterInstances.Upload();
+
+		// instance offsets of every caster batch, shared by all the shadow maps drawn this frame
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		m_casterAllocations.clear();
+		for (const auto& batch : m_casterDrawList.GetBatches())
+		{
+			GA::Utils::InstanceCBuf cbufData = {};
+			cbufData.instanceOffset = batch.first;
+			m_casterAllocations.push_back(ring->Allocate(cbufData));
+		}
+		ring->Flush();
+	}
+
+	void CSMTestRenderGraph::DrawShadowCasters(const std::shared_ptr<VertexShader>& vs, bool staticCasters)
+	{
+		m_casterInstances.VSBind(vs->GetBindings().Get(Binding::casterInstances));
+
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		uint32_t instanceSlot = vs->GetBindings().Get(Binding::InstanceCBuf);
+
+		const auto& items = m_casterDrawList.GetItems();
+		const auto& batches = m_casterDrawList.GetBatches();
+		uint32_t pass = staticCasters ? DRAW_PASS_STATIC_CASTERS : DRAW_PASS_DYNAMIC_CASTERS;
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			const auto& batch = batches[i];
+			if (DrawKey::GetPass(items[batch.first].key) != pass) continue;
+
+			const auto& mesh = GetRegistry().get<MeshComponent>(batch.entity);
+			mesh.vb->BindAsVB();
+			mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
+			m_context->GetStateCache().SetPrimitiveTopology(mesh.topology);
+			ring->VSBind(m_casterAllocations[i], instanceSlot);
+
+			m_context->DrawIndexedInstanced(mesh.GetIndexCount(), batch.count, mesh.GetStartIndex(), mesh.GetBaseVertex(), 0);
+		}
+	}
+
+	void CSMTestRenderGraph::RenderPass(const std::shared_ptr<RenderTargetView>& rtv, const std::shared_ptr<DepthStencilView>& dsv, const std::shared_ptr<ShaderResourceView>& shadowMaps)
 	{
-		auto rtv = m_resLib.Get<RenderTargetView>(RTV_SCENE);
-		auto dsv = m_resLib.Get<DepthStencilView>(DSV_SCENE);
 		rtv->Clear(0.0f, 0.0f, 0.0f, 0.0f);
 		dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
 
-		if (m_renderable.empty()) return;
+		if (m_opaque.empty()) return;
 
 		D3D11_VIEWPORT vp = {};
 		vp.TopLeftX = 0.0f;
 		vp.TopLeftY = 0.0f;
-		vp.Width = (float)m_windowWidth;
-		vp.Height = (float)m_windowHeight;
+		vp.Width = (float)m_renderWidth;
+		vp.Height = (float)m_renderHeight;
 		vp.MinDepth = 0.0f;
 		vp.MaxDepth = 1.0f;
-		m_context->GetDeviceContext()->RSSetViewports(1, &vp);
-
-		m_resLib.Get<RasterizerState>(S_DEFAULT)->Bind();
-		m_resLib.Get<BlendState>(S_DEFAULT)->Bind(nullptr, 0xff);
-		m_resLib.Get<DepthStencilState>(S_DEFAULT)->Bind(0xff);
+		m_context->GetStateCache().SetViewport(vp);
 
 		rtv->Bind(dsv.get());
 
-		auto vs = m_resLib.Get<VertexShader>(VS_CSM_TEST);
-		auto ps = m_resLib.Get<PixelShader>(PS_CSM_TEST);
-		vs->Bind();
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_CSM_TEST)->Bind();
+		BuildDrawList(m_drawList, DRAW_PASS_CSM_TEST);
 
-		// system cbufs
+		GA::Utils::CSMTestVSSystemCBuf vsCbufData = {};
+		vsCbufData.viewPos = m_camera->GetDesc().position;
+		XMStoreFloat4x4(&vsCbufData.viewProjection, XMMatrixTranspose(m_camera->GetViewMatrix() * m_camera->GetProjectionMatrix()));
+		XMStoreFloat4x4(&vsCbufData.view, XMMatrixTranspose(m_camera->GetViewMatrix()));
+		auto vsCbuf = m_resLib.Get<Buffer>(CB_VS_CSM_TEST_SYSTEM);
+		vsCbuf->SetData(&vsCbufData);
+
+		// depth first, front to back. the colour pass then only shades the visible surface
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		m_depthPrepass.Begin();
+		bool prepass = m_depthPrepass.IsActive();
+		if (prepass)
 		{
-			m_resLib.Get<Buffer>(CB_PS_CSM_TEST_SYSTEM)->PSBindAsCBuf(ps->GetResBinding("SystemCBuf"));
-
-			GA::Utils::CSMTestVSSystemCBuf cbufData = {};
-			cbufData.viewPos = m_camera->GetDesc().position;
-			XMFLOAT4X4 viewProj;
-			XMFLOAT4X4 view;
-			XMStoreFloat4x4(&viewProj, XMMatrixTranspose(m_camera->GetViewMatrix() * m_camera->GetProjectionMatrix()));
-			XMStoreFloat4x4(&view, XMMatrixTranspose(m_camera->GetViewMatrix()));
-			cbufData.viewProjection = viewProj;
-			cbufData.view = view;
-
-			auto cbuf = m_resLib.Get<Buffer>(CB_VS_CSM_TEST_SYSTEM);
-			cbuf->SetData(&cbufData);
-			cbuf->VSBindAsCBuf(vs->GetResBinding("SystemCBuf"));
-		}
+			m_depthPrepass.Build(GetRegistry(), m_drawList, DRAW_PASS_DEPTH_PREPASS, ring.get());
 
-		m_resLib.Get<ShaderResourceView>(SRV_DIRLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("dirLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("dirLightShadowMapsSampler"));
+			auto pso = m_resLib.Get<PipelineState>(PSO_DEPTH_PREPASS);
+			pso->Bind();
+			const auto& vs = pso->GetDesc().vs;
 
-		for (const auto& e : m_renderable)
-		{
-			const auto& [transform, mesh, mat] = GetRegistry().get<TransformComponent, MeshComponent, MaterialComponent>(e);
+			// viewProjection leads the csm test cbuf as well
+			vsCbuf->VSBindAsCBuf(vs->GetBindings().Get(Binding::SystemCBuf));
+			m_depthPrepass.Draw(GetRegistry(), vs, ring.get());
+		}
 
-			if (mat.color.w < (1.0f - GA_UTILS_EPSILONF))
-				continue;
+		auto pso = m_resLib.Get<PipelineState>(prepass ? PSO_CSM_TEST_EQUAL : PSO_CSM_TEST);
+		pso->Bind();
+		const auto& vs = pso->GetDesc().vs;
+		const auto& ps = pso->GetDesc().ps;
 
-			mesh.vb->BindAsVB();
-			mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
+		// system cbufs
+		m_resLib.Get<Buffer>(CB_PS_CSM_TEST_SYSTEM)->PSBindAsCBuf(ps->GetBindings().Get(Binding::SystemCBuf));
+		vsCbuf->VSBindAsCBuf(vs->GetBindings().Get(Binding::SystemCBuf));
 
-			mat.diffuseMap->PSBind(ps->GetResBinding("diffuseMap"));
-			mat.samplerState->PSBind(ps->GetResBinding("samplerState"));
+		shadowMaps->PSBind(ps->GetBindings().Get(Binding::dirLightShadowMaps));
+		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetBindings().Get(Binding::dirLightShadowMapsSampler));
 
-			if (mat.normalMap)
-			{
-				mat.normalMap->PSBind(ps->GetResBinding("normalMap"));
-				if (mat.depthMap)
-					mat.depthMap->PSBind(ps->GetResBinding("depthMap"));
-			}
+		m_entityInstances.Clear();
+		for (const auto& item : m_drawList.GetItems())
+		{
+			const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(item.entity);
 
 			XMMATRIX xmTransform = transform.GetTransform();
-			XMFLOAT4X4 fTransform;
-			XMFLOAT4X4 normalMatrix;
-			XMStoreFloat4x4(&fTransform, XMMatrixTranspose(xmTransform));
-			XMStoreFloat4x4(&normalMatrix, XMMatrixInverse(nullptr, xmTransform));
 
-			// set cbufs
-			{
-				GA::Utils::CSMTestVSEntityCBuf cbufData = {};
-				cbufData.transform = fTransform;
-				cbufData.normalMatrix = normalMatrix;
+			GA::Utils::EntityInstance instance = {};
+			XMStoreFloat4x4(&instance.transform, XMMatrixTranspose(xmTransform));
+			XMStoreFloat4x4(&instance.normalMatrix, XMMatrixInverse(nullptr, xmTransform));
+			instance.receiveShadows = mesh.receiveShadows;
+			instance.diffuseSlice = item.slices.diffuse;
+			instance.normalSlice = item.slices.normal;
+			instance.depthSlice = item.slices.depth;
+			m_entityInstances.Push(instance);
+		}
 
-				auto cbuf = m_resLib.Get<Buffer>(CB_VS_CSM_TEST_ENTITY);
-				cbuf->SetData(&cbufData);
-				cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-			}
+		m_entityInstances.Upload();
+		m_entityInstances.VSBind(vs->GetBindings().Get(Binding::entityInstances));
+		m_entityInstances.PSBind(ps->GetBindings().Get(Binding::entityInstances));
 
+		// every batch's instance offset goes up with one map before the draws
+		const auto& batches = m_drawList.GetBatches();
+		m_batchAllocations.clear();
+		for (const auto& batch : batches)
+		{
+			GA::Utils::InstanceCBuf cbufData = {};
+			cbufData.instanceOffset = batch.first;
+			m_batchAllocations.push_back(ring->Allocate(cbufData));
+		}
+		ring->Flush();
+
+		uint32_t instanceSlot = vs->GetBindings().Get(Binding::InstanceCBuf);
+		bool uncovered = false;
+		m_depthPrepass.BeginMeasure();
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			const auto& batch = batches[i];
+			const auto& mesh = GetRegistry().get<MeshComponent>(batch.entity);
+
+			// variants sort last, once past the pre-pass draws the rest keeps the regular depth test
+			if (prepass && !uncovered && !DepthPrepass::Covers(m_drawList.GetItems()[batch.first].key))
 			{
-				GA::Utils::CSMTestPSEntityCBuf cbufData = {};
-				cbufData.mat.color = mat.color;
-				cbufData.mat.tiling = mat.tiling;
-				cbufData.mat.shininess = mat.shininess;
-				cbufData.mat.enableNormalMapping = mat.normalMap ? TRUE : FALSE;
-				cbufData.mat.enableParallaxMapping = mat.normalMap && mat.depthMap ? TRUE : FALSE;
-				cbufData.mat.depthMapScale = mat.depthMapScale;
-				cbufData.receiveShadows = mesh.receiveShadows;
-
-				auto cbuf = m_resLib.Get<Buffer>(CB_PS_CSM_TEST_ENTITY);
-				cbuf->PSBindAsCBuf(ps->GetResBinding("EntityCBuf"));
-				cbuf->SetData(&cbufData);
+				m_resLib.Get<PipelineState>(PSO_CSM_TEST)->Bind();
+				uncovered = true;
 			}
 
-			m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
-			GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+			BindDrawResources(m_context, mesh, m_materials.Get(m_drawList.GetItems()[batch.first].material), ps.get());
+			ring->VSBind(m_batchAllocations[i], instanceSlot);
+
+			m_context->DrawIndexedInstanced(mesh.GetIndexCount(), batch.count, mesh.GetStartIndex(), mesh.GetBaseVertex(), 0);
 		}
+		m_depthPrepass.EndMeasure(m_renderWidth * m_renderHeight);
 	}
 
-	void CSMTestRenderGraph::GammaCorrectionPass()
+	void CSMTestRenderGraph::BuildDrawList(DrawList& list, uint32_t pass)
 	{
-		m_resLib.Get<RasterizerState>(S_DEFAULT)->Bind();
+		list.Clear();
 
-		auto rtv = m_resLib.Get<RenderTargetView>(RTV_MAIN);
-		rtv->Clear(0.0f, 0.0f, 0.0f, 0.0f);
-		rtv->Bind(nullptr);
-
-		m_resLib.Get<VertexShader>(VS_FS_OUT_TC_POS)->Bind();
-		auto ps = m_resLib.Get<PixelShader>(PS_GAMMA_CORRECTION);
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_FS_OUT_TC_POS)->Bind();
-
-		m_resLib.Get<ShaderResourceView>(SRV_SCENE)->PSBind(ps->GetResBinding("tex"));
-		m_resLib.Get<SamplerState>(SS_POINT_CLAMP)->PSBind(ps->GetResBinding("samplerState"));
-
-		DirectX::XMFLOAT4 gamma = { GAMMA, 0.0f, 0.0f, 0.0f };
-		auto cbuf = m_resLib.Get<Buffer>(CB_PS_GAMMA_CORRECTION_SYSTEM);
-		cbuf->SetData(&gamma);
-		cbuf->PSBindAsCBuf(ps->GetResBinding("SystemCBuf"));
-
-		m_resLib.Get<Buffer>(VB_FS_QUAD)->BindAsVB();
-		auto ib = m_resLib.Get<Buffer>(IB_FS_QUAD);
-		ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-		m_context->GetDeviceContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+		XMMATRIX xmView = m_camera->GetViewMatrix();
+		float nearZ = m_camera->GetDesc().nearZ;
+		float farZ = m_camera->GetDesc().farZ;
+		BoundingFrustum frustum = m_camera->GetFrustum();
+
+		for (const auto& e : m_opaque)
+		{
+			const auto& [transform, mesh, mat] = GetRegistry().get<TransformComponent, MeshComponent, MaterialComponent>(e);
+
+			// merged static chunks sit at the origin, their bounds say where they are
+			XMFLOAT3 center = transform.position;
+			if (const auto* bounds = GetRegistry().try_get<BoundsComponent>(e))
+			{
+				if (!frustum.Intersects(bounds->box))
+				{
+					list.Cull();
+					continue;
+				}
+				center = bounds->box.Center;
+			}
+
+			uint32_t variant = mat.normalMap ? (mat.depthMap ? 2 : 1) : 0;
+			MaterialSlices slices;
+			uint32_t material = m_materials.Intern(mat, slices);
+			uint32_t meshId = m_meshIds.Get(mesh.vb.get(), mesh.ib.get(), mesh.geometry.get());
+
+			// front to back for early z
+			float viewDepth = XMVectorGetZ(XMVector3Transform(XMLoadFloat3(&center), xmView));
+			uint32_t depth = DrawKey::QuantizeDepth(viewDepth, nearZ, farZ);
+
+			list.Add(DrawKey::Make(pass, variant, material, meshId, depth), e, material, slices);
+		}
+
+		list.Sort();
+		list.Batch(GetRegistry(), false);
 	}
 
 	void CSMTestRenderGraph::ResizeViews(uint32_t width, uint32_t height)
 	{
+		// the swap chain already has that size
+		if (m_resLib.Exist<RenderTargetView>(RTV_MAIN) && width == m_windowWidth && height == m_windowHeight)
+			return;
+
 		m_windowWidth = width;
 		m_windowHeight = height;
+		SetResolutionScale(m_resolutionScale);
+
+		// last frame's passes still hold the back buffer
+		m_frameGraph.Reset();
 
 		// main rtv
 		{
 			if (m_resLib.Exist<RenderTargetView>(RTV_MAIN))
 			{
 				m_resLib.Remove<RenderTargetView>(RTV_MAIN);
+				if (m_resLib.Exist<RenderTargetView>(RTV_MAIN_SRGB))
+					m_resLib.Remove<RenderTargetView>(RTV_MAIN_SRGB);
 				HRESULT hr;
-				GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->ResizeBuffers(1, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0));
+				if (m_context->GetSwapChain())
+					GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->ResizeBuffers(1, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0));
 			}
 
 			D3D11_RENDER_TARGET_VIEW_DESC desc = {};
 			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 			desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
 			desc.Texture2D.MipSlice = 0;
-			ComPtr<ID3D11Texture2D> backbuffer;
-			HRESULT hr;
-			GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->GetBuffer(0, __uuidof(ID3D11Texture2D), &backbuffer));
-			m_resLib.Add(RTV_MAIN, RenderTargetView::Create(m_context, desc, Texture2D::Create(m_context, backbuffer.Get())));
-		}
-
-		// scene rtv
-		{
-			if (m_resLib.Exist<RenderTargetView>(RTV_SCENE))
+			std::shared_ptr<Texture2D> tex;
+			if (m_context->GetSwapChain())
 			{
-				m_resLib.Remove<RenderTargetView>(RTV_SCENE);
-				m_resLib.Remove<ShaderResourceView>(SRV_SCENE);
+				ComPtr<ID3D11Texture2D> backbuffer;
+				HRESULT hr;
+				GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->GetBuffer(0, __uuidof(ID3D11Texture2D), &backbuffer));
+				tex = Texture2D::Create(m_context, backbuffer.Get());
 			}
-
-			D3D11_RENDER_TARGET_VIEW_DESC desc = {};
-			desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-			desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-			desc.Texture2D.MipSlice = 0;
-
-			D3D11_TEXTURE2D_DESC texDesc = {};
-			texDesc.Width = width;
-			texDesc.Height = height;
-			texDesc.ArraySize = 1;
-			texDesc.MipLevels = 1;
-			texDesc.Format = desc.Format;
-			texDesc.SampleDesc.Count = 1;
-			texDesc.SampleDesc.Quality = 0;
-			texDesc.Usage = D3D11_USAGE_DEFAULT;
-			texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-			texDesc.CPUAccessFlags = 0;
-			texDesc.MiscFlags = 0;
-
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = texDesc.Format;
-			srvDesc.Texture2D.MipLevels = 1;
-			srvDesc.Texture2D.MostDetailedMip = 0;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-
-			m_resLib.Add(RTV_SCENE, ShaderResourceView::Create(m_context, srvDesc, tex));
-			m_resLib.Add(SRV_SCENE, RenderTargetView::Create(m_context, desc, tex));
+			else
+			{
+				// headless, an offscreen texture stands in for the back buffer
+				D3D11_TEXTURE2D_DESC texDesc = {};
+				texDesc.Width = width;
+				texDesc.Height = height;
+				texDesc.MipLevels = 1;
+				texDesc.ArraySize = 1;
+				texDesc.Format = DXGI_FORMAT_R8G8B8A8_TYPELESS;
+				texDesc.SampleDesc.Count = 1;
+				texDesc.SampleDesc.Quality = 0;
+				texDesc.Usage = D3D11_USAGE_DEFAULT;
+				texDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+				texDesc.CPUAccessFlags = 0;
+				texDesc.MiscFlags = 0;
+				tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
+			}
+			m_resLib.Add(RTV_MAIN, RenderTargetView::Create(m_context, desc, tex));
+
+			// the final pass writes linear colours through an _SRGB view of the same buffer, the hardware encodes them.
+			// a blt model swap chain doesn't have to allow that view of its buffer, without it the shader keeps the gamma op
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			ComPtr<ID3D11RenderTargetView> srgbRTV;
+			if (SUCCEEDED(m_context->GetDevice()->CreateRenderTargetView(tex->GetNative(), &desc, &srgbRTV)))
+				m_resLib.Add(RTV_MAIN_SRGB, RenderTargetView::Create(m_context, srgbRTV.Get(), tex));
 		}
+	}
 
-
-		// scene dsv
-		{
-			if (m_resLib.Exist<DepthStencilView>(DSV_SCENE))
-				m_resLib.Remove<DepthStencilView>(DSV_SCENE);
-
-			D3D11_DEPTH_STENCIL_VIEW_DESC desc = {};
-			desc.Format = DXGI_FORMAT_D32_FLOAT;
-			desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-			desc.Texture2D.MipSlice = 0;
-
-			D3D11_TEXTURE2D_DESC texDesc = {};
-			texDesc.Width = width;
-			texDesc.Height = height;
-			texDesc.ArraySize = 1;
-			texDesc.MipLevels = 1;
-			texDesc.Format = desc.Format;
-			texDesc.SampleDesc.Count = 1;
-			texDesc.SampleDesc.Quality = 0;
-			texDesc.Usage = D3D11_USAGE_DEFAULT;
-			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-			texDesc.CPUAccessFlags = 0;
-			texDesc.MiscFlags = 0;
-
-			m_resLib.Add(DSV_SCENE, DepthStencilView::Create(m_context, desc, Texture2D::Create(m_context, texDesc, (void*)nullptr)));
-		}
+	void CSMTestRenderGraph::SetResolutionScale(float scale)
+	{
+		m_resolutionScale = std::clamp(scale, 0.0f, 1.0f);
+		m_renderWidth = std::max((uint32_t)(m_windowWidth * m_resolutionScale + 0.5f), 1u);
+		m_renderHeight = std::max((uint32_t)(m_windowHeight * m_resolutionScale + 0.5f), 1u);
 	}
 
 	void CSMTestRenderGraph::SetShaders()
 	{
-		m_resLib.Add(VS_DIRLIGHT_CSM, VertexShader::Create(m_context, "res/cso/dirlight_csm.vs.cso"));
-		m_resLib.Add(GS_DIRLIGHT_CSM, GeometryShader::Create(m_context, "res/cso/dirlight_csm.gs.cso"));
-		m_resLib.Add(IL_DIRLIGHT_CSM, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_DIRLIGHT_CSM)));
-		m_resLib.Add(PS_NULLPTR, PixelShader::Create(m_context, "res/cso/dirlight_csm.ps.cso"));
-		m_resLib.Add(GS_NULLPTR, GeometryShader::Create(m_context));
-
-		m_resLib.Add(VS_CSM_TEST, VertexShader::Create(m_context, "res/cso/csm_test.vs.cso"));
-		m_resLib.Add(PS_CSM_TEST, PixelShader::Create(m_context, "res/cso/csm_test.ps.cso"));
-		m_resLib.Add(IL_CSM_TEST, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_CSM_TEST)));
-
-		m_resLib.Add(VS_FS_OUT_TC_POS, VertexShader::Create(m_context, "res/cso/fullscreen_out_tc_pos.vs.cso"));
-		m_resLib.Add(IL_FS_OUT_TC_POS, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_FS_OUT_TC_POS)));
-		m_resLib.Add(PS_GAMMA_CORRECTION, PixelShader::Create(m_context, "res/cso/gamma_correction.ps.cso"));
+		m_resLib.Add(VS_DIRLIGHT_CSM, m_shared->GetVertexShader("res/cso/dirlight_csm.vs.cso"));
+		m_resLib.Add(GS_DIRLIGHT_CSM, m_shared->GetGeometryShader("res/cso/dirlight_csm.gs.cso"));
+		m_resLib.Add(IL_DIRLIGHT_CSM, m_shared->GetInputLayout("res/cso/dirlight_csm.vs.cso"));
+		m_resLib.Add(PS_NULLPTR, m_shared->GetPixelShader("res/cso/dirlight_csm.ps.cso"));
+		m_resLib.Add(GS_NULLPTR, m_shared->GetGeometryShader(""));
+
+		m_resLib.Add(VS_CSM_TEST, m_shared->GetVertexShader("res/cso/csm_test.vs.cso"));
+		m_resLib.Add(PS_CSM_TEST, m_shared->GetPixelShader("res/cso/csm_test.ps.cso"));
+		m_resLib.Add(IL_CSM_TEST, m_shared->GetInputLayout("res/cso/csm_test.vs.cso"));
+
+		m_resLib.Add(VS_DEPTH_PREPASS, m_shared->GetVertexShader("res/cso/depth_prepass.vs.cso"));
+		m_resLib.Add(IL_DEPTH_PREPASS, m_shared->GetInputLayout("res/cso/depth_prepass.vs.cso"));
 	}
 
 	void CSMTestRenderGraph::SetStates()
 	{
 		// rs
 		{
-			m_resLib.Add(S_DEFAULT, RasterizerState::Create(m_context, CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT())));
+			m_resLib.Add(S_DEFAULT, m_shared->GetRasterizerState(CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT())));
 
 			D3D11_RASTERIZER_DESC desc = CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT());
 			desc.DepthBias = 40;
 			desc.SlopeScaledDepthBias = 6.0f;
 			desc.DepthBiasClamp = 1.0f;
-			m_resLib.Add(RS_DEPTH_SLOPE_SCALED_BIAS, RasterizerState::Create(m_context, desc));
+			m_resLib.Add(RS_DEPTH_SLOPE_SCALED_BIAS, m_shared->GetRasterizerState(desc));
 		}
 
 		// bs
 		{
-			m_resLib.Add(S_DEFAULT, BlendState::Create(m_context, CD3D11_BLEND_DESC(CD3D11_DEFAULT())));
+			m_resLib.Add(S_DEFAULT, m_shared->GetBlendState(CD3D11_BLEND_DESC(CD3D11_DEFAULT())));
 		}
 
 		// dss
 		{
-			m_resLib.Add(S_DEFAULT, DepthStencilState::Create(m_context, CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT())));
+			m_resLib.Add(S_DEFAULT, m_shared->GetDepthStencilState(CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT())));
+
+			D3D11_DEPTH_STENCIL_DESC desc = CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT());
+			desc.DepthFunc = D3D11_COMPARISON_EQUAL;
+			desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+			m_resLib.Add(DSS_DEPTH_WRITE_ZERO_OP_EQUAL, m_shared->GetDepthStencilState(desc));
 		}
 
 		// ss
 		{
 			D3D11_SAMPLER_DESC desc = CD3D11_SAMPLER_DESC(CD3D11_DEFAULT());
-			desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-			desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
-			desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
-			desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-			for (int i = 0; i < 4; i++)
-				desc.BorderColor[i] = 0.0f;
-			desc.MinLOD = 0.0f;
-			desc.MaxLOD = D3D11_FLOAT32_MAX;
-			m_resLib.Add(SS_POINT_CLAMP, SamplerState::Create(m_context, desc));
-
-			desc = CD3D11_SAMPLER_DESC(CD3D11_DEFAULT());
 			desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 			desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
 			desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
@@ -551,68 +675,49 @@ namespace GA
 				desc.BorderColor[i] = 0.0f;
 			desc.MinLOD = 0.0f;
 			desc.MaxLOD = D3D11_FLOAT32_MAX;
-			m_resLib.Add(SS_LINEAR_CLAMP, SamplerState::Create(m_context, desc));
+			m_resLib.Add(SS_LINEAR_CLAMP, m_shared->GetSamplerState(desc));
 		}
 	}
 
-	void CSMTestRenderGraph::SetBuffers()
+	void CSMTestRenderGraph::SetPipelineStates()
 	{
-		// fs quad
-		{
-			float vert[] =
-			{
-				-1.0f,  1.0f,
-				 1.0f,  1.0f,
-				 1.0f, -1.0f,
-				-1.0f, -1.0f
-			};
-
-			uint32_t ind[] =
-			{
-				0, 1, 2,
-				2, 3, 0
-			};
-
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(vert);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 2 * sizeof(float);
-			m_resLib.Add(VB_FS_QUAD, Buffer::Create(m_context, desc, vert));
-
-			desc = {};
-			desc.ByteWidth = sizeof(ind);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(uint32_t);
-			m_resLib.Add(IB_FS_QUAD, Buffer::Create(m_context, desc, ind));
-		}
-
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(XMFLOAT4);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_PS_GAMMA_CORRECTION_SYSTEM, Buffer::Create(m_context, desc, nullptr));
-		}
+		PipelineStateDesc desc = {};
+		desc.sampleMask = 0xff;
+		desc.stencilRef = 0xff;
+		desc.blendState = m_resLib.Get<BlendState>(S_DEFAULT);
+		desc.depthStencilState = m_resLib.Get<DepthStencilState>(S_DEFAULT);
+
+		// cascades, the gs routes every triangle to all slices
+		desc.vs = m_resLib.Get<VertexShader>(VS_DIRLIGHT_CSM);
+		desc.gs = m_resLib.Get<GeometryShader>(GS_DIRLIGHT_CSM);
+		desc.ps = m_resLib.Get<PixelShader>(PS_NULLPTR);
+		desc.inputLayout = m_resLib.Get<InputLayout>(IL_DIRLIGHT_CSM);
+		desc.rasterizerState = m_resLib.Get<RasterizerState>(RS_DEPTH_SLOPE_SCALED_BIAS);
+		m_resLib.Add(PSO_DIRLIGHT_CSM, PipelineState::Create(m_context, desc));
+
+		desc.gs = nullptr;
+		desc.rasterizerState = m_resLib.Get<RasterizerState>(S_DEFAULT);
+
+		desc.vs = m_resLib.Get<VertexShader>(VS_CSM_TEST);
+		desc.ps = m_resLib.Get<PixelShader>(PS_CSM_TEST);
+		desc.inputLayout = m_resLib.Get<InputLayout>(IL_CSM_TEST);
+		m_resLib.Add(PSO_CSM_TEST, PipelineState::Create(m_context, desc));
+
+		// after a depth pre-pass
+		desc.depthStencilState = m_resLib.Get<DepthStencilState>(DSS_DEPTH_WRITE_ZERO_OP_EQUAL);
+		m_resLib.Add(PSO_CSM_TEST_EQUAL, PipelineState::Create(m_context, desc));
+		desc.depthStencilState = m_resLib.Get<DepthStencilState>(S_DEFAULT);
+
+		// depth pre-pass, depth only
+		desc.vs = m_resLib.Get<VertexShader>(VS_DEPTH_PREPASS);
+		desc.ps = nullptr;
+		desc.inputLayout = m_resLib.Get<InputLayout>(IL_DEPTH_PREPASS);
+		m_resLib.Add(PSO_DEPTH_PREPASS, PipelineState::Create(m_context, desc));
+	}
 
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(XMFLOAT4X4);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_DIRLIGHT_CSM_ENTITY, Buffer::Create(m_context, desc, nullptr));
-		}
+	void CSMTestRenderGraph::SetBuffers()
+	{
+		m_resLib.Add(CR_INSTANCE, ConstantRing::Create(m_context, CONSTANT_RING_SIZE));
 
 		{
 			D3D11_BUFFER_DESC desc = {};
@@ -636,17 +741,6 @@ namespace GA
 			m_resLib.Add(CB_VS_CSM_TEST_SYSTEM, Buffer::Create(m_context, desc, nullptr));
 		}
 
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(GA::Utils::CSMTestVSEntityCBuf);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_CSM_TEST_ENTITY, Buffer::Create(m_context, desc, nullptr));
-		}
-
 		{
 			D3D11_BUFFER_DESC desc = {};
 			desc.ByteWidth = sizeof(GA::Utils::CSMTestPSSystemCBuf);
@@ -657,86 +751,31 @@ namespace GA
 			desc.StructureByteStride = 0;
 			m_resLib.Add(CB_PS_CSM_TEST_SYSTEM, Buffer::Create(m_context, desc, nullptr));
 		}
-
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(GA::Utils::CSMTestPSEntityCBuf);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_PS_CSM_TEST_ENTITY, Buffer::Create(m_context, desc, nullptr));
-		}
 	}
 
 	void CSMTestRenderGraph::SetLightDepthBuffers()
 	{
-		{
-			D3D11_TEXTURE2D_DESC texDesc = {};
-			texDesc.Width = SHADOWMAP_SIZE;
-			texDesc.Height = SHADOWMAP_SIZE;
-			texDesc.ArraySize = (uint32_t)GA::Utils::s_numCascades;
-			texDesc.MipLevels = 1;
-			texDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-			texDesc.SampleDesc.Count = 1;
-			texDesc.SampleDesc.Quality = 0;
-			texDesc.Usage = D3D11_USAGE_DEFAULT;
-			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-			texDesc.CPUAccessFlags = 0;
-			texDesc.MiscFlags = 0;
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
-
-			D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
-			dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
-			dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
-			dsvDesc.Texture2DArray.ArraySize = (uint32_t)GA::Utils::s_numCascades;
-			dsvDesc.Texture2DArray.FirstArraySlice = 0;
-			dsvDesc.Texture2DArray.MipSlice = 0;
-			m_resLib.Add(DSV_DIRLIGHT_SHADOW_MAP, DepthStencilView::Create(m_context, dsvDesc, tex));
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-			srvDesc.Texture2DArray.ArraySize = (uint32_t)GA::Utils::s_numCascades;
-			srvDesc.Texture2DArray.FirstArraySlice = 0;
-			srvDesc.Texture2DArray.MipLevels = 1;
-			srvDesc.Texture2DArray.MostDetailedMip = 0;
-			m_resLib.Add(SRV_DIRLIGHT_SHADOW_MAP, ShaderResourceView::Create(m_context, srvDesc, tex));
-		}
-
-		{
-			D3D11_TEXTURE2D_DESC texDesc = {};
-			texDesc.Width = SHADOWMAP_SIZE;
-			texDesc.Height = SHADOWMAP_SIZE;
-			texDesc.ArraySize = (uint32_t)GA::Utils::s_numCascades;
-			texDesc.MipLevels = 1;
-			texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			texDesc.SampleDesc.Count = 1;
-			texDesc.SampleDesc.Quality = 0;
-			texDesc.Usage = D3D11_USAGE_DEFAULT;
-			texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-			texDesc.CPUAccessFlags = 0;
-			texDesc.MiscFlags = 0;
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
-
-			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-			rtvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
-			rtvDesc.Texture2DArray.ArraySize = (uint32_t)GA::Utils::s_numCascades;
-			rtvDesc.Texture2DArray.FirstArraySlice = 0;
-			rtvDesc.Texture2DArray.MipSlice = 0;
-			m_resLib.Add(RTV_DIRLIGHT_SHADOW_MAP, RenderTargetView::Create(m_context, rtvDesc, tex));
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-			srvDesc.Texture2DArray.ArraySize = (uint32_t)GA::Utils::s_numCascades;
-			srvDesc.Texture2DArray.FirstArraySlice = 0;
-			srvDesc.Texture2DArray.MipLevels = 1;
-			srvDesc.Texture2DArray.MostDetailedMip = 0;
-			m_resLib.Add(RTV_SRV_DIRLIGHT_SHADOW_MAP, ShaderResourceView::Create(m_context, srvDesc, tex));
-		}
+		// static casters only, copied into the frame graph's shadow map before dynamic casters are drawn
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = SHADOWMAP_SIZE;
+		texDesc.Height = SHADOWMAP_SIZE;
+		texDesc.ArraySize = (uint32_t)GA::Utils::s_numCascades;
+		texDesc.MipLevels = 1;
+		texDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = 0;
+
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		dsvDesc.Texture2DArray.ArraySize = (uint32_t)GA::Utils::s_numCascades;
+		dsvDesc.Texture2DArray.FirstArraySlice = 0;
+		dsvDesc.Texture2DArray.MipSlice = 0;
+		m_resLib.Add(DSV_DIRLIGHT_STATIC_SHADOW_MAP, DepthStencilView::Create(m_context, dsvDesc, Texture2D::Create(m_context, texDesc, (void*)nullptr)));
 	}
 
 	std::array<DirectX::XMFLOAT4X4, GA::Utils::s_numCascades> CSMTestRenderGraph::CalculateLightSpace(DirectX::FXMVECTOR xmLightDir)
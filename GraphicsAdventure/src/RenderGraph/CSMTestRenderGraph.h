@@ -2,41 +2,98 @@
 #include "Scene/System.h"
 #include "Scene/Camera.h"
 #include "Utils/ResourceLibrary.h"
+#include "Utils/SharedResourceCache.h"
 #include "Utils/ShaderCBuf.h"
+#include "Scene/Components.h"
+#include "Scene/ComponentTracker.h"
+#include "RenderGraph/DrawList.h"
+#include "RenderGraph/InstanceBuffer.h"
+#include "RenderGraph/MaterialCache.h"
+#include "RenderGraph/DepthPrepass.h"
+#include "RenderGraph/FrameGraph.h"
+#include "RenderGraph/PostProcessChain.h"
 
 namespace GA
 {
 	class CSMTestRenderGraph : public System
 	{
 	public:
-		CSMTestRenderGraph(Scene* scene, GDX11::GDX11Context* context, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight);
+		CSMTestRenderGraph(Scene* scene, GDX11::GDX11Context* context, GA::Utils::SharedResourceCache* shared, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight);
 
 		void Execute();
 
 		void ResizeViews(uint32_t width, uint32_t height);
+		// fraction of the window the scene is rendered at, the final pass upscales it
+		void SetResolutionScale(float scale);
+		float GetResolutionScale() const { return m_resolutionScale; }
+		uint32_t GetRenderWidth() const { return m_renderWidth; }
+		uint32_t GetRenderHeight() const { return m_renderHeight; }
+
+		const DrawList& GetDrawList() const { return m_drawList; }
+		const GDX11::ConstantRing::Stats& GetConstantRingStats() const;
+		const MaterialCache::Stats& GetMaterialStats() const { return m_materials.GetStats(); }
+		GA::Utils::TexturePool::Stats GetTextureStats() const { return m_textures.GetStats(); }
+		DepthPrepass& GetDepthPrepass() { return m_depthPrepass; }
+		const FrameGraph& GetFrameGraph() const { return m_frameGraph; }
 
 	private:
-		void ShadowPass();
-		void RenderPass();
-		void GammaCorrectionPass();
+		void ShadowPass(const std::shared_ptr<GDX11::DepthStencilView>& dsv);
+		void UpdateShadowCasters();
+		void DrawShadowCasters(const std::shared_ptr<GDX11::VertexShader>& vs, bool staticCasters);
+		void RenderPass(const std::shared_ptr<GDX11::RenderTargetView>& rtv, const std::shared_ptr<GDX11::DepthStencilView>& dsv, const std::shared_ptr<GDX11::ShaderResourceView>& shadowMaps);
+
+		// collects the opaque renderables sorted by state and split into instanced batches
+		void BuildDrawList(DrawList& list, uint32_t pass);
 
 		void SetShaders();
 		void SetStates();
+		void SetPipelineStates();
 		void SetBuffers();
 		void SetLightDepthBuffers();
 
 		std::array<DirectX::XMFLOAT4X4, GA::Utils::s_numCascades> CalculateLightSpace(DirectX::FXMVECTOR xmLightDir);
 
 		GDX11::GDX11Context* m_context;
+		// states, shaders and static buffers, shared with the other graphs
+		GA::Utils::SharedResourceCache* m_shared;
 		const Camera* m_camera;
 		GA::Utils::ResourceLibrary m_resLib;
+		FrameGraph m_frameGraph;
+		PostProcessChain m_postProcess;
 
 		entt::observer m_renderable;
+		entt::observer m_opaque;
 		entt::observer m_dirLight;
 
 		uint32_t m_windowWidth;
 		uint32_t m_windowHeight;
+		// the scene targets stay window sized, only their top left corner is rendered
+		float m_resolutionScale;
+		uint32_t m_renderWidth;
+		uint32_t m_renderHeight;
 
 		std::array<float, GA::Utils::s_numCascades> m_cascadeFarZDist;
+
+		DrawList m_drawList;
+		GA::Utils::TexturePool m_textures;
+		MaterialCache m_materials;
+		DrawIdTable m_meshIds;
+		InstanceBuffer<GA::Utils::EntityInstance> m_entityInstances;
+		DepthPrepass m_depthPrepass;
+		DrawList m_casterDrawList; // static casters first, batched by mesh
+		InstanceBuffer<DirectX::XMFLOAT4X4> m_casterInstances;
+		std::vector<GDX11::ConstantAllocation> m_batchAllocations;
+		std::vector<GDX11::ConstantAllocation> m_casterAllocations; // one per caster batch
+
+		// static-only cascades the shadow map starts from
+		struct
+		{
+			std::array<DirectX::XMFLOAT4X4, GA::Utils::s_numCascades> lightSpaces;
+			uint64_t version;
+			bool valid;
+		} m_staticShadowCache;
+
+		ComponentTracker<TransformComponent> m_staticCasterTransforms;
+		uint64_t m_staticCasterVersion;
 	};
 }
\ No newline at end of file
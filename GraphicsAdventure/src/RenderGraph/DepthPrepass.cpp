@@ -0,0 +1,170 @@
+#include "DepthPrepass.h"
+#include "Scene/Components.h"
+#include "Utils/ShaderCBuf.h"
+#include "RenderGraph/ShaderBindingIds.h"
+
+using namespace GDX11;
+using namespace DirectX;
+
+namespace GA
+{
+	DepthPrepass::DepthPrepass(GDX11Context* context, float enableOverdraw, float disableOverdraw)
+		: m_context(context), m_mode(Mode::Auto), m_enableOverdraw(enableOverdraw), m_disableOverdraw(disableOverdraw),
+		m_instances(context), m_views(), m_frame(0)
+	{
+		// one view until the graph says otherwise, GetStats() works before the first frame
+		Begin();
+	}
+
+	void DepthPrepass::CreateQueries(View& view)
+	{
+		D3D11_QUERY_DESC desc = {};
+		desc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+		desc.MiscFlags = 0;
+
+		HRESULT hr;
+		for (auto& q : view.queries)
+			GDX11_CONTEXT_THROW_INFO(m_context->GetDevice()->CreateQuery(&desc, &q.query));
+	}
+
+	void DepthPrepass::Begin(uint32_t views)
+	{
+		// views that went away drop their queries, new ones start measuring with the pre-pass off
+		size_t first = m_views.size();
+		m_views.resize(views);
+		for (size_t v = first; v < m_views.size(); v++)
+			CreateQueries(m_views[v]);
+
+		++m_frame;
+
+		for (auto& view : m_views)
+		{
+			ReadResults(view);
+
+			auto& stats = view.stats;
+			stats.probing = false;
+			switch (m_mode)
+			{
+			case Mode::On:
+				stats.active = true;
+				break;
+
+			case Mode::Off:
+				stats.active = false;
+				break;
+
+			case Mode::Auto:
+				stats.active = view.enabled;
+				if (view.enabled && ++view.framesSinceProbe >= s_probeInterval)
+				{
+					view.framesSinceProbe = 0;
+					stats.active = false;
+					stats.probing = true;
+				}
+				break;
+			}
+
+			stats.draws = 0;
+			stats.batches = 0;
+		}
+	}
+
+	void DepthPrepass::Build(const entt::registry& registry, const DrawList& opaque, uint32_t pass, ConstantRing* ring, uint32_t view)
+	{
+		// the opaque keys already carry quantised view depth, keep only that so the order is strictly front to back.
+		// consecutive draws of the same mesh still batch
+		m_drawList.Clear();
+		for (const auto& item : opaque.GetItems())
+		{
+			if (!Covers(item.key)) continue;
+			m_drawList.Add(DrawKey::Make(pass, 0, 0, 0, (uint32_t)(item.key & ((1 << DrawKey::s_depthBits) - 1))), item.entity);
+		}
+
+		m_drawList.Sort();
+		m_drawList.Batch(registry, true);
+
+		m_instances.Clear();
+		for (const auto& item : m_drawList.GetItems())
+		{
+			XMFLOAT4X4 transform;
+			XMStoreFloat4x4(&transform, XMMatrixTranspose(registry.get<TransformComponent>(item.entity).GetTransform()));
+			m_instances.Push(transform);
+		}
+
+		m_instances.Upload();
+
+		m_batchAllocations.clear();
+		for (const auto& batch : m_drawList.GetBatches())
+		{
+			GA::Utils::InstanceCBuf cbufData = {};
+			cbufData.instanceOffset = batch.first;
+			m_batchAllocations.push_back(ring->Allocate(cbufData));
+		}
+		ring->Flush();
+
+		m_views[view].stats.draws = (uint32_t)m_drawList.GetItems().size();
+		m_views[view].stats.batches = (uint32_t)m_drawList.GetBatches().size();
+	}
+
+	void DepthPrepass::Draw(const entt::registry& registry, const std::shared_ptr<VertexShader>& vs, ConstantRing* ring)
+	{
+		m_instances.VSBind(vs->GetBindings().Get(Binding::prepassInstances));
+		uint32_t instanceSlot = vs->GetBindings().Get(Binding::InstanceCBuf);
+
+		const auto& batches = m_drawList.GetBatches();
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			const auto& batch = batches[i];
+			const auto& mesh = registry.get<MeshComponent>(batch.entity);
+			mesh.vb->BindAsVB();
+			mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
+			m_context->GetStateCache().SetPrimitiveTopology(mesh.topology);
+			ring->VSBind(m_batchAllocations[i], instanceSlot);
+
+			m_context->DrawIndexedInstanced(mesh.GetIndexCount(), batch.count, mesh.GetStartIndex(), mesh.GetBaseVertex(), 0);
+		}
+	}
+
+	void DepthPrepass::BeginMeasure(uint32_t view)
+	{
+		// all queries still in flight, this frame goes unmeasured
+		auto& v = m_views[view];
+		auto& q = v.queries[m_frame % s_latency];
+		v.measuring = !q.pending;
+		if (v.measuring)
+			m_context->GetDeviceContext()->Begin(q.query.Get());
+	}
+
+	void DepthPrepass::EndMeasure(uint32_t pixels, uint32_t view)
+	{
+		auto& v = m_views[view];
+		if (!v.measuring) return;
+
+		auto& q = v.queries[m_frame % s_latency];
+		m_context->GetDeviceContext()->End(q.query.Get());
+		q.pixels = pixels;
+		q.pending = true;
+		q.prepass = v.stats.active;
+		v.measuring = false;
+	}
+
+	void DepthPrepass::ReadResults(View& view)
+	{
+		for (auto& q : view.queries)
+		{
+			if (!q.pending) continue;
+
+			D3D11_QUERY_DATA_PIPELINE_STATISTICS data = {};
+			if (m_context->GetDeviceContext()->GetData(q.query.Get(), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				continue;
+
+			q.pending = false;
+
+			// with the pre-pass on the colour pass shades about once per pixel, that says nothing about the scene
+			if (q.prepass || q.pixels == 0) continue;
+
+			view.stats.overdraw = (float)data.PSInvocations / (float)q.pixels;
+			view.enabled = view.stats.overdraw > (view.enabled ? m_disableOverdraw : m_enableOverdraw);
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <GDX11.h>
+#include <wrl.h>
+#include <entt/entt.hpp>
+#include "RenderGraph/DrawList.h"
+#include "RenderGraph/InstanceBuffer.h"
+
+namespace GA
+{
+	// Optional depth only pass in front of an opaque colour pass. the opaque draws are redrawn front to back with a
+	// position only vertex shader, then the colour pass tests EQUAL without writing depth so every pixel is shaded once.
+	// overdraw is counted with a pipeline statistics query around the colour pass (pixel shader invocations per pixel),
+	// in Auto mode the pre-pass turns on above enableOverdraw and off below disableOverdraw. results arrive a few
+	// frames late. while it's on, one frame every s_probeInterval skips it to measure again.
+	// every view of a frame has its own queries and decision, their viewports and depth complexity differ
+	class DepthPrepass
+	{
+	public:
+		enum class Mode
+		{
+			Auto = 0,
+			On,
+			Off
+		};
+
+		struct Stats
+		{
+			float overdraw; // last measured without the pre-pass
+			bool active;    // this frame draws it
+			bool probing;   // this frame skips it to measure
+			uint32_t draws;
+			uint32_t batches;
+		};
+
+		// parallax variants clip pixels in the pixel shader, a depth only draw can't reproduce that.
+		// they skip the pre-pass and keep the regular depth test in the colour pass
+		static bool Covers(uint64_t key) { return DrawKey::GetVariant(key) < 2; }
+
+		DepthPrepass(GDX11::GDX11Context* context, float enableOverdraw = 2.0f, float disableOverdraw = 1.5f);
+
+		void SetMode(Mode mode) { m_mode = mode; }
+		Mode GetMode() const { return m_mode; }
+
+		// once per frame before the first opaque pass
+		void Begin(uint32_t views = 1);
+		// true if the view draws the pre-pass this frame
+		bool IsActive(uint32_t view = 0) const { return m_views[view].stats.active; }
+
+		// front to back copy of the sorted opaque list of the view, covered draws only. Draw() before the next view's Build()
+		void Build(const entt::registry& registry, const DrawList& opaque, uint32_t pass, GDX11::ConstantRing* ring, uint32_t view = 0);
+		// pipeline state and viewProjection are bound by the caller
+		void Draw(const entt::registry& registry, const std::shared_ptr<GDX11::VertexShader>& vs, GDX11::ConstantRing* ring);
+
+		// counts the pixel shader invocations of the view's colour pass in between
+		void BeginMeasure(uint32_t view = 0);
+		void EndMeasure(uint32_t pixels, uint32_t view = 0);
+
+		const Stats& GetStats(uint32_t view = 0) const { return m_views[view].stats; }
+		uint32_t GetViewCount() const { return (uint32_t)m_views.size(); }
+
+	private:
+		static constexpr uint32_t s_latency = 3;
+		static constexpr uint32_t s_probeInterval = 120;
+
+		struct Query
+		{
+			Microsoft::WRL::ComPtr<ID3D11Query> query;
+			uint32_t pixels = 0;
+			bool pending = false;
+			bool prepass = false;
+		};
+
+		struct View
+		{
+			std::array<Query, s_latency> queries;
+			bool enabled = false;
+			uint32_t framesSinceProbe = 0;
+			bool measuring = false;
+			Stats stats = {};
+		};
+
+		void CreateQueries(View& view);
+		void ReadResults(View& view);
+
+		GDX11::GDX11Context* m_context;
+		Mode m_mode;
+		float m_enableOverdraw;
+		float m_disableOverdraw;
+
+		DrawList m_drawList;
+		InstanceBuffer<DirectX::XMFLOAT4X4> m_instances;
+		std::vector<GDX11::ConstantAllocation> m_batchAllocations;
+
+		std::vector<View> m_views;
+		uint32_t m_frame;
+	};
+}
@@ -0,0 +1,190 @@
+#include "DrawList.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include "Core/Time.h"
+#include "RenderGraph/ShaderBindingIds.h"
+
+namespace GA
+{
+	uint32_t DrawKey::QuantizeDepth(float viewDepth, float nearZ, float farZ, bool invert)
+	{
+		float t = std::clamp((viewDepth - nearZ) / (farZ - nearZ), 0.0f, 1.0f);
+		if (invert) t = 1.0f - t;
+
+		return (uint32_t)(t * (float)((1 << s_depthBits) - 1));
+	}
+
+	uint32_t DrawIdTable::Get(const void* a, const void* b, const void* c, const void* d)
+	{
+		auto it = m_ids.find({ a, b, c, d });
+		if (it == m_ids.end())
+		{
+			uint32_t id = m_nextId;
+			if (m_freeIds.empty())
+			{
+				++m_nextId;
+			}
+			else
+			{
+				id = m_freeIds.back();
+				m_freeIds.pop_back();
+			}
+
+			it = m_ids.emplace(std::array<const void*, 4>{ a, b, c, d }, Entry{ id, false }).first;
+		}
+
+		it->second.used = true;
+		return it->second.id;
+	}
+
+	void DrawIdTable::Sweep()
+	{
+		for (auto it = m_ids.begin(); it != m_ids.end();)
+		{
+			if (it->second.used)
+			{
+				it->second.used = false;
+				++it;
+				continue;
+			}
+
+			m_freeIds.push_back(it->second.id);
+			it = m_ids.erase(it);
+		}
+	}
+
+	void DrawList::Sort()
+	{
+		Timer timer;
+
+		size_t n = m_items.size();
+		m_stats = {};
+		m_stats.draws = (uint32_t)n;
+		m_stats.culled = m_culled;
+
+		// frame to frame the order barely changes, an already sorted list needs no passes at all
+		if (std::is_sorted(m_items.begin(), m_items.end(), [](const Item& a, const Item& b) { return a.key < b.key; }))
+		{
+			m_stats.alreadySorted = true;
+			m_stats.sortMs = timer.Peek() * 1000.0f;
+			return;
+		}
+
+		uint32_t numThreads = 1;
+		if (n >= s_parallelThreshold)
+			numThreads = std::clamp(std::thread::hardware_concurrency(), 1u, s_maxThreads);
+
+		m_scratch.resize(n);
+		m_histograms.resize(numThreads);
+
+		std::vector<uint32_t> threads(numThreads);
+		std::iota(threads.begin(), threads.end(), 0);
+		size_t chunk = (n + numThreads - 1) / numThreads;
+
+		Item* src = m_items.data();
+		Item* dst = m_scratch.data();
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			std::for_each(std::execution::par, threads.begin(), threads.end(), [&](uint32_t t)
+			{
+				auto& histogram = m_histograms[t];
+				histogram.fill(0);
+
+				size_t end = std::min(n, (t + 1) * chunk);
+				for (size_t i = t * chunk; i < end; i++)
+					++histogram[(src[i].key >> shift) & 0xff];
+			});
+
+			// a digit every key shares doesn't reorder anything
+			uint32_t firstDigit = (src[0].key >> shift) & 0xff;
+			size_t sameDigit = 0;
+			for (const auto& histogram : m_histograms)
+				sameDigit += histogram[firstDigit];
+
+			if (sameDigit == n)
+			{
+				++m_stats.skippedPasses;
+				continue;
+			}
+
+			// histogram entries become scatter offsets. digit major, thread minor keeps the sort stable
+			uint32_t offset = 0;
+			for (uint32_t digit = 0; digit < 256; digit++)
+			{
+				for (auto& histogram : m_histograms)
+				{
+					uint32_t count = histogram[digit];
+					histogram[digit] = offset;
+					offset += count;
+				}
+			}
+
+			std::for_each(std::execution::par, threads.begin(), threads.end(), [&](uint32_t t)
+			{
+				auto& offsets = m_histograms[t];
+
+				size_t end = std::min(n, (t + 1) * chunk);
+				for (size_t i = t * chunk; i < end; i++)
+					dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+			});
+
+			std::swap(src, dst);
+			++m_stats.radixPasses;
+		}
+
+		if (src != m_items.data())
+			m_items.swap(m_scratch);
+
+		m_stats.sortMs = timer.Peek() * 1000.0f;
+	}
+
+	void DrawList::Batch(const entt::registry& registry, bool meshOnly)
+	{
+		m_batches.clear();
+
+		const MeshComponent* prevMesh = nullptr;
+		uint32_t prevPipeline = 0;
+		for (uint32_t i = 0; i < (uint32_t)m_items.size(); i++)
+		{
+			const auto& item = m_items[i];
+			const auto& mesh = registry.get<MeshComponent>(item.entity);
+			uint32_t pipeline = (DrawKey::GetPass(item.key) << 4) | DrawKey::GetVariant(item.key);
+
+			bool sameMesh = prevMesh && pipeline == prevPipeline &&
+				mesh.vb == prevMesh->vb && mesh.ib == prevMesh->ib && mesh.topology == prevMesh->topology &&
+				mesh.GetIndexCount() == prevMesh->GetIndexCount() && mesh.GetStartIndex() == prevMesh->GetStartIndex() && mesh.GetBaseVertex() == prevMesh->GetBaseVertex();
+			bool sameMat = meshOnly || (prevMesh && item.material == m_items[i - 1].material);
+
+			if (sameMesh && sameMat)
+				++m_batches.back().count;
+			else
+				m_batches.push_back({ i, 1, item.entity });
+
+			prevMesh = &mesh;
+			prevPipeline = pipeline;
+		}
+
+		m_stats.batches = (uint32_t)m_batches.size();
+	}
+
+	void BindDrawResources(GDX11::GDX11Context* context, const MeshComponent& mesh, const MaterialCache::Material& mat, GDX11::PixelShader* ps)
+	{
+		mesh.vb->BindAsVB();
+		mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
+		context->GetStateCache().SetPrimitiveTopology(mesh.topology);
+
+		mat.diffuseMap->PSBind(ps->GetBindings().Get(Binding::diffuseMap));
+		mat.samplerState->PSBind(ps->GetBindings().Get(Binding::samplerState));
+		mat.cbuf->PSBindAsCBuf(ps->GetBindings().Get(Binding::MaterialCBuf));
+
+		// without a normal map the shader ignores both slots, whatever is bound there can stay
+		if (mat.normalMap)
+		{
+			mat.normalMap->PSBind(ps->GetBindings().Get(Binding::normalMap));
+			if (mat.depthMap)
+				mat.depthMap->PSBind(ps->GetBindings().Get(Binding::depthMap));
+		}
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <map>
+#include <GDX11.h>
+#include <entt/entt.hpp>
+#include "Scene/Components.h"
+#include "RenderGraph/MaterialCache.h"
+
+namespace GA
+{
+	// 64 bit draw sort key, most significant bits first
+	// [63..60] pass | [59..56] shader variant | [55..40] material id | [39..24] mesh id | [23..0] quantised depth
+	struct DrawKey
+	{
+		static constexpr uint32_t s_depthBits = 24;
+
+		static uint64_t Make(uint32_t pass, uint32_t variant, uint32_t material, uint32_t mesh, uint32_t depth)
+		{
+			return ((uint64_t)(pass & 0xf) << 60) |
+				((uint64_t)(variant & 0xf) << 56) |
+				((uint64_t)(material & 0xffff) << 40) |
+				((uint64_t)(mesh & 0xffff) << 24) |
+				((uint64_t)depth & ((1 << s_depthBits) - 1));
+		}
+
+		static uint32_t GetPass(uint64_t key) { return (uint32_t)(key >> 60); }
+		static uint32_t GetVariant(uint64_t key) { return (uint32_t)(key >> 56) & 0xf; }
+
+		// viewDepth in [nearZ, farZ] to 24 bits. invert for back to front
+		static uint32_t QuantizeDepth(float viewDepth, float nearZ, float farZ, bool invert = false);
+	};
+
+	// run of consecutive draws that bind the same pipeline, mesh and material and go out as one instanced draw
+	struct DrawBatch
+	{
+		uint32_t first; // index of the first draw, its instance is at the same index in the instance buffer
+		uint32_t count;
+		entt::entity entity; // first draw of the batch, supplies mesh and material
+	};
+
+	// Hands out small ids for resource combinations so they fit into draw keys.
+	// Ids only group draws, submission still compares the actual resources, so wrapping past 16 bits is harmless.
+	// combinations nothing asked for since the last Sweep() are dropped and their ids reused, released meshes
+	// don't pile up and their pointers are never looked at again
+	class DrawIdTable
+	{
+	public:
+		uint32_t Get(const void* a, const void* b = nullptr, const void* c = nullptr, const void* d = nullptr);
+		// once per frame, before the frame's first Get()
+		void Sweep();
+
+	private:
+		struct Entry
+		{
+			uint32_t id;
+			bool used;
+		};
+
+		std::map<std::array<const void*, 4>, Entry> m_ids;
+		std::vector<uint32_t> m_freeIds;
+		uint32_t m_nextId = 0;
+	};
+
+	// Draws of a pass collected as (key, entity) and sorted by key before submission
+	class DrawList
+	{
+	public:
+		struct Item
+		{
+			uint64_t key;
+			entt::entity entity;
+			uint32_t material; // MaterialCache id, draws with the same id share texture arrays and constants
+			MaterialSlices slices;
+		};
+
+		struct Stats
+		{
+			uint32_t draws;
+			bool alreadySorted;
+			uint32_t radixPasses;  // 8 bit digit passes that moved data
+			uint32_t skippedPasses; // digits every key shares
+			float sortMs;
+			uint32_t batches;
+			uint32_t culled;
+		};
+
+		void Clear() { m_items.clear(); m_culled = 0; }
+		void Add(uint64_t key, entt::entity e, uint32_t material = 0, const MaterialSlices& slices = {}) { m_items.push_back({ key, e, material, slices }); }
+		// counts a renderable that was left out by culling
+		void Cull() { ++m_culled; }
+
+		// parallel LSD radix sort, stable
+		void Sort();
+
+		// splits the sorted draws into instanced batches. pass and variant bits must match, then the actual mesh
+		// resources are compared so id collisions never merge different meshes. materials must have the same MaterialCache id,
+		// meshOnly ignores the material (depth only passes)
+		void Batch(const entt::registry& registry, bool meshOnly);
+
+		const std::vector<Item>& GetItems() const { return m_items; }
+		const std::vector<DrawBatch>& GetBatches() const { return m_batches; }
+		bool Empty() const { return m_items.empty(); }
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		static constexpr size_t s_parallelThreshold = 16384;
+		static constexpr uint32_t s_maxThreads = 8;
+
+		std::vector<Item> m_items;
+		std::vector<DrawBatch> m_batches;
+		std::vector<Item> m_scratch;
+		std::vector<std::array<uint32_t, 256>> m_histograms; // per thread
+
+		Stats m_stats = {};
+		uint32_t m_culled = 0;
+	};
+
+	// binds vertex/index buffers, topology, material textures and material constants of a draw. consecutive draws of a
+	// sorted list mostly share them, the StateCache skips what is already bound
+	void BindDrawResources(GDX11::GDX11Context* context, const MeshComponent& mesh, const MaterialCache::Material& mat, GDX11::PixelShader* ps);
+}
@@ -0,0 +1,89 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GA
+{
+	DynamicResolution::DynamicResolution()
+		: DynamicResolution(Desc())
+	{
+	}
+
+	DynamicResolution::DynamicResolution(const Desc& desc)
+		: m_desc(desc), m_enabled(true), m_integral(0.0f), m_cooldown(0), m_hasHistory(false), m_stats()
+	{
+		Reset();
+	}
+
+	void DynamicResolution::SetDesc(const Desc& desc)
+	{
+		m_desc = desc;
+		m_stats.scale = Snap(m_stats.scale);
+	}
+
+	void DynamicResolution::SetEnabled(bool enabled)
+	{
+		if (m_enabled == enabled) return;
+
+		m_enabled = enabled;
+		Reset();
+	}
+
+	float DynamicResolution::Update(float frameMs)
+	{
+		if (!m_enabled)
+			return m_stats.scale;
+
+		if (m_hasHistory)
+			m_stats.frameMs += m_desc.smoothing * (frameMs - m_stats.frameMs);
+		else
+			m_stats.frameMs = frameMs;
+		m_hasHistory = true;
+
+		if (m_cooldown > 0)
+		{
+			--m_cooldown;
+			return m_stats.scale;
+		}
+
+		// positive with headroom, negative when late
+		float error = (m_desc.targetMs - m_stats.frameMs) / m_desc.targetMs;
+		if (error >= -m_desc.lowerBand && error <= m_desc.upperBand)
+		{
+			m_integral *= 0.5f;
+			return m_stats.scale;
+		}
+
+		// the integral only pushes the way the error points
+		if ((error > 0.0f) != (m_integral > 0.0f))
+			m_integral = 0.0f;
+		m_integral = std::clamp(m_integral + error, -4.0f, 4.0f);
+
+		float pixelRatio = std::max(1.0f + m_desc.kp * error + m_desc.ki * m_integral, 0.25f);
+		float scale = Snap(m_stats.scale * std::sqrt(pixelRatio));
+		if (scale != m_stats.scale)
+		{
+			m_stats.scale = scale;
+			++m_stats.changes;
+			m_cooldown = m_desc.cooldownFrames;
+		}
+
+		return m_stats.scale;
+	}
+
+	void DynamicResolution::Reset()
+	{
+		m_integral = 0.0f;
+		m_cooldown = 0;
+		m_hasHistory = false;
+		m_stats.frameMs = 0.0f;
+		m_stats.scale = Snap(m_desc.maxScale);
+	}
+
+	float DynamicResolution::Snap(float scale) const
+	{
+		if (m_desc.scaleStep > 0.0f)
+			scale = std::round(scale / m_desc.scaleStep) * m_desc.scaleStep;
+		return std::clamp(scale, m_desc.minScale, m_desc.maxScale);
+	}
+}
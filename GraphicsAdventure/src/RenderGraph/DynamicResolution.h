@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+
+namespace GA
+{
+	// Picks the scale the scene is rendered at from measured frame times, nothing in here touches the gpu so it can be
+	// fed any trace. the smoothed frame time is compared to the target, outside the band around it a pi controller moves
+	// the scale. shading cost goes with the pixel count, so the error is applied to scale squared. the band is wider
+	// above the target than below, the scale drops as soon as frames run late but only rises with clear headroom.
+	// after every change the controller waits cooldownFrames for the new cost to show up in the average
+	class DynamicResolution
+	{
+	public:
+		struct Desc
+		{
+			float targetMs = 14.0f;     // a bit under the refresh interval, present and the cpu need the rest
+			float minScale = 0.5f;
+			float maxScale = 1.0f;
+			float smoothing = 0.1f;     // weight of a new frame in the average
+			float lowerBand = 0.05f;    // fraction of targetMs over the target the average may run
+			float upperBand = 0.15f;    // headroom needed before the scale rises
+			float kp = 0.6f;
+			float ki = 0.05f;
+			float scaleStep = 1.0f / 64.0f; // scales are snapped to this so small changes don't reallocate viewports every frame
+			uint32_t cooldownFrames = 10;
+		};
+
+		struct Stats
+		{
+			float frameMs; // smoothed
+			float scale;
+			uint32_t changes;
+		};
+
+		DynamicResolution();
+		DynamicResolution(const Desc& desc);
+
+		void SetDesc(const Desc& desc);
+		const Desc& GetDesc() const { return m_desc; }
+
+		void SetEnabled(bool enabled);
+		bool IsEnabled() const { return m_enabled; }
+
+		// once per frame with the time the frame took, returns the scale of the next frame
+		float Update(float frameMs);
+		// back to maxScale with no history
+		void Reset();
+
+		float GetScale() const { return m_stats.scale; }
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		float Snap(float scale) const;
+
+		Desc m_desc;
+		bool m_enabled;
+		float m_integral;
+		uint32_t m_cooldown;
+		bool m_hasHistory;
+
+		Stats m_stats;
+	};
+}
@@ -0,0 +1,442 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace GDX11;
+
+namespace GA
+{
+	static void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		// fnv-1a
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+	}
+
+	bool FrameTextureDesc::operator==(const FrameTextureDesc& rhs) const
+	{
+		return width == rhs.width && height == rhs.height && arraySize == rhs.arraySize && format == rhs.format && bindFlags == rhs.bindFlags;
+	}
+
+	FrameResource FrameGraphBuilder::Create(const char* name, const FrameTextureDesc& desc)
+	{
+		FrameGraph::Resource res = {};
+		res.name = name;
+		res.desc = desc;
+		res.desc.width = FrameGraph::SizeClass(desc.width);
+		res.desc.height = FrameGraph::SizeClass(desc.height);
+		res.imported = false;
+		res.physical = FrameGraph::s_invalid;
+		m_graph->m_resources.push_back(res);
+		return (FrameResource)m_graph->m_resources.size() - 1;
+	}
+
+	void FrameGraphBuilder::Read(FrameResource res)
+	{
+		GDX11_ASSERT(res < m_graph->m_resources.size(), "Invalid frame resource");
+		m_graph->m_passes[m_pass].reads.push_back(res);
+	}
+
+	void FrameGraphBuilder::Write(FrameResource res)
+	{
+		GDX11_ASSERT(res < m_graph->m_resources.size(), "Invalid frame resource");
+		m_graph->m_passes[m_pass].writes.push_back(res);
+	}
+
+	void FrameGraphBuilder::SideEffect()
+	{
+		m_graph->m_passes[m_pass].sideEffect = true;
+	}
+
+	FrameGraph::FrameGraph(GDX11Context* context)
+		: m_context(context), m_resources(), m_passes(), m_physical(), m_planHash(0), m_plan(), m_planCulled(), m_frame(0), m_stats()
+	{
+	}
+
+	void FrameGraph::Reset()
+	{
+		m_resources.clear();
+		m_passes.clear();
+	}
+
+	FrameResource FrameGraph::Import(const char* name, const ImportedViews& views)
+	{
+		Resource res = {};
+		res.name = name;
+		res.imported = true;
+		res.views = views;
+		res.physical = s_invalid;
+		m_resources.push_back(res);
+		return (FrameResource)m_resources.size() - 1;
+	}
+
+	void FrameGraph::AddPass(const char* name, const Setup& setup, Execute execute)
+	{
+		Pass pass = {};
+		pass.name = name;
+		pass.execute = std::move(execute);
+		m_passes.push_back(std::move(pass));
+
+		FrameGraphBuilder builder(this, (uint32_t)m_passes.size() - 1);
+		setup(builder);
+	}
+
+	void FrameGraph::Run()
+	{
+		++m_frame;
+
+		uint64_t hash = HashTopology();
+		if (hash != m_planHash || m_plan.size() != m_resources.size())
+		{
+			Compile();
+			m_planHash = hash;
+		}
+		else
+		{
+			for (uint32_t i = 0; i < (uint32_t)m_passes.size(); i++)
+				m_passes[i].culled = m_planCulled[i];
+			for (uint32_t i = 0; i < (uint32_t)m_resources.size(); i++)
+				m_resources[i].physical = m_plan[i];
+		}
+
+		for (const auto& res : m_resources)
+		{
+			if (res.physical != s_invalid)
+				m_physical[res.physical].lastUsed = m_frame;
+		}
+
+		for (const auto& pass : m_passes)
+		{
+			if (pass.culled) continue;
+
+			m_context->Marker(pass.name);
+			pass.execute(*this);
+		}
+
+		// sizes nobody asked for in a while, a resize or a pass that stopped running
+		for (auto& physical : m_physical)
+		{
+			if (m_frame - physical.lastUsed > s_retireFrames)
+				physical.views = {};
+		}
+	}
+
+	const std::shared_ptr<RenderTargetView>& FrameGraph::GetRTV(FrameResource res) const
+	{
+		const auto& r = m_resources[res];
+		const auto& views = r.imported ? r.views : m_physical[r.physical].views;
+		GDX11_ASSERT(views.rtv, "Frame resource has no render target view");
+		return views.rtv;
+	}
+
+	const std::shared_ptr<DepthStencilView>& FrameGraph::GetDSV(FrameResource res) const
+	{
+		const auto& r = m_resources[res];
+		const auto& views = r.imported ? r.views : m_physical[r.physical].views;
+		GDX11_ASSERT(views.dsv, "Frame resource has no depth stencil view");
+		return views.dsv;
+	}
+
+	const std::shared_ptr<ShaderResourceView>& FrameGraph::GetSRV(FrameResource res) const
+	{
+		const auto& r = m_resources[res];
+		const auto& views = r.imported ? r.views : m_physical[r.physical].views;
+		GDX11_ASSERT(views.srv, "Frame resource has no shader resource view");
+		return views.srv;
+	}
+
+	uint64_t FrameGraph::HashTopology() const
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (const auto& res : m_resources)
+		{
+			HashBytes(hash, &res.imported, sizeof(bool));
+			if (res.imported) continue;
+
+			HashBytes(hash, &res.desc.width, sizeof(uint32_t));
+			HashBytes(hash, &res.desc.height, sizeof(uint32_t));
+			HashBytes(hash, &res.desc.arraySize, sizeof(uint32_t));
+			HashBytes(hash, &res.desc.format, sizeof(DXGI_FORMAT));
+			HashBytes(hash, &res.desc.bindFlags, sizeof(uint32_t));
+		}
+
+		for (const auto& pass : m_passes)
+		{
+			HashBytes(hash, pass.name, strlen(pass.name));
+			HashBytes(hash, &pass.sideEffect, sizeof(bool));
+			uint32_t counts[2] = { (uint32_t)pass.reads.size(), (uint32_t)pass.writes.size() };
+			HashBytes(hash, counts, sizeof(counts));
+			HashBytes(hash, pass.reads.data(), pass.reads.size() * sizeof(FrameResource));
+			HashBytes(hash, pass.writes.data(), pass.writes.size() * sizeof(FrameResource));
+		}
+
+		return hash;
+	}
+
+	void FrameGraph::Compile()
+	{
+		// back to front, a pass runs if its output escapes the graph or a running pass after it reads what it writes.
+		// a write the pass doesn't also read replaces the contents, passes before it can't contribute through that resource
+		std::vector<bool> needed(m_resources.size(), false);
+		for (uint32_t i = (uint32_t)m_passes.size(); i-- > 0;)
+		{
+			auto& pass = m_passes[i];
+
+			bool live = pass.sideEffect;
+			for (auto res : pass.writes)
+				live |= m_resources[res].imported || needed[res];
+
+			pass.culled = !live;
+			if (!live) continue;
+
+			for (auto res : pass.writes)
+			{
+				if (std::find(pass.reads.begin(), pass.reads.end(), res) == pass.reads.end())
+					needed[res] = false;
+			}
+			for (auto res : pass.reads)
+				needed[res] = true;
+		}
+
+		// lifetimes over the passes that run
+		for (auto& res : m_resources)
+		{
+			res.first = s_invalid;
+			res.last = 0;
+			res.physical = s_invalid;
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)m_passes.size(); i++)
+		{
+			const auto& pass = m_passes[i];
+			if (pass.culled) continue;
+
+			auto use = [&](FrameResource r)
+			{
+				auto& res = m_resources[r];
+				res.first = std::min(res.first, i);
+				res.last = std::max(res.last, i);
+			};
+
+			for (auto r : pass.reads) use(r);
+			for (auto r : pass.writes) use(r);
+		}
+
+		// earliest first, each takes the first physical texture of its desc that is free by then
+		std::vector<uint32_t> order;
+		for (uint32_t i = 0; i < (uint32_t)m_resources.size(); i++)
+		{
+			if (!m_resources[i].imported && m_resources[i].first != s_invalid)
+				order.push_back(i);
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return m_resources[a].first < m_resources[b].first; });
+
+		for (auto& physical : m_physical)
+			physical.busyUntil = s_invalid;
+
+		for (auto i : order)
+		{
+			auto& res = m_resources[i];
+			res.physical = Allocate(res.desc, res.first, res.last);
+		}
+
+		m_stats.passes = 0;
+		m_stats.culled = 0;
+		for (const auto& pass : m_passes)
+		{
+			++m_stats.passes;
+			m_stats.culled += pass.culled ? 1 : 0;
+		}
+
+		m_stats.transients = 0;
+		m_stats.transientBytes = 0;
+		for (const auto& res : m_resources)
+		{
+			if (res.imported || res.first == s_invalid) continue;
+
+			++m_stats.transients;
+			m_stats.transientBytes += GetBytes(res.desc);
+		}
+
+		m_stats.physical = 0;
+		m_stats.physicalBytes = 0;
+		for (const auto& physical : m_physical)
+		{
+			if (physical.busyUntil == s_invalid) continue;
+
+			++m_stats.physical;
+			m_stats.physicalBytes += GetBytes(physical.desc);
+		}
+		++m_stats.compiles;
+
+		m_plan.resize(m_resources.size());
+		for (uint32_t i = 0; i < (uint32_t)m_resources.size(); i++)
+			m_plan[i] = m_resources[i].physical;
+
+		m_planCulled.resize(m_passes.size());
+		for (uint32_t i = 0; i < (uint32_t)m_passes.size(); i++)
+			m_planCulled[i] = m_passes[i].culled;
+	}
+
+	uint32_t FrameGraph::Allocate(const FrameTextureDesc& desc, uint32_t first, uint32_t last)
+	{
+		// a texture that still exists is preferred over recreating a released one
+		uint32_t released = s_invalid;
+		for (uint32_t i = 0; i < (uint32_t)m_physical.size(); i++)
+		{
+			auto& physical = m_physical[i];
+			bool free = physical.busyUntil == s_invalid || physical.busyUntil < first;
+			if (!free) continue;
+
+			if (!physical.views.rtv && !physical.views.dsv && !physical.views.srv)
+			{
+				if (released == s_invalid && physical.busyUntil == s_invalid)
+					released = i;
+				continue;
+			}
+
+			if (physical.desc == desc)
+			{
+				physical.busyUntil = last;
+				return i;
+			}
+		}
+
+		if (released == s_invalid)
+		{
+			released = (uint32_t)m_physical.size();
+			m_physical.emplace_back();
+		}
+
+		auto& physical = m_physical[released];
+		physical.desc = desc;
+		physical.views = CreateViews(desc);
+		physical.lastUsed = m_frame;
+		physical.busyUntil = last;
+		return released;
+	}
+
+	FrameGraph::ImportedViews FrameGraph::CreateViews(const FrameTextureDesc& desc) const
+	{
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = desc.width;
+		texDesc.Height = desc.height;
+		texDesc.ArraySize = desc.arraySize;
+		texDesc.MipLevels = 1;
+		texDesc.Format = desc.format;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = desc.bindFlags;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = 0;
+		auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
+
+		bool array = desc.arraySize > 1;
+		bool typelessDepth = desc.format == DXGI_FORMAT_R32_TYPELESS;
+
+		ImportedViews views = {};
+		if (desc.bindFlags & D3D11_BIND_RENDER_TARGET)
+		{
+			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+			rtvDesc.Format = desc.format;
+			if (array)
+			{
+				rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+				rtvDesc.Texture2DArray.ArraySize = desc.arraySize;
+				rtvDesc.Texture2DArray.FirstArraySlice = 0;
+				rtvDesc.Texture2DArray.MipSlice = 0;
+			}
+			else
+			{
+				rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+				rtvDesc.Texture2D.MipSlice = 0;
+			}
+			views.rtv = RenderTargetView::Create(m_context, rtvDesc, tex);
+		}
+
+		if (desc.bindFlags & D3D11_BIND_DEPTH_STENCIL)
+		{
+			D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+			dsvDesc.Format = typelessDepth ? DXGI_FORMAT_D32_FLOAT : desc.format;
+			if (array)
+			{
+				dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+				dsvDesc.Texture2DArray.ArraySize = desc.arraySize;
+				dsvDesc.Texture2DArray.FirstArraySlice = 0;
+				dsvDesc.Texture2DArray.MipSlice = 0;
+			}
+			else
+			{
+				dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+				dsvDesc.Texture2D.MipSlice = 0;
+			}
+			views.dsv = DepthStencilView::Create(m_context, dsvDesc, tex);
+		}
+
+		if (desc.bindFlags & D3D11_BIND_SHADER_RESOURCE)
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = typelessDepth ? DXGI_FORMAT_R32_FLOAT : desc.format;
+			if (array)
+			{
+				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+				srvDesc.Texture2DArray.ArraySize = desc.arraySize;
+				srvDesc.Texture2DArray.FirstArraySlice = 0;
+				srvDesc.Texture2DArray.MipLevels = 1;
+				srvDesc.Texture2DArray.MostDetailedMip = 0;
+			}
+			else
+			{
+				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+				srvDesc.Texture2D.MipLevels = 1;
+				srvDesc.Texture2D.MostDetailedMip = 0;
+			}
+			views.srv = ShaderResourceView::Create(m_context, srvDesc, tex);
+		}
+
+		return views;
+	}
+
+	uint32_t FrameGraph::SizeClass(uint32_t size)
+	{
+		// steps of an eighth of the power of two below, never more than 1/8 wasted
+		uint32_t pow2 = 1;
+		while (pow2 * 2 <= size)
+			pow2 *= 2;
+
+		uint32_t step = std::max(pow2 / 8, 1u);
+		return (size + step - 1) / step * step;
+	}
+
+	uint64_t FrameGraph::GetBytes(const FrameTextureDesc& desc)
+	{
+		uint64_t texel;
+		switch (desc.format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			texel = 16;
+			break;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R32G32_FLOAT:
+			texel = 8;
+			break;
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+			texel = 2;
+			break;
+		case DXGI_FORMAT_R8_UNORM:
+			texel = 1;
+			break;
+		default:
+			texel = 4;
+			break;
+		}
+
+		return texel * desc.width * desc.height * desc.arraySize;
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include <GDX11.h>
+
+namespace GA
+{
+	// Virtual texture of a FrameGraph, only valid for the frame that declared it
+	using FrameResource = uint32_t;
+
+	struct FrameTextureDesc
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t arraySize;
+		DXGI_FORMAT format; // R32_TYPELESS gets D32_FLOAT depth views and R32_FLOAT shader views
+		uint32_t bindFlags;
+
+		bool operator==(const FrameTextureDesc& rhs) const;
+	};
+
+	class FrameGraphBuilder;
+
+	// Passes are declared every frame with the virtual textures they read and write, then run in declaration order.
+	// transients are allocated in size classes, 8 per power of two, so resizing the window only recreates them when a
+	// dimension leaves its class. passes render into the requested size with the viewport and scale uvs by requested / allocated.
+	// a pass only runs if it writes an imported texture, is marked as a side effect or writes something a later running
+	// pass reads. transient textures live from their first to their last use and share a physical texture with any other
+	// transient of the same desc whose lifetime doesn't overlap. d3d11 has no placed resources, so only identical descs alias.
+	// transients hold garbage when their first pass starts, that pass has to clear or overwrite them.
+	// the compiled plan is kept while passes, accesses and descs hash the same
+	class FrameGraph
+	{
+	public:
+		using Setup = std::function<void(FrameGraphBuilder&)>;
+		using Execute = std::function<void(const FrameGraph&)>;
+
+		// views of a texture that lives outside the graph, any of them may be null
+		struct ImportedViews
+		{
+			std::shared_ptr<GDX11::RenderTargetView> rtv;
+			std::shared_ptr<GDX11::DepthStencilView> dsv;
+			std::shared_ptr<GDX11::ShaderResourceView> srv;
+		};
+
+		struct Stats
+		{
+			uint32_t passes;
+			uint32_t culled;
+			uint32_t transients;     // used by passes that run
+			uint32_t physical;       // textures backing the transients
+			uint64_t transientBytes; // if every transient had a texture of its own
+			uint64_t physicalBytes;
+			uint32_t compiles;
+		};
+
+		FrameGraph(GDX11::GDX11Context* context);
+
+		FrameGraph(const FrameGraph&) = delete;
+		FrameGraph& operator=(const FrameGraph&) = delete;
+
+		// drops the passes and resources declared last frame
+		void Reset();
+
+		FrameResource Import(const char* name, const ImportedViews& views);
+		// setup runs right away, execute when the graph does
+		void AddPass(const char* name, const Setup& setup, Execute execute);
+
+		// compiles if the topology changed, then runs the passes that weren't culled
+		void Run();
+
+		// allocated size of a transient, at least the requested one
+		const FrameTextureDesc& GetDesc(FrameResource res) const { return m_resources[res].desc; }
+
+		// valid inside an Execute
+		const std::shared_ptr<GDX11::RenderTargetView>& GetRTV(FrameResource res) const;
+		const std::shared_ptr<GDX11::DepthStencilView>& GetDSV(FrameResource res) const;
+		const std::shared_ptr<GDX11::ShaderResourceView>& GetSRV(FrameResource res) const;
+
+		template<typename F>
+		void ForEachPass(F&& f) const
+		{
+			for (const auto& pass : m_passes)
+				f(pass.name, pass.culled);
+		}
+
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		friend class FrameGraphBuilder;
+
+		static constexpr uint32_t s_invalid = ~0u;
+		// physical textures no plan used for this many frames are released
+		static constexpr uint32_t s_retireFrames = 120;
+
+		struct Resource
+		{
+			const char* name;
+			FrameTextureDesc desc;
+			bool imported;
+			ImportedViews views; // imported only
+			uint32_t first;      // live passes using it
+			uint32_t last;
+			uint32_t physical;
+		};
+
+		struct Pass
+		{
+			const char* name;
+			std::vector<FrameResource> reads;
+			std::vector<FrameResource> writes;
+			bool sideEffect;
+			Execute execute;
+			bool culled;
+		};
+
+		struct Physical
+		{
+			FrameTextureDesc desc;
+			ImportedViews views; // empty once released
+			uint64_t lastUsed;
+			uint32_t busyUntil;  // last pass using it in the plan being compiled
+		};
+
+		uint64_t HashTopology() const;
+		void Compile();
+		uint32_t Allocate(const FrameTextureDesc& desc, uint32_t first, uint32_t last);
+		ImportedViews CreateViews(const FrameTextureDesc& desc) const;
+
+		static uint32_t SizeClass(uint32_t size);
+		static uint64_t GetBytes(const FrameTextureDesc& desc);
+
+		GDX11::GDX11Context* m_context;
+		std::vector<Resource> m_resources;
+		std::vector<Pass> m_passes;
+		std::vector<Physical> m_physical;
+		uint64_t m_planHash;
+		std::vector<uint32_t> m_plan; // physical texture per resource, kept with the hash
+		std::vector<bool> m_planCulled;
+		uint64_t m_frame;
+		Stats m_stats;
+	};
+
+	// What a pass declares in its setup
+	class FrameGraphBuilder
+	{
+	public:
+		FrameResource Create(const char* name, const FrameTextureDesc& desc);
+		void Read(FrameResource res);
+		void Write(FrameResource res);
+		// effects outside the graph, persistent caches or readbacks. never culled
+		void SideEffect();
+
+	private:
+		friend class FrameGraph;
+
+		FrameGraphBuilder(FrameGraph* graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+		FrameGraph* m_graph;
+		uint32_t m_pass;
+	};
+}
@@ -0,0 +1,88 @@
+#include "GpuFrameTimer.h"
+
+using namespace GDX11;
+
+namespace GA
+{
+	GpuFrameTimer::GpuFrameTimer(GDX11Context* context)
+		: m_context(context), m_frames(), m_frame(0), m_measuring(false), m_newResult(false), m_lastMs(0.0f)
+	{
+		D3D11_QUERY_DESC disjointDesc = {};
+		disjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+		disjointDesc.MiscFlags = 0;
+
+		D3D11_QUERY_DESC timestampDesc = {};
+		timestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+		timestampDesc.MiscFlags = 0;
+
+		HRESULT hr;
+		for (auto& f : m_frames)
+		{
+			GDX11_CONTEXT_THROW_INFO(m_context->GetDevice()->CreateQuery(&disjointDesc, &f.disjoint));
+			GDX11_CONTEXT_THROW_INFO(m_context->GetDevice()->CreateQuery(&timestampDesc, &f.begin));
+			GDX11_CONTEXT_THROW_INFO(m_context->GetDevice()->CreateQuery(&timestampDesc, &f.end));
+		}
+	}
+
+	void GpuFrameTimer::Begin()
+	{
+		ReadResults();
+		++m_frame;
+
+		// all queries still in flight, this frame goes unmeasured
+		auto& f = m_frames[m_frame % s_latency];
+		m_measuring = !f.pending;
+		if (!m_measuring) return;
+
+		m_context->GetDeviceContext()->Begin(f.disjoint.Get());
+		m_context->GetDeviceContext()->End(f.begin.Get());
+	}
+
+	void GpuFrameTimer::End()
+	{
+		if (!m_measuring) return;
+
+		auto& f = m_frames[m_frame % s_latency];
+		m_context->GetDeviceContext()->End(f.end.Get());
+		m_context->GetDeviceContext()->End(f.disjoint.Get());
+		f.pending = true;
+		m_measuring = false;
+	}
+
+	bool GpuFrameTimer::GetNewResult(float& ms)
+	{
+		ReadResults();
+		ms = m_lastMs;
+
+		bool newResult = m_newResult;
+		m_newResult = false;
+		return newResult;
+	}
+
+	void GpuFrameTimer::ReadResults()
+	{
+		// oldest first so the last result kept is the newest
+		for (uint32_t i = 1; i <= s_latency; i++)
+		{
+			auto& f = m_frames[(m_frame + i) % s_latency];
+			if (!f.pending) continue;
+
+			auto deviceContext = m_context->GetDeviceContext();
+			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint = {};
+			UINT64 begin = 0;
+			UINT64 end = 0;
+			if (deviceContext->GetData(f.disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+				deviceContext->GetData(f.begin.Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+				deviceContext->GetData(f.end.Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				continue;
+
+			f.pending = false;
+
+			// the clock changed frequency in between, the timestamps mean nothing
+			if (disjoint.Disjoint || disjoint.Frequency == 0) continue;
+
+			m_lastMs = (float)((double)(end - begin) / (double)disjoint.Frequency * 1000.0);
+			m_newResult = true;
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <GDX11.h>
+#include <wrl.h>
+
+namespace GA
+{
+	// Gpu time between Begin and End measured with timestamp queries. with vsync the cpu frame time sticks to the refresh
+	// interval whatever the gpu does, this is what the frame actually cost. results arrive a few frames late
+	class GpuFrameTimer
+	{
+	public:
+		GpuFrameTimer(GDX11::GDX11Context* context);
+
+		void Begin();
+		void End();
+
+		// true if a measured frame finished since the last call, ms is the newest of them
+		bool GetNewResult(float& ms);
+
+	private:
+		static constexpr uint32_t s_latency = 3;
+
+		struct Frame
+		{
+			Microsoft::WRL::ComPtr<ID3D11Query> disjoint;
+			Microsoft::WRL::ComPtr<ID3D11Query> begin;
+			Microsoft::WRL::ComPtr<ID3D11Query> end;
+			bool pending = false;
+		};
+
+		void ReadResults();
+
+		GDX11::GDX11Context* m_context;
+		std::array<Frame, s_latency> m_frames;
+		uint64_t m_frame;
+		bool m_measuring;
+		bool m_newResult;
+		float m_lastMs;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <GDX11.h>
+
+namespace GA
+{
+	// Per instance data of a pass in a dynamic structured buffer. Instances are collected on the cpu
+	// and uploaded with a single map, the buffer grows to the largest instance count seen
+	template<typename T>
+	class InstanceBuffer
+	{
+		static_assert(sizeof(T) % 4 == 0, "structured buffer stride has to be a multiple of 4");
+
+	public:
+		InstanceBuffer(GDX11::GDX11Context* context)
+			: m_context(context)
+		{
+		}
+
+		void Clear() { m_instances.clear(); }
+		void Push(const T& instance) { m_instances.push_back(instance); }
+		uint32_t Size() const { return (uint32_t)m_instances.size(); }
+
+		void Upload()
+		{
+			if (m_instances.empty()) return;
+
+			if (!m_buffer || m_buffer->GetDesc().ByteWidth < Size() * sizeof(T))
+				Resize(Size());
+
+			m_buffer->SetData(m_instances.data(), Size() * sizeof(T));
+		}
+
+		void VSBind(uint32_t slot) const { if (m_srv) m_srv->VSBind(slot); }
+		void PSBind(uint32_t slot) const { if (m_srv) m_srv->PSBind(slot); }
+		// null before the first upload
+		ID3D11ShaderResourceView* GetNativeSRV() const { return m_srv ? m_srv->GetNative() : nullptr; }
+
+	private:
+		void Resize(uint32_t count)
+		{
+			uint32_t capacity = 64;
+			while (capacity < count)
+				capacity *= 2;
+
+			D3D11_BUFFER_DESC desc = {};
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			desc.Usage = D3D11_USAGE_DYNAMIC;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+			desc.ByteWidth = capacity * sizeof(T);
+			desc.StructureByteStride = sizeof(T);
+			m_buffer = GDX11::Buffer::Create(m_context, desc, nullptr);
+
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+			srvDesc.Buffer.FirstElement = 0;
+			srvDesc.Buffer.NumElements = capacity;
+			m_srv = GDX11::ShaderResourceView::Create(m_context, srvDesc, m_buffer);
+		}
+
+		GDX11::GDX11Context* m_context;
+		std::vector<T> m_instances;
+		std::shared_ptr<GDX11::Buffer> m_buffer;
+		std::shared_ptr<GDX11::ShaderResourceView> m_srv;
+	};
+}
@@ -4,6 +4,11 @@
 #include "Utils/ShaderCBuf.h"
 #include "Scene/Components.h"
 #include "Utils/Macros.h"
+#include "RenderGraph/ShaderBindingIds.h"
+#include "Core/Time.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
 
 using namespace DirectX;
 using namespace GDX11;
@@ -14,26 +19,18 @@ using namespace Microsoft::WRL;
 // ------------ keys -------------
 
 #define RTV_MAIN                            "main"
-#define RTV_SCENE                           "scene"
-#define SRV_SCENE                           "scene"
-#define DSV_SCENE                           "scene"
-#define RTVA_TRANSPARENT_PHONG_PASS         "transparent_phong_pass"
-#define SRV_TRANSPARENT_PHONG_PASS_ACC      "transparent_phong_pass_accumulation"
-#define SRV_TRANSPARENT_PHONG_PASS_REV      "transparent_phong_pass_reveal"
+#define RTV_MAIN_SRGB                       "main_srgb"
 
 
 #define VS_PHONG                            "phong" 
 #define VS_SKYBOX                           "skybox"
-#define VS_FS_OUT_TC_POS                    "fullscreen_out_tc_pos"
-#define VS_FS_OUT_POS                       "fullscreen_out_pos"
 #define VS_BASIC                            "basic"
 #define VS_CUBE_SHADOW_MAP                  "cube_shadow_map"
+#define VS_DEPTH_PREPASS                    "depth_prepass"
 								            
 #define PS_PHONG                            "phong"
 #define PS_PHONG_OIT                        "phong_oit"
 #define PS_SKYBOX                           "skybox"
-#define PS_PHONG_OIT_COMPOSITE              "phong_oit_composite"
-#define PS_GAMMA_CORRECTION                 "gamma_correction"
 #define PS_NULLPTR                          "null"
 								            
 #define GS_CUBE_SHADOW_MAP                  "cube_shadow_map"
@@ -41,81 +38,253 @@ using namespace Microsoft::WRL;
 
 #define IL_PHONG                            "phong"
 #define IL_SKYBOX                           "skybox"
-#define IL_FS_OUT_TC_POS                    "fullscreen_out_tc_pos"
-#define IL_FS_OUT_POS                       "fullscreen_out_pos"
 #define IL_BASIC                            "basic"
 #define IL_CUBE_SHADOW_MAP                  "cube_shadow_map"
+#define IL_DEPTH_PREPASS                    "depth_prepass"
 
 #define S_DEFAULT                           "default"
 
 #define RS_CULL_NONE                        "cull_none"
 #define RS_DEPTH_SLOPE_SCALED_BIAS          "depth_slope_scaled_bias"
-#define BS_OVER_OP                          "over_op"
 #define BS_WEIGHTED_BLENDED_OIT_OP          "weighted_blended_oit_op"
 #define DSS_DEPTH_WRITE_ZERO                "depth_write_zero"
 #define DSS_DEPTH_WRITE_ZERO_OP_LESS_EQUAL  "depth_write_zero_op_less_equal"
+#define DSS_DEPTH_WRITE_ZERO_OP_EQUAL       "depth_write_zero_op_equal"
 #define SS_POINT_CLAMP                      "point_clamp"
 #define SS_LINEAR_CLAMP                     "linear_clamp"
 
-#define VB_FS_QUAD                          "fs_quad.vb"
-#define IB_FS_QUAD                          "fs_quad.ib"
+#define PSO_SOLID_PHONG                     "solid_phong"
+#define PSO_SOLID_PHONG_EQUAL               "solid_phong_equal"
+#define PSO_DEPTH_PREPASS                   "depth_prepass"
+#define PSO_SKYBOX                          "skybox"
+#define PSO_TRANSPARENT_PHONG               "transparent_phong"
+#define PSO_SHADOW_MAP                      "shadow_map"
+#define PSO_CUBE_SHADOW_MAP                 "cube_shadow_map"
+
 #define VB_CUBE                             "cube.vb"
 #define IB_CUBE                             "cube.ib"
 
 #define CB_VS_PHONG_SYSTEM                  "phong.vs.SystemCBuf"
-#define CB_VS_PHONG_ENTITY                  "phong.vs.EntityCBuf"
 #define CB_PS_PHONG_SYSTEM                  "phong.ps.SystemCBuf"
-#define CB_PS_PHONG_ENTITY                  "phong.ps.EntityCBuf"
-#define CB_PS_GAMMA_CORRECTION_SYSTEM       "gamma_correction.ps.SystemCBuf"
 #define CB_VS_SKYBOX_SYSTEM                 "skybox.vs.SystemCBuf"
 #define CB_VS_BASIC_SYSTEM                  "basic.vs.SystemCBuf"
-#define CB_VS_BASIC_ENTITY                  "basic.vs.Entity"
-#define CB_VS_CUBE_SHADOW_MAP_ENTITY        "cube_shadow_map.vs.EntityCBuf"
 #define CB_GS_CUBE_SHADOW_MAP_SYSTEM        "cube_shadow_map.gs.SystemCBuf"
+#define CR_INSTANCE                         "instance.ring"
 
 
 #define DSV_DIRLIGHT_SHADOW_MAP(x)          "dirLight_shadow_map" + std::to_string((x))
 #define SRV_DIRLIGHT_SHADOW_MAP             "dirLight_shadow_map"
+#define DSV_DIRLIGHT_STATIC_SHADOW_MAP(x)   "dirLight_static_shadow_map" + std::to_string((x))
+#define TEX_DIRLIGHT_STATIC_SHADOW_MAP      "dirLight_static_shadow_map"
 
 #define DSV_POINTLIGHT_SHADOW_MAP(x)        "pointlight_shadow_map" + std::to_string((x))
 #define SRV_POINTLIGHT_SHADOW_MAP           "pointlight_shadow_map"
+#define DSV_POINTLIGHT_STATIC_SHADOW_MAP(x) "pointlight_static_shadow_map" + std::to_string((x))
+#define TEX_POINTLIGHT_STATIC_SHADOW_MAP    "pointlight_static_shadow_map"
 
 #define DSV_SPOTLIGHT_SHADOW_MAP(x)        "spotlight_shadow_map" + std::to_string((x))
 #define SRV_SPOTLIGHT_SHADOW_MAP           "spotlight_shadow_map"
+#define DSV_SPOTLIGHT_STATIC_SHADOW_MAP(x) "spotlight_static_shadow_map" + std::to_string((x))
+#define TEX_SPOTLIGHT_STATIC_SHADOW_MAP    "spotlight_static_shadow_map"
 
 #define SHADOWMAP_SIZE 2040
+#define CONSTANT_RING_SIZE (1 << 20)
+
+#define DRAW_PASS_SOLID_PHONG               0
+#define DRAW_PASS_TRANSPARENT_PHONG         1
+#define DRAW_PASS_STATIC_CASTERS            2
+#define DRAW_PASS_DYNAMIC_CASTERS           3
+#define DRAW_PASS_DEPTH_PREPASS             4
+
+// estimated triangles that point/spot light shadow updates may rasterize per frame
+#define SHADOW_TRIANGLE_BUDGET              1000000
+
+#define POINTLIGHT_SHADOW_SLOT(x)           (x)
+#define SPOTLIGHT_SHADOW_SLOT(x)            (GA::Utils::s_maxLights + (x))
+#define DIRLIGHT_SHADOW_SLOT(x)             (2 * GA::Utils::s_maxLights + (x))
 
 namespace GA
 {
-	LambertianRenderGraph::LambertianRenderGraph(Scene* scene, GDX11::GDX11Context* context, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight)
-		: System(scene), m_context(context), m_camera(camera)
+	LambertianRenderGraph::LambertianRenderGraph(Scene* scene, GDX11::GDX11Context* context, GA::Utils::SharedResourceCache* shared, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight)
+		: System(scene), m_context(context), m_shared(shared), m_camera(camera), m_frameGraph(context), m_postProcess(context, shared), m_resolutionScale(1.0f), m_renderWidth(0), m_renderHeight(0), m_textures(context), m_materials(context, &m_textures), m_entityInstances(context), m_depthPrepass(context), m_shadowScheduler(2 * GA::Utils::s_maxLights, SHADOW_TRIANGLE_BUDGET), m_casterInstances(context), m_shadowRecordingStats(),
+		m_staticCasterTriangles(0), m_dynamicCasterTriangles(0), m_staticCasterVersion(0), m_shadowSlots(), m_staticShadowCaches()
 	{
 		m_dirLights.connect(GetRegistry(), entt::collector.group<TransformComponent, DirectionalLightComponent>(entt::exclude<>));
 		m_pointLights.connect(GetRegistry(), entt::collector.group<TransformComponent, PointLightComponent>(entt::exclude<>));
 		m_spotLights.connect(GetRegistry(), entt::collector.group<TransformComponent, SpotLightComponent>(entt::exclude<>));
 		m_renderable.connect(GetRegistry(), entt::collector.group<TransformComponent, MeshComponent, MaterialComponent>(entt::exclude<>));
+		m_opaque.connect(GetRegistry(), entt::collector.group<TransformComponent, MeshComponent, MaterialComponent, OpaqueTag>(entt::exclude<>));
+		m_transparent.connect(GetRegistry(), entt::collector.group<TransformComponent, MeshComponent, MaterialComponent, TransparentTag>(entt::exclude<>));
 		m_skybox.connect(GetRegistry(), entt::collector.group<SkyboxComponent>(entt::exclude<>));
 
 		ResizeViews(windowWidth, windowHeight);
 		SetShaders();
 		SetStates();
+		SetPipelineStates();
 		SetBuffers();
 		SetLightDepthBuffers();
 	}
 
 	void LambertianRenderGraph::Execute()
 	{
-		XMFLOAT3 viewPos = m_camera->GetDesc().position;
-		XMFLOAT4X4 viewProj;
-		XMStoreFloat4x4(&viewProj, XMMatrixTranspose(m_camera->GetViewMatrix() * m_camera->GetProjectionMatrix()));
-
-		// set lights and shadow pass
-		SetLights();
-		SolidPhongPass(viewPos, viewProj);
-		SkyboxPass(viewProj);
-		TransparentPhongPass(viewPos, viewProj);
-		CompositePass();
-		GammaCorrectionPass();
+		Execute({ { m_camera, 0, 0, m_windowWidth, m_windowHeight } });
+	}
+
+	void LambertianRenderGraph::Execute(const std::vector<View>& views)
+	{
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		ring->ResetStats();
+		ring->BeginFrame();
+
+		// materials interned last frame and not since go away, so do the ids of meshes no draw asked for
+		m_materials.Sweep();
+		m_meshIds.Sweep();
+
+		// kept until the graph has run, the passes read them
+		m_views.resize(views.size());
+		m_viewPositions.clear();
+		for (size_t v = 0; v < views.size(); v++)
+		{
+			auto& state = m_views[v];
+			const auto* camera = views[v].camera;
+			state.view = views[v];
+			state.index = (uint32_t)v;
+			state.viewPos = camera->GetDesc().position;
+			XMStoreFloat4x4(&state.viewProj, XMMatrixTranspose(camera->GetViewMatrix() * camera->GetProjectionMatrix()));
+			state.renderWidth = std::max((uint32_t)(views[v].width * m_resolutionScale + 0.5f), 1u);
+			state.renderHeight = std::max((uint32_t)(views[v].height * m_resolutionScale + 0.5f), 1u);
+			m_viewPositions.push_back(state.viewPos);
+		}
+
+		// materials, mesh ids and bounds once, every view culls against the same set
+		GatherRenderables(false);
+		GatherRenderables(true);
+
+		// each view measures its own overdraw and decides on its own pre-pass
+		m_depthPrepass.Begin((uint32_t)m_views.size());
+
+		m_frameGraph.Reset();
+
+		// gamma is left to the hardware when the back buffer has an _SRGB view
+		bool srgb = m_resLib.Exist<RenderTargetView>(RTV_MAIN_SRGB);
+		FrameGraph::ImportedViews backbufferViews = {};
+		backbufferViews.rtv = m_resLib.Get<RenderTargetView>(srgb ? RTV_MAIN_SRGB : RTV_MAIN);
+		FrameResource backbuffer = m_frameGraph.Import("main", backbufferViews);
+
+		// the shadow maps are caches kept across frames, the shading passes bind them from the resource library.
+		// imported without views only to order the passes
+		FrameResource shadowMaps = m_frameGraph.Import("shadow_maps", {});
+
+		// set lights and shadow pass, shared by every view
+		m_frameGraph.AddPass("lights",
+			[&](FrameGraphBuilder& builder) { builder.Write(shadowMaps); },
+			[&](const FrameGraph&) { SetLights(); });
+
+		// a view's targets are dead once its post process ran, the next view's targets of the same size alias them
+		for (uint32_t v = 0; v < (uint32_t)m_views.size(); v++)
+		{
+			m_frameGraph.AddPass("solid_phong",
+				[&, v](FrameGraphBuilder& builder)
+				{
+					auto& view = m_views[v];
+					view.scene = builder.Create("scene", { view.view.width, view.view.height, 1, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE });
+					view.depth = builder.Create("scene_depth", { view.view.width, view.view.height, 1, DXGI_FORMAT_D32_FLOAT, D3D11_BIND_DEPTH_STENCIL });
+					builder.Read(shadowMaps);
+					builder.Write(view.scene);
+					builder.Write(view.depth);
+				},
+				[&, v](const FrameGraph& graph) { SolidPhongPass(graph.GetRTV(m_views[v].scene), graph.GetDSV(m_views[v].depth), m_views[v]); });
+
+			if (!m_skybox.empty())
+			{
+				m_frameGraph.AddPass("skybox",
+					[&, v](FrameGraphBuilder& builder)
+					{
+						builder.Read(m_views[v].scene);
+						builder.Read(m_views[v].depth);
+						builder.Write(m_views[v].scene);
+					},
+					[&, v](const FrameGraph& graph)
+					{
+						graph.GetRTV(m_views[v].scene)->Bind(graph.GetDSV(m_views[v].depth).get());
+						SkyboxPass(m_views[v]);
+					});
+			}
+
+			// weighted blended oit targets only exist while there is something transparent
+			if (!m_transparent.empty())
+			{
+				m_frameGraph.AddPass("transparent_phong",
+					[&, v](FrameGraphBuilder& builder)
+					{
+						auto& view = m_views[v];
+						view.accumulation = builder.Create("transparent_phong_pass_accumulation", { view.view.width, view.view.height, 1, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE });
+						view.reveal = builder.Create("transparent_phong_pass_reveal", { view.view.width, view.view.height, 1, DXGI_FORMAT_R8_UNORM, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE });
+						builder.Read(shadowMaps);
+						builder.Read(view.depth);
+						builder.Write(view.accumulation);
+						builder.Write(view.reveal);
+					},
+					[&, v](const FrameGraph& graph)
+					{
+						const auto& view = m_views[v];
+						TransparentPhongPass({ graph.GetRTV(view.accumulation), graph.GetRTV(view.reveal) }, graph.GetDSV(view.depth), view);
+					});
+			}
+
+			// oit resolve and gamma in one full screen draw
+			m_frameGraph.AddPass("post_process",
+				[&, v](FrameGraphBuilder& builder)
+				{
+					const auto& view = m_views[v];
+					builder.Read(view.scene);
+					if (!m_transparent.empty())
+					{
+						builder.Read(view.accumulation);
+						builder.Read(view.reveal);
+					}
+
+					// the rectangles of earlier views stay
+					if (v > 0)
+						builder.Read(backbuffer);
+					builder.Write(backbuffer);
+				},
+				[&, v](const FrameGraph& graph)
+				{
+					const auto& view = m_views[v];
+
+					// views may leave gaps in the window
+					if (v == 0 && m_views.size() > 1)
+						graph.GetRTV(backbuffer)->Clear(0.0f, 0.0f, 0.0f, 0.0f);
+
+					uint32_t ops = srgb ? 0 : PostProcessChain::Gamma;
+					PostProcessChain::Inputs inputs = {};
+					inputs.scene = graph.GetSRV(view.scene);
+					if (!m_transparent.empty())
+					{
+						ops |= PostProcessChain::Composite;
+						inputs.accumulation = graph.GetSRV(view.accumulation);
+						inputs.reveal = graph.GetSRV(view.reveal);
+					}
+
+					D3D11_VIEWPORT vp = {};
+					vp.TopLeftX = (float)view.view.x;
+					vp.TopLeftY = (float)view.view.y;
+					vp.Width = (float)view.view.width;
+					vp.Height = (float)view.view.height;
+					vp.MinDepth = 0.0f;
+					vp.MaxDepth = 1.0f;
+
+					// the scene target is allocated in a size class, only the rendered corner holds the frame
+					const auto& desc = graph.GetDesc(view.scene);
+					m_postProcess.Draw(ops, inputs, graph.GetRTV(backbuffer), vp, { (float)view.renderWidth / desc.width, (float)view.renderHeight / desc.height }, GAMMA);
+				});
+		}
+
+		m_frameGraph.Run();
+
+		// imgui draws into the back buffer next and writes encoded colours
+		m_resLib.Get<RenderTargetView>(RTV_MAIN)->Bind(nullptr);
 	}
 
 	void LambertianRenderGraph::ShadowPass()
@@ -123,796 +292,795 @@ namespace GA
 
 	}
 
-	void LambertianRenderGraph::SolidPhongPass(const DirectX::XMFLOAT3& viewPos, const DirectX::XMFLOAT4X4& viewProj /*column major*/)
+	void LambertianRenderGraph::SolidPhongPass(const std::shared_ptr<RenderTargetView>& rtv, const std::shared_ptr<DepthStencilView>& dsv, const ViewState& view)
 	{
 		D3D11_VIEWPORT vp = {};
 		vp.TopLeftX = 0.0f;
 		vp.TopLeftY = 0.0f;
-		vp.Width = (float)m_windowWidth;
-		vp.Height = (float)m_windowHeight;
+		vp.Width = (float)view.renderWidth;
+		vp.Height = (float)view.renderHeight;
 		vp.MinDepth = 0.0f;
 		vp.MaxDepth = 1.0f;
-		m_context->GetDeviceContext()->RSSetViewports(1, &vp);
+		m_context->GetStateCache().SetViewport(vp);
 
-		auto rtv = m_resLib.Get<RenderTargetView>(RTV_SCENE);
-		auto dsv = m_resLib.Get<DepthStencilView>(DSV_SCENE);
 		rtv->Clear(0.0f, 0.0f, 0.0f, 0.0f);
 		dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
 
-		if (m_renderable.empty()) return;
-
-		m_resLib.Get<RasterizerState>(S_DEFAULT)->Bind();
-		m_resLib.Get<BlendState>(S_DEFAULT)->Bind(nullptr, 0xff);
-		m_resLib.Get<DepthStencilState>(S_DEFAULT)->Bind(0xff);
+		if (m_opaque.empty()) return;
 
 		rtv->Bind(dsv.get());
 
-		auto vs = m_resLib.Get<VertexShader>(VS_PHONG);
-		auto ps = m_resLib.Get<PixelShader>(PS_PHONG);
-		vs->Bind();
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_PHONG)->Bind();
-
-		// system cbufs
-		{
-			m_resLib.Get<Buffer>(CB_PS_PHONG_SYSTEM)->PSBindAsCBuf(ps->GetResBinding("SystemCBuf"));
+		BuildDrawList(m_solidDrawList, DRAW_PASS_SOLID_PHONG, false, view.view.camera);
 
-			GA::Utils::PhongVSSystemCBuf cbufData = {};
-			cbufData.viewPos = viewPos;
-			cbufData.viewProjection = viewProj;
+		GA::Utils::PhongVSSystemCBuf vsCbufData = {};
+		vsCbufData.viewPos = view.viewPos;
+		vsCbufData.viewProjection = view.viewProj;
+		auto vsCbuf = m_resLib.Get<Buffer>(CB_VS_PHONG_SYSTEM);
+		vsCbuf->SetData(&vsCbufData);
 
-			auto cbuf = m_resLib.Get<Buffer>(CB_VS_PHONG_SYSTEM);
-			cbuf->SetData(&cbufData);
-			cbuf->VSBindAsCBuf(vs->GetResBinding("SystemCBuf"));
-		}
-
-		m_resLib.Get<ShaderResourceView>(SRV_DIRLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("dirLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("dirLightShadowMapsSampler"));
-		m_resLib.Get<ShaderResourceView>(SRV_POINTLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("pointLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("pointLightShadowMapsSampler"));
-		m_resLib.Get<ShaderResourceView>(SRV_SPOTLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("spotLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("spotLightShadowMapsSampler"));
-
-		for (const auto& e : m_renderable)
+		// depth first, front to back. the colour pass then only shades the visible surface
+		bool prepass = m_depthPrepass.IsActive(view.index);
+		if (prepass)
 		{
-			const auto& [transform, mesh, mat] = GetRegistry().get<TransformComponent, MeshComponent, MaterialComponent>(e);
+			auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+			m_depthPrepass.Build(GetRegistry(), m_solidDrawList, DRAW_PASS_DEPTH_PREPASS, ring.get(), view.index);
 
-			if (mat.color.w < (1.0f - GA_UTILS_EPSILONF))
-				continue;
-
-			mesh.vb->BindAsVB();
-			mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-
-			mat.diffuseMap->PSBind(ps->GetResBinding("diffuseMap"));
-			mat.samplerState->PSBind(ps->GetResBinding("samplerState"));
-
-			if (mat.normalMap)
-			{
-				mat.normalMap->PSBind(ps->GetResBinding("normalMap"));
-				if (mat.depthMap)
-					mat.depthMap->PSBind(ps->GetResBinding("depthMap"));
-			}
+			auto pso = m_resLib.Get<PipelineState>(PSO_DEPTH_PREPASS);
+			pso->Bind();
+			const auto& vs = pso->GetDesc().vs;
 
-			XMMATRIX xmTransform = transform.GetTransform();
-			XMFLOAT4X4 fTransform;
-			XMFLOAT4X4 normalMatrix;
-			XMStoreFloat4x4(&fTransform, XMMatrixTranspose(xmTransform));
-			XMStoreFloat4x4(&normalMatrix, XMMatrixInverse(nullptr, xmTransform));
+			// viewProjection leads the phong cbuf as well
+			vsCbuf->VSBindAsCBuf(vs->GetBindings().Get(Binding::SystemCBuf));
+			m_depthPrepass.Draw(GetRegistry(), vs, ring.get());
+		}
 
-			// set cbufs
-			{
-				GA::Utils::PhongVSEntityCBuf cbufData = {};
-				cbufData.transform = fTransform;
-				cbufData.normalMatrix = normalMatrix;
+		auto pso = m_resLib.Get<PipelineState>(prepass ? PSO_SOLID_PHONG_EQUAL : PSO_SOLID_PHONG);
+		pso->Bind();
+		const auto& vs = pso->GetDesc().vs;
+		const auto& ps = pso->GetDesc().ps;
 
-				auto cbuf = m_resLib.Get<Buffer>(CB_VS_PHONG_ENTITY);
-				cbuf->SetData(&cbufData);
-				cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-			}
+		// system cbufs
+		m_resLib.Get<Buffer>(CB_PS_PHONG_SYSTEM)->PSBindAsCBuf(ps->GetBindings().Get(Binding::SystemCBuf));
+		vsCbuf->VSBindAsCBuf(vs->GetBindings().Get(Binding::SystemCBuf));
 
-			{
-				GA::Utils::PhongPSEntityCBuf cbufData = {};
-				cbufData.mat.color = mat.color;
-				cbufData.mat.tiling = mat.tiling;
-				cbufData.mat.shininess = mat.shininess;
-				cbufData.mat.enableNormalMapping = mat.normalMap ? TRUE : FALSE;
-				cbufData.mat.enableParallaxMapping = mat.normalMap && mat.depthMap ? TRUE : FALSE;
-				cbufData.mat.depthMapScale = mat.depthMapScale;
-				cbufData.receiveShadows = mesh.receiveShadows;
-
-				auto cbuf = m_resLib.Get<Buffer>(CB_PS_PHONG_ENTITY);
-				cbuf->PSBindAsCBuf(ps->GetResBinding("EntityCBuf"));
-				cbuf->SetData(&cbufData);
-			}
+		BindShadowMaps(ps);
 
-			m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
-			GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
-		}
+		m_depthPrepass.BeginMeasure(view.index);
+		DrawEntityBatches(m_solidDrawList, vs, ps, prepass ? m_resLib.Get<PipelineState>(PSO_SOLID_PHONG) : nullptr);
+		m_depthPrepass.EndMeasure(view.renderWidth * view.renderHeight, view.index);
 	}
 
-	void LambertianRenderGraph::SkyboxPass(const DirectX::XMFLOAT4X4& viewProj /*column major*/)
+	void LambertianRenderGraph::SkyboxPass(const ViewState& view)
 	{
 		if (m_skybox.empty()) return;
 
-		m_resLib.Get<DepthStencilState>(DSS_DEPTH_WRITE_ZERO_OP_LESS_EQUAL)->Bind(0xff);
-		m_resLib.Get<RasterizerState>(RS_CULL_NONE)->Bind();
-
-		auto vs = m_resLib.Get<VertexShader>(VS_SKYBOX);
-		auto ps = m_resLib.Get<PixelShader>(PS_SKYBOX);
-		vs->Bind();
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_SKYBOX)->Bind();
+		auto pso = m_resLib.Get<PipelineState>(PSO_SKYBOX);
+		pso->Bind();
+		const auto& vs = pso->GetDesc().vs;
+		const auto& ps = pso->GetDesc().ps;
 
 		auto cbuf = m_resLib.Get<Buffer>(CB_VS_SKYBOX_SYSTEM);
-		cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-		cbuf->SetData(&viewProj);
+		cbuf->VSBindAsCBuf(vs->GetBindings().Get(Binding::EntityCBuf));
+		cbuf->SetData(&view.viewProj);
 
-		m_resLib.Get<SamplerState>(SS_POINT_CLAMP)->PSBind(ps->GetResBinding("sam"));
-		GetRegistry().get<SkyboxComponent>(*m_skybox.data()).skybox->PSBind(ps->GetResBinding("tex"));
+		m_resLib.Get<SamplerState>(SS_POINT_CLAMP)->PSBind(ps->GetBindings().Get(Binding::sam));
+		GetRegistry().get<SkyboxComponent>(*m_skybox.data()).skybox->PSBind(ps->GetBindings().Get(Binding::tex));
 
 		m_resLib.Get<Buffer>(VB_CUBE)->BindAsVB();
 		auto cbIb = m_resLib.Get<Buffer>(IB_CUBE);
 		cbIb->BindAsIB(DXGI_FORMAT_R32_UINT);
 
-		m_context->GetDeviceContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(cbIb->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+		m_context->GetStateCache().SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		m_context->DrawIndexed(cbIb->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0);
 	}
 
-	void LambertianRenderGraph::TransparentPhongPass(const DirectX::XMFLOAT3& viewPos, const DirectX::XMFLOAT4X4& viewProj /*column major*/)
+	void LambertianRenderGraph::TransparentPhongPass(const RenderTargetViewArray& rtva, const std::shared_ptr<DepthStencilView>& dsv, const ViewState& view)
 	{
-		auto rtva = m_resLib.Get<RenderTargetViewArray>(RTVA_TRANSPARENT_PHONG_PASS);
-		auto dsv = m_resLib.Get<DepthStencilView>(DSV_SCENE);
-		rtva->at(0)->Clear(0.0f, 0.0f, 0.0f, 0.0f); // accumulation
-		rtva->at(1)->Clear(1.0f, 1.0f, 1.0f, 1.0f); // reveal
-
-		if (m_renderable.empty()) return;
-
-		m_resLib.Get<RasterizerState>(RS_CULL_NONE)->Bind();
-		m_resLib.Get<BlendState>(BS_WEIGHTED_BLENDED_OIT_OP)->Bind(nullptr, 0xff);
-		m_resLib.Get<DepthStencilState>(DSS_DEPTH_WRITE_ZERO)->Bind(0xff);
+		rtva[0]->Clear(0.0f, 0.0f, 0.0f, 0.0f); // accumulation
+		rtva[1]->Clear(1.0f, 1.0f, 1.0f, 1.0f); // reveal
 
-		RenderTargetView::Bind(*rtva, dsv.get());
+		RenderTargetView::Bind(rtva, dsv.get());
 
-		auto vs = m_resLib.Get<VertexShader>(VS_PHONG);
-		auto ps = m_resLib.Get<PixelShader>(PS_PHONG_OIT);
-		vs->Bind();
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_PHONG)->Bind();
+		auto pso = m_resLib.Get<PipelineState>(PSO_TRANSPARENT_PHONG);
+		pso->Bind();
+		const auto& vs = pso->GetDesc().vs;
+		const auto& ps = pso->GetDesc().ps;
 
 		// system cbufs
 		{
-			m_resLib.Get<Buffer>(CB_PS_PHONG_SYSTEM)->PSBindAsCBuf(ps->GetResBinding("SystemCBuf"));
+			m_resLib.Get<Buffer>(CB_PS_PHONG_SYSTEM)->PSBindAsCBuf(ps->GetBindings().Get(Binding::SystemCBuf));
 
 			GA::Utils::PhongVSSystemCBuf cbufData = {};
-			cbufData.viewPos = viewPos;
-			cbufData.viewProjection = viewProj;
+			cbufData.viewPos = view.viewPos;
+			cbufData.viewProjection = view.viewProj;
 
 			auto cbuf = m_resLib.Get<Buffer>(CB_VS_PHONG_SYSTEM);
 			cbuf->SetData(&cbufData);
-			cbuf->VSBindAsCBuf(vs->GetResBinding("SystemCBuf"));
+			cbuf->VSBindAsCBuf(vs->GetBindings().Get(Binding::SystemCBuf));
 		}
 
-		m_resLib.Get<ShaderResourceView>(SRV_DIRLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("dirLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("dirLightShadowMapsSampler"));
-		m_resLib.Get<ShaderResourceView>(SRV_POINTLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("pointLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("pointLightShadowMapsSampler"));
-		m_resLib.Get<ShaderResourceView>(SRV_SPOTLIGHT_SHADOW_MAP)->PSBind(ps->GetResBinding("spotLightShadowMaps"));
-		m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(ps->GetResBinding("spotLightShadowMapsSampler"));
+		BindShadowMaps(ps);
 
-		for (const auto& e : m_renderable)
+		BuildDrawList(m_transparentDrawList, DRAW_PASS_TRANSPARENT_PHONG, true, view.view.camera);
+		DrawEntityBatches(m_transparentDrawList, vs, ps);
+	}
+
+	void LambertianRenderGraph::GatherRenderables(bool transparent)
+	{
+		auto& renderables = transparent ? m_transparentRenderables : m_opaqueRenderables;
+		auto& culler = transparent ? m_transparentCuller : m_opaqueCuller;
+		renderables.clear();
+		culler.Clear();
+
+		for (const auto& e : transparent ? m_transparent : m_opaque)
 		{
 			const auto& [transform, mesh, mat] = GetRegistry().get<TransformComponent, MeshComponent, MaterialComponent>(e);
 
-			if (mat.color.w >= (1.0f - GA_UTILS_EPSILONF))
-				continue;
+			Renderable r = {};
+			r.entity = e;
+			r.variant = mat.normalMap ? (mat.depthMap ? 2 : 1) : 0;
+			r.material = m_materials.Intern(mat, r.slices);
+			r.meshId = m_meshIds.Get(mesh.vb.get(), mesh.ib.get(), mesh.geometry.get());
+			r.center = transform.position;
 
-			mesh.vb->BindAsVB();
-			mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
+			// merged static chunks sit at the origin, their bounds say where they are
+			const auto* bounds = GetRegistry().try_get<BoundsComponent>(e);
+			if (bounds)
+				r.center = bounds->box.Center;
 
-			mat.diffuseMap->PSBind(ps->GetResBinding("diffuseMap"));
-			mat.samplerState->PSBind(ps->GetResBinding("samplerState"));
+			culler.Add(bounds ? &bounds->box : nullptr);
+			renderables.push_back(r);
+		}
 
-			if (mat.normalMap)
-			{
-				mat.normalMap->PSBind(ps->GetResBinding("normalMap"));
-				if (mat.depthMap)
-					mat.depthMap->PSBind(ps->GetResBinding("depthMap"));
-			}
+		culler.Build();
+	}
 
-			XMMATRIX xmTransform = transform.GetTransform();
-			XMFLOAT4X4 fTransform;
-			XMFLOAT4X4 normalMatrix;
-			XMStoreFloat4x4(&fTransform, XMMatrixTranspose(xmTransform));
-			XMStoreFloat4x4(&normalMatrix, XMMatrixInverse(nullptr, xmTransform));
+	void LambertianRenderGraph::BuildDrawList(DrawList& list, uint32_t pass, bool transparent, const Camera* camera)
+	{
+		list.Clear();
 
-			{
-				GA::Utils::PhongVSEntityCBuf cbufData = {};
-				cbufData.transform = fTransform;
-				cbufData.normalMatrix = normalMatrix;
+		const auto& renderables = transparent ? m_transparentRenderables : m_opaqueRenderables;
+		auto& culler = transparent ? m_transparentCuller : m_opaqueCuller;
+		culler.Cull(camera->GetFrustum(), m_visible);
+		for (size_t i = m_visible.size(); i < renderables.size(); i++)
+			list.Cull();
 
-				auto cbuf = m_resLib.Get<Buffer>(CB_VS_PHONG_ENTITY);
-				cbuf->SetData(&cbufData);
-				cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-			}
+		XMMATRIX xmView = camera->GetViewMatrix();
+		float nearZ = camera->GetDesc().nearZ;
+		float farZ = camera->GetDesc().farZ;
 
+		for (uint32_t i : m_visible)
+		{
+			const auto& r = renderables[i];
+
+			// opaque front to back for early z. weighted blended oit doesn't care about order
+			uint32_t depth = 0;
+			if (!transparent)
 			{
-				GA::Utils::PhongPSEntityCBuf cbufData = {};
-				cbufData.mat.color = mat.color;
-				cbufData.mat.tiling = mat.tiling;
-				cbufData.mat.shininess = mat.shininess;
-				cbufData.mat.enableNormalMapping = mat.normalMap ? TRUE : FALSE;
-				cbufData.mat.enableParallaxMapping = mat.normalMap && mat.depthMap ? TRUE : FALSE;
-				cbufData.mat.depthMapScale = mat.depthMapScale;
-				cbufData.receiveShadows = mesh.receiveShadows;
-
-				auto cbuf = m_resLib.Get<Buffer>(CB_PS_PHONG_ENTITY);
-				cbuf->PSBindAsCBuf(ps->GetResBinding("EntityCBuf"));
-				cbuf->SetData(&cbufData);
+				float viewDepth = XMVectorGetZ(XMVector3Transform(XMLoadFloat3(&r.center), xmView));
+				depth = DrawKey::QuantizeDepth(viewDepth, nearZ, farZ);
 			}
 
-			m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
-			GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+			list.Add(DrawKey::Make(pass, r.variant, r.material, r.meshId, depth), r.entity, r.material, r.slices);
 		}
+
+		list.Sort();
+		list.Batch(GetRegistry(), false);
 	}
 
-	void LambertianRenderGraph::CompositePass()
+	void LambertianRenderGraph::DrawEntityBatches(const DrawList& list, const std::shared_ptr<VertexShader>& vs, const std::shared_ptr<PixelShader>& ps,
+		const std::shared_ptr<PipelineState>& uncoveredPso)
 	{
-		m_resLib.Get<RasterizerState>(S_DEFAULT)->Bind();
-		m_resLib.Get<BlendState>(BS_OVER_OP)->Bind(nullptr, 0xff);
+		// instances in draw order, a batch reads its instances from batch.first on
+		m_entityInstances.Clear();
+		for (const auto& item : list.GetItems())
+		{
+			const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(item.entity);
+
+			XMMATRIX xmTransform = transform.GetTransform();
 
-		m_resLib.Get<RenderTargetView>(RTV_SCENE)->Bind(nullptr);
+			GA::Utils::EntityInstance instance = {};
+			XMStoreFloat4x4(&instance.transform, XMMatrixTranspose(xmTransform));
+			XMStoreFloat4x4(&instance.normalMatrix, XMMatrixInverse(nullptr, xmTransform));
+			instance.receiveShadows = mesh.receiveShadows;
+			instance.diffuseSlice = item.slices.diffuse;
+			instance.normalSlice = item.slices.normal;
+			instance.depthSlice = item.slices.depth;
+			m_entityInstances.Push(instance);
+		}
 
-		m_resLib.Get<VertexShader>(VS_FS_OUT_POS)->Bind();
-		auto ps = m_resLib.Get<PixelShader>(PS_PHONG_OIT_COMPOSITE);
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_FS_OUT_POS)->Bind();
+		m_entityInstances.Upload();
+		m_entityInstances.VSBind(vs->GetBindings().Get(Binding::entityInstances));
+		m_entityInstances.PSBind(ps->GetBindings().Get(Binding::entityInstances));
 
-		m_resLib.Get<ShaderResourceView>(SRV_TRANSPARENT_PHONG_PASS_ACC)->PSBind(ps->GetResBinding("accumulationMap"));
-		m_resLib.Get<ShaderResourceView>(SRV_TRANSPARENT_PHONG_PASS_REV)->PSBind(ps->GetResBinding("revealMap"));
+		// every batch's instance offset goes up with one map before the draws
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		const auto& batches = list.GetBatches();
+		m_batchAllocations.clear();
+		for (const auto& batch : batches)
+		{
+			GA::Utils::InstanceCBuf cbufData = {};
+			cbufData.instanceOffset = batch.first;
+			m_batchAllocations.push_back(ring->Allocate(cbufData));
+		}
+		ring->Flush();
 
-		m_resLib.Get<Buffer>(VB_FS_QUAD)->BindAsVB();
-		auto ib = m_resLib.Get<Buffer>(IB_FS_QUAD);
-		ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-		m_context->GetDeviceContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+		uint32_t instanceSlot = vs->GetBindings().Get(Binding::InstanceCBuf);
+		bool uncovered = false;
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			const auto& batch = batches[i];
+			const auto& mesh = GetRegistry().get<MeshComponent>(batch.entity);
+
+			// variants sort last, once past the pre-pass draws the rest keeps the regular depth test
+			if (uncoveredPso && !uncovered && !DepthPrepass::Covers(list.GetItems()[batch.first].key))
+			{
+				uncoveredPso->Bind();
+				uncovered = true;
+			}
+
+			BindDrawResources(m_context, mesh, m_materials.Get(list.GetItems()[batch.first].material), ps.get());
+			ring->VSBind(m_batchAllocations[i], instanceSlot);
+
+			m_context->DrawIndexedInstanced(mesh.GetIndexCount(), batch.count, mesh.GetStartIndex(), mesh.GetBaseVertex(), 0);
+		}
 	}
 
-	void LambertianRenderGraph::GammaCorrectionPass()
+	void LambertianRenderGraph::BindShadowMaps(const std::shared_ptr<PixelShader>& ps)
 	{
-		m_resLib.Get<RasterizerState>(S_DEFAULT)->Bind();
+		// the shaders only sample the maps of active lights
+		auto bind = [&](const char* key, uint32_t slot, uint32_t samplerSlot)
+		{
+			if (m_resLib.IsCreated<ShaderResourceView>(key))
+				m_resLib.Get<ShaderResourceView>(key)->PSBind(slot);
+			else
+				m_context->GetStateCache().SetShaderResource(ShaderStage::Pixel, slot, nullptr);
 
-		auto rtv = m_resLib.Get<RenderTargetView>(RTV_MAIN);
-		rtv->Clear(0.0f, 0.0f, 0.0f, 0.0f);
-		rtv->Bind(nullptr);
-
-		m_resLib.Get<VertexShader>(VS_FS_OUT_TC_POS)->Bind();
-		auto ps = m_resLib.Get<PixelShader>(PS_GAMMA_CORRECTION);
-		ps->Bind();
-		m_resLib.Get<InputLayout>(IL_FS_OUT_TC_POS)->Bind();
-
-		m_resLib.Get<ShaderResourceView>(SRV_SCENE)->PSBind(ps->GetResBinding("tex"));
-		m_resLib.Get<SamplerState>(SS_POINT_CLAMP)->PSBind(ps->GetResBinding("samplerState"));
-
-		DirectX::XMFLOAT4 gamma = { GAMMA, 0.0f, 0.0f, 0.0f };
-		auto cbuf = m_resLib.Get<Buffer>(CB_PS_GAMMA_CORRECTION_SYSTEM);
-		cbuf->SetData(&gamma);
-		cbuf->PSBindAsCBuf(ps->GetResBinding("SystemCBuf"));
-
-		m_resLib.Get<Buffer>(VB_FS_QUAD)->BindAsVB();
-		auto ib = m_resLib.Get<Buffer>(IB_FS_QUAD);
-		ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-		m_context->GetDeviceContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+			m_resLib.Get<SamplerState>(SS_LINEAR_CLAMP)->PSBind(samplerSlot);
+		};
+
+		bind(SRV_DIRLIGHT_SHADOW_MAP, ps->GetBindings().Get(Binding::dirLightShadowMaps), ps->GetBindings().Get(Binding::dirLightShadowMapsSampler));
+		bind(SRV_POINTLIGHT_SHADOW_MAP, ps->GetBindings().Get(Binding::pointLightShadowMaps), ps->GetBindings().Get(Binding::pointLightShadowMapsSampler));
+		bind(SRV_SPOTLIGHT_SHADOW_MAP, ps->GetBindings().Get(Binding::spotLightShadowMaps), ps->GetBindings().Get(Binding::spotLightShadowMapsSampler));
 	}
 
 	void LambertianRenderGraph::SetLights()
 	{
-		GA::Utils::PhongPSSystemCBuf psSysCbuf = {};
-		psSysCbuf.activeDirLights = (uint32_t)m_dirLights.size();
-		psSysCbuf.activePointLights = (uint32_t)m_pointLights.size();
-		psSysCbuf.activeSpotLights = (uint32_t)m_spotLights.size();
-
-		D3D11_VIEWPORT vp = {};
-		vp.TopLeftX = 0.0f;
-		vp.TopLeftY = 0.0f;
-		vp.Width = (float)SHADOWMAP_SIZE;
-		vp.Height = (float)SHADOWMAP_SIZE;
-		vp.MinDepth = 0.0f;
-		vp.MaxDepth = 1.0f;
-		m_context->GetDeviceContext()->RSSetViewports(1, &vp);
+		m_lightCache.Begin();
+		m_lightCache.SetActiveLights((uint32_t)m_dirLights.size(), (uint32_t)m_pointLights.size(), (uint32_t)m_spotLights.size());
 
-		m_resLib.Get<RasterizerState>(RS_DEPTH_SLOPE_SCALED_BIAS)->Bind();
-		m_resLib.Get<BlendState>(S_DEFAULT)->Bind(nullptr, 0xff);
-		m_resLib.Get<DepthStencilState>(S_DEFAULT)->Bind(0xff);
+		// static casters live in cached static-only shadow maps, every map update copies its cache and draws only dynamic casters on top
+		UpdateShadowCasters();
 
 		uint32_t index = 0;
 		for (const auto& e : m_dirLights)
 		{
 			const auto& [transform, dirLight] = GetRegistry().get<TransformComponent, DirectionalLightComponent>(e);
+			uint32_t i = index++;
 
-			XMVECTOR xmDirection = transform.GetForward();
-			XMFLOAT3 direction;
-			XMStoreFloat3(&direction, xmDirection);
-			XMMATRIX xmLightSpace = XMMatrixInverse(nullptr, transform.GetTransform()) * XMMatrixOrthographicLH(20.0f, 20.0f, 0.1f, 500.0f);
-			XMFLOAT4X4 lightSpace;
-			XMStoreFloat4x4(&lightSpace, XMMatrixTranspose(xmLightSpace));
-
-			psSysCbuf.dirLights[index].direction = direction;
-			psSysCbuf.dirLights[index].color = dirLight.color;
-			psSysCbuf.dirLights[index].ambientIntensity = dirLight.ambientIntensity;
-			psSysCbuf.dirLights[index].intensity = dirLight.intensity;
-			psSysCbuf.dirLights[index].lightSpace = lightSpace;
+			m_lightCache.UpdateDirLight(i, e, transform, dirLight);
 
+			// orthographic, near/far are part of the light space
+			ShadowSlot view = { m_lightCache.GetDirLightSpace(i), 0.0f, 0.0f };
 
 			// shadow map pass
-			auto dsv = m_resLib.Get<DepthStencilView>(DSV_DIRLIGHT_SHADOW_MAP(index));
-			dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
-
-			if (m_renderable.empty()) continue;
-
-			dsv->Bind();
-			// todo: cant run this in graphics debug. Have to bind a rtv because of stupid warning
-			// m_resLib.Get<RenderTargetView>(RTV_MAIN)->Bind(dsv.get());
-
-			auto vs = m_resLib.Get<VertexShader>(VS_BASIC);
-			vs->Bind();
-			m_resLib.Get<PixelShader>(PS_NULLPTR)->Bind();
-			m_resLib.Get<InputLayout>(IL_BASIC)->Bind();
+			auto dsv = m_resLib.Get<DepthStencilView>(DSV_DIRLIGHT_SHADOW_MAP(i));
 
+			if (m_renderable.empty())
 			{
-				auto cbuf = m_resLib.Get<Buffer>(CB_VS_BASIC_SYSTEM);
-				cbuf->SetData(&lightSpace);
-				cbuf->VSBindAsCBuf(vs->GetResBinding("SystemCBuf"));
+				dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+				continue;
 			}
 
-			// draw to depth map
-			for (const auto& e : m_renderable)
-			{
-				const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(e);
+			// todo: cant run this in graphics debug. Have to bind a rtv because of stupid warning
+			// m_resLib.Get<RenderTargetView>(RTV_MAIN)->Bind(dsv.get());
 
-				if (!mesh.castShadows) continue;
+			AddShadowJob(DIRLIGHT_SHADOW_SLOT(i), view, PSO_SHADOW_MAP, CB_VS_BASIC_SYSTEM, ShaderStage::Vertex, &view.lightSpace, sizeof(XMFLOAT4X4),
+				dsv, m_resLib.Get<DepthStencilView>(DSV_DIRLIGHT_STATIC_SHADOW_MAP(i)));
+		}
 
-				{
-					XMFLOAT4X4 fTransform; 
-					XMStoreFloat4x4(&fTransform, XMMatrixTranspose(transform.GetTransform()));
-					auto cbuf = m_resLib.Get<Buffer>(CB_VS_BASIC_ENTITY);
-					cbuf->SetData(&fTransform);
-					cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-				}
-
-				mesh.vb->BindAsVB();
-				mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-				m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
-
-				GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
-			}
+		// point and spot light shadow maps are only re-rendered when stale and picked by the scheduler,
+		// the rest keep the map (and the light space it was rendered with) from a previous frame
+		m_shadowScheduler.Begin(m_viewPositions);
 
-			++index;
-		}
+		ShadowSlot lightViews[2 * GA::Utils::s_maxLights];
 
 		index = 0;
 		for (const auto& e : m_pointLights)
 		{
 			const auto& [transform, pointLight] = GetRegistry().get<TransformComponent, PointLightComponent>(e);
+			uint32_t i = index++;
+			uint32_t slot = POINTLIGHT_SHADOW_SLOT(i);
 
-			XMFLOAT4X4 lightSpace;
-			XMStoreFloat4x4(&lightSpace, XMMatrixTranspose(XMMatrixTranslation(-transform.position.x, -transform.position.y, -transform.position.z)));
+			bool dirty = m_lightCache.UpdatePointLight(i, e, transform, pointLight) | ShadowCastersChangedNear(transform.position, pointLight.shadowFarZ);
 
-			psSysCbuf.pointLights[index].position = transform.position;
-			psSysCbuf.pointLights[index].color = pointLight.color;
-			psSysCbuf.pointLights[index].ambientIntensity = pointLight.ambientIntensity;
-			psSysCbuf.pointLights[index].intensity = pointLight.intensity;
-			psSysCbuf.pointLights[index].nearZ = pointLight.shadowNearZ;
-			psSysCbuf.pointLights[index].farZ = pointLight.shadowFarZ;
-			psSysCbuf.pointLights[index].lightSpace = lightSpace;
-
-			// shadow map pass
-			auto dsv = m_resLib.Get<DepthStencilView>(DSV_POINTLIGHT_SHADOW_MAP(index));
-			dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+			auto& view = lightViews[slot];
+			view.lightSpace = m_lightCache.GetPointLightSpace(i);
+			view.nearZ = pointLight.shadowNearZ;
+			view.farZ = pointLight.shadowFarZ;
 
-			if (m_renderable.empty()) continue;
+			// geometry shader draws every caster into the 6 cube faces
+			uint64_t triangles = m_dynamicCasterTriangles + (IsStaticShadowCacheValid(slot, view) ? 0 : m_staticCasterTriangles);
+			m_shadowScheduler.Submit(slot, e, transform.position, pointLight.shadowFarZ, pointLight.intensity, triangles * 6, dirty);
+		}
 
-			dsv->Bind();
+		index = 0;
+		for (const auto& e : m_spotLights)
+		{
+			const auto& [transform, spotLight] = GetRegistry().get<TransformComponent, SpotLightComponent>(e);
+			uint32_t i = index++;
+			uint32_t slot = SPOTLIGHT_SHADOW_SLOT(i);
 
-			auto vs = m_resLib.Get<VertexShader>(VS_CUBE_SHADOW_MAP);
-			auto gs = m_resLib.Get<GeometryShader>(GS_CUBE_SHADOW_MAP);
-			vs->Bind();
-			gs->Bind();
-			m_resLib.Get<PixelShader>(PS_NULLPTR)->Bind();
-			m_resLib.Get<InputLayout>(VS_CUBE_SHADOW_MAP)->Bind();
+			bool dirty = m_lightCache.UpdateSpotLight(i, e, transform, spotLight) | ShadowCastersChangedNear(transform.position, spotLight.shadowFarZ);
 
-			XMMATRIX xmPointLightProjection = XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 1.0f, pointLight.shadowNearZ, pointLight.shadowFarZ);
-			XMMATRIX xmPointLightTranslation = XMMatrixTranslation(transform.position.x, transform.position.y, transform.position.z);
-			XMMATRIX xmPointLightSpace[6] =
-			{
-				// + x
-				XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0f, XMConvertToRadians(90.0f), 0.0f)) * xmPointLightTranslation) * xmPointLightProjection,
+			auto& view = lightViews[slot];
+			view.lightSpace = m_lightCache.GetSpotLightSpace(i);
+			view.nearZ = spotLight.shadowNearZ;
+			view.farZ = spotLight.shadowFarZ;
 
-				// -x
-				XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0f, XMConvertToRadians(-90.0f), 0.0f)) * xmPointLightTranslation) * xmPointLightProjection,
+			uint64_t triangles = m_dynamicCasterTriangles + (IsStaticShadowCacheValid(slot, view) ? 0 : m_staticCasterTriangles);
+			m_shadowScheduler.Submit(slot, e, transform.position, spotLight.shadowFarZ, spotLight.intensity, triangles, dirty);
+		}
 
-				// +y
-				XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(XMConvertToRadians(-90.0f), 0.0f, 0.0f)) * xmPointLightTranslation) * xmPointLightProjection,
+		m_shadowScheduler.Schedule();
 
-				// -y
-				XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(XMConvertToRadians(90.0f), 0.0f, 0.0f)) * xmPointLightTranslation) * xmPointLightProjection,
+		for (uint32_t i = 0; i < (uint32_t)m_pointLights.size(); i++)
+		{
+			uint32_t slot = POINTLIGHT_SHADOW_SLOT(i);
+			auto& shadow = m_shadowSlots[slot];
+			bool updateShadow = m_shadowScheduler.IsScheduled(slot);
 
-				// +z
-				XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0, 0.0f, 0.0f)) * xmPointLightTranslation) * xmPointLightProjection,
+			if (updateShadow)
+				shadow = lightViews[slot];
 
-				// -z
-				XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0, XMConvertToRadians(180.0f), 0.0f)) * xmPointLightTranslation) * xmPointLightProjection,
-			};
+			m_lightCache.SetPointLightShadow(i, shadow.lightSpace, shadow.nearZ, shadow.farZ);
 
-			XMFLOAT4X4 pointLightSpace[6];
-			for (int i = 0; i < 6; i++)
-				XMStoreFloat4x4(&pointLightSpace[i], XMMatrixTranspose(xmPointLightSpace[i]));
+			if (!updateShadow) continue;
 
-			{
-				auto cbuf = m_resLib.Get<Buffer>(CB_GS_CUBE_SHADOW_MAP_SYSTEM);
-				cbuf->SetData(pointLightSpace);
-				cbuf->GSBindAsCBuf(gs->GetResBinding("SystemCBuf"));
-			}
+			// shadow map pass
+			auto dsv = m_resLib.Get<DepthStencilView>(DSV_POINTLIGHT_SHADOW_MAP(i));
 
-			// draw to depth map
-			for (const auto& e : m_renderable)
+			if (m_renderable.empty())
 			{
-				const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(e);
-
-				if (!mesh.castShadows) continue;
-
-				{
-					XMFLOAT4X4 fTransform;
-					XMStoreFloat4x4(&fTransform, XMMatrixTranspose(transform.GetTransform()));
-					auto cbuf = m_resLib.Get<Buffer>(CB_VS_CUBE_SHADOW_MAP_ENTITY);
-					cbuf->SetData(&fTransform);
-					cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-				}
-
-				mesh.vb->BindAsVB();
-				mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-				m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
-
-				GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
+				dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+				continue;
 			}
 
-			m_resLib.Get<GeometryShader>(GS_NULLPTR)->Bind();
-			
-			++index;
+			// geometry shader draws every caster into the 6 cube faces
+			AddShadowJob(slot, shadow, PSO_CUBE_SHADOW_MAP, CB_GS_CUBE_SHADOW_MAP_SYSTEM, ShaderStage::Geometry, m_lightCache.GetPointLightFaces(i), 6 * sizeof(XMFLOAT4X4),
+				dsv, m_resLib.Get<DepthStencilView>(DSV_POINTLIGHT_STATIC_SHADOW_MAP(i)));
 		}
 
-		index = 0;
-		for (const auto& e : m_spotLights)
+		for (uint32_t i = 0; i < (uint32_t)m_spotLights.size(); i++)
 		{
-			const auto& [transform, spotLight] = GetRegistry().get<TransformComponent, SpotLightComponent>(e);
+			uint32_t slot = SPOTLIGHT_SHADOW_SLOT(i);
+			auto& shadow = m_shadowSlots[slot];
+			bool updateShadow = m_shadowScheduler.IsScheduled(slot);
 
-			XMVECTOR xmDirection = transform.GetForward();
-			XMFLOAT3 direction;
-			XMStoreFloat3(&direction, xmDirection);
+			if (updateShadow)
+				shadow = lightViews[slot];
 
-			XMMATRIX xmLightSpace = XMMatrixInverse(nullptr, transform.GetTransform()) * XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 1.0f, spotLight.shadowNearZ, spotLight.shadowFarZ);
-			XMFLOAT4X4 lightSpace;
-			XMStoreFloat4x4(&lightSpace, XMMatrixTranspose(xmLightSpace));
+			m_lightCache.SetSpotLightShadow(i, shadow.lightSpace);
 
-			psSysCbuf.spotLights[index].direction = direction;
-			psSysCbuf.spotLights[index].position = transform.position;
-			psSysCbuf.spotLights[index].color = spotLight.color;
-			psSysCbuf.spotLights[index].ambientIntensity = spotLight.ambientIntensity;
-			psSysCbuf.spotLights[index].intensity = spotLight.intensity;
-			psSysCbuf.spotLights[index].innerCutOffCosAngle = cosf(XMConvertToRadians(spotLight.innerCutOffAngle));
-			psSysCbuf.spotLights[index].outerCutOffCosAngle = cosf(XMConvertToRadians(spotLight.outerCutOffAngle));
-			psSysCbuf.spotLights[index].lightSpace = lightSpace;
+			if (!updateShadow) continue;
 
 			// shadow map pass
-			auto dsv = m_resLib.Get<DepthStencilView>(DSV_SPOTLIGHT_SHADOW_MAP(index));
-			dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+			auto dsv = m_resLib.Get<DepthStencilView>(DSV_SPOTLIGHT_SHADOW_MAP(i));
 
-			if (m_renderable.empty()) continue;
+			if (m_renderable.empty())
+			{
+				dsv->Clear(D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+				continue;
+			}
 
-			dsv->Bind();
 			// todo: cant run this in graphics debug. Have to bind a rtv because of stupid warning
 			// m_resLib.Get<RenderTargetView>(RTV_MAIN)->Bind(dsv.get());
 
-			auto vs = m_resLib.Get<VertexShader>(VS_BASIC);
-			vs->Bind();
-			m_resLib.Get<PixelShader>(PS_NULLPTR)->Bind();
-			m_resLib.Get<InputLayout>(IL_BASIC)->Bind();
+			AddShadowJob(slot, shadow, PSO_SHADOW_MAP, CB_VS_BASIC_SYSTEM, ShaderStage::Vertex, &shadow.lightSpace, sizeof(XMFLOAT4X4),
+				dsv, m_resLib.Get<DepthStencilView>(DSV_SPOTLIGHT_STATIC_SHADOW_MAP(i)));
+		}
+
+		RenderShadowMaps();
 
+		m_lightCache.Upload(m_resLib.Get<Buffer>(CB_PS_PHONG_SYSTEM));
+	}
+
+	void LambertianRenderGraph::UpdateShadowCasters()
+	{
+		m_changedCasterBounds.clear();
+		m_staticCasterTriangles = 0;
+		m_dynamicCasterTriangles = 0;
+
+		m_casterDrawList.Clear();
+
+		auto addBounds = [&](const TransformComponent& t)
+		{
+			// BasicMesh primitives span [-0.5, 0.5]
+			float radius = 0.87f * std::max({ t.scale.x, t.scale.y, t.scale.z });
+			m_changedCasterBounds.push_back({ t.position.x, t.position.y, t.position.z, radius });
+		};
+
+		bool staticChanged = false;
+		for (const auto& e : m_renderable)
+		{
+			const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(e);
+
+			if (!mesh.castShadows) continue;
+
+			bool isStatic = GetRegistry().all_of<StaticTag>(e);
+			(isStatic ? m_staticCasterTriangles : m_dynamicCasterTriangles) += mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t) / 3;
+
+			uint32_t pass = isStatic ? DRAW_PASS_STATIC_CASTERS : DRAW_PASS_DYNAMIC_CASTERS;
+			m_casterDrawList.Add(DrawKey::Make(pass, 0, 0, m_meshIds.Get(mesh.vb.get(), mesh.ib.get(), mesh.geometry.get()), 0), e);
+
+			TransformComponent previous;
+			bool existed;
+			if ((isStatic ? m_staticCasterTransforms : m_casterTransforms).Update(e, transform, &previous, &existed))
 			{
-				auto cbuf = m_resLib.Get<Buffer>(CB_VS_BASIC_SYSTEM);
-				cbuf->SetData(&lightSpace);
-				cbuf->VSBindAsCBuf(vs->GetResBinding("SystemCBuf"));
+				addBounds(transform);
+				if (existed) addBounds(previous);
+				staticChanged |= isStatic;
 			}
+		}
 
-			// draw to depth map
-			for (const auto& e : m_renderable)
-			{
-				const auto& [transform, mesh] = GetRegistry().get<TransformComponent, MeshComponent>(e);
+		// casters that were destroyed, stopped casting shadows or changed mobility
+		m_casterTransforms.Sweep([&](entt::entity, const TransformComponent& last) { addBounds(last); });
+		m_staticCasterTransforms.Sweep([&](entt::entity, const TransformComponent& last) { addBounds(last); staticChanged = true; });
 
-				if (!mesh.castShadows) continue;
+		if (staticChanged)
+			++m_staticCasterVersion;
 
-				{
-					XMFLOAT4X4 fTransform;
-					XMStoreFloat4x4(&fTransform, XMMatrixTranspose(transform.GetTransform()));
-					auto cbuf = m_resLib.Get<Buffer>(CB_VS_BASIC_ENTITY);
-					cbuf->SetData(&fTransform);
-					cbuf->VSBindAsCBuf(vs->GetResBinding("EntityCBuf"));
-				}
-
-				mesh.vb->BindAsVB();
-				mesh.ib->BindAsIB(DXGI_FORMAT_R32_UINT);
-				m_context->GetDeviceContext()->IASetPrimitiveTopology(mesh.topology);
-
-				GDX11_CONTEXT_THROW_INFO_ONLY(m_context->GetDeviceContext()->DrawIndexed(mesh.ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0));
-			}
+		// every shadow map draws from the same caster instances, uploaded once per frame
+		m_casterDrawList.Sort();
+		m_casterDrawList.Batch(GetRegistry(), true);
 
-			++index;
+		m_casterInstances.Clear();
+		for (const auto& item : m_casterDrawList.GetItems())
+		{
+			XMFLOAT4X4 transform;
+			XMStoreFloat4x4(&transform, XMMatrixTranspose(GetRegistry().get<TransformComponent>(item.entity).GetTransform()));
+			m_casterInstances.Push(transform);
 		}
 
-		m_resLib.Get<Buffer>(CB_PS_PHONG_SYSTEM)->SetData(&psSysCbuf);
+		m_casterInstances.Upload();
+
+		// meshes and instance offsets of every caster batch, shared by all the shadow maps drawn this frame
+		auto ring = m_resLib.Get<ConstantRing>(CR_INSTANCE);
+		const auto& items = m_casterDrawList.GetItems();
+		m_casterBatches.clear();
+		for (const auto& batch : m_casterDrawList.GetBatches())
+		{
+			const auto& mesh = GetRegistry().get<MeshComponent>(batch.entity);
+
+			GA::Utils::InstanceCBuf cbufData = {};
+			cbufData.instanceOffset = batch.first;
+
+			CasterBatch casterBatch = {};
+			casterBatch.vb = mesh.vb->GetNative();
+			casterBatch.stride = mesh.vb->GetDesc().StructureByteStride;
+			casterBatch.ib = mesh.ib->GetNative();
+			casterBatch.topology = mesh.topology;
+			casterBatch.indexCount = mesh.GetIndexCount();
+			casterBatch.startIndex = mesh.GetStartIndex();
+			casterBatch.baseVertex = mesh.GetBaseVertex();
+			casterBatch.instances = batch.count;
+			casterBatch.allocation = ring->Allocate(cbufData);
+			casterBatch.isStatic = DrawKey::GetPass(items[batch.first].key) == DRAW_PASS_STATIC_CASTERS;
+			m_casterBatches.push_back(casterBatch);
+		}
+		ring->Flush();
 	}
 
+	bool LambertianRenderGraph::ShadowCastersChangedNear(const DirectX::XMFLOAT3& position, float range) const
+	{
+		XMVECTOR xmPosition = XMLoadFloat3(&position);
+		for (const auto& b : m_changedCasterBounds)
+		{
+			float dist = XMVectorGetX(XMVector3Length(XMVectorSet(b.x, b.y, b.z, 0.0f) - xmPosition));
+			if (dist < range + b.w) return true;
+		}
 
+		return false;
+	}
 
+	bool LambertianRenderGraph::IsStaticShadowCacheValid(uint32_t slot, const ShadowSlot& view) const
+	{
+		const auto& cache = m_staticShadowCaches[slot];
+		return cache.valid && cache.version == m_staticCasterVersion && memcmp(&cache.view, &view, sizeof(ShadowSlot)) == 0;
+	}
 
+	void LambertianRenderGraph::AddShadowJob(uint32_t slot, const ShadowSlot& view, const char* pso, const char* cbuf, ShaderStage cbufStage, const void* cbufData, uint32_t cbufBytes,
+		const std::shared_ptr<DepthStencilView>& dsv, const std::shared_ptr<DepthStencilView>& staticDsv)
+	{
+		GDX11_CORE_ASSERT(cbufBytes <= sizeof(ShadowJob::cbufData), "Shadow job cbuf data too large");
+
+		// the resource library creates on first use, everything is resolved here and workers only read the job
+		auto pipeline = m_resLib.Get<PipelineState>(pso);
+		const auto& desc = pipeline->GetDesc();
+
+		ShadowJob job = {};
+		job.pso = pipeline.get();
+		job.cbuf = m_resLib.Get<Buffer>(cbuf)->GetNative();
+		job.cbufStage = cbufStage;
+		job.cbufSlot = cbufStage == ShaderStage::Geometry ? desc.gs->GetBindings().Get(Binding::SystemCBuf) : desc.vs->GetBindings().Get(Binding::SystemCBuf);
+		job.cbufBytes = cbufBytes;
+		memcpy(job.cbufData, cbufData, cbufBytes);
+		job.instanceRing = m_resLib.Get<ConstantRing>(CR_INSTANCE)->GetNative();
+		job.instanceCBufSlot = desc.vs->GetBindings().Get(Binding::InstanceCBuf);
+		job.casterInstancesSlot = desc.vs->GetBindings().Get(Binding::casterInstances);
+		job.dsv = dsv.get();
+		job.staticDsv = staticDsv.get();
+
+		auto& cache = m_staticShadowCaches[slot];
+		job.refreshStatic = !IsStaticShadowCacheValid(slot, view);
+		if (job.refreshStatic)
+		{
+			cache.view = view;
+			cache.version = m_staticCasterVersion;
+			cache.valid = true;
+		}
 
+		m_shadowJobs.push_back(job);
+	}
 
+	void LambertianRenderGraph::RenderShadowMaps()
+	{
+		Timer timer;
+		m_shadowRecordingStats = {};
+		m_shadowRecordingStats.jobs = (uint32_t)m_shadowJobs.size();
 
+		if (m_shadowJobs.empty()) return;
 
+		while (m_shadowCommands.size() < m_shadowJobs.size())
+			m_shadowCommands.push_back(std::make_unique<CommandBuffer>(m_context));
 
+		// a deferred context only pays off when the driver builds the command list, the runtime's emulation records every call
+		// a second time. a capture only sees the immediate context
+		bool deferred = m_shadowJobs.size() > 1 && m_context->HasDriverCommandLists() && !m_context->IsCapturing();
 
+		auto record = [&](uint32_t j)
+		{
+			auto& cmd = *m_shadowCommands[j];
+			cmd.Reset();
+			RecordShadowMap(m_shadowJobs[j], cmd);
+			if (deferred) cmd.Finish();
+		};
 
+		if (m_shadowJobs.size() > 1)
+		{
+			std::vector<uint32_t> jobs(m_shadowJobs.size());
+			std::iota(jobs.begin(), jobs.end(), 0);
+			std::for_each(std::execution::par, jobs.begin(), jobs.end(), record);
+		}
+		else
+		{
+			record(0);
+		}
 
+		m_shadowRecordingStats.recordMs = timer.Peek() * 1000.0f;
 
+		// in queue order, jobs of the same pipeline write the same system cbuf
+		for (uint32_t j = 0; j < (uint32_t)m_shadowJobs.size(); j++)
+		{
+			auto& cmd = *m_shadowCommands[j];
+			m_shadowRecordingStats.packets += cmd.GetPacketCount();
+			m_shadowRecordingStats.bytes += cmd.GetSize();
 
+			if (cmd.IsFinished())
+			{
+				cmd.Execute();
+				m_shadowRecordingStats.commandLists++;
+			}
+			else
+			{
+				cmd.Submit();
+			}
+		}
 
+		m_shadowJobs.clear();
+	}
 
+	void LambertianRenderGraph::RecordShadowMap(const ShadowJob& job, CommandBuffer& cmd) const
+	{
+		D3D11_VIEWPORT vp = {};
+		vp.TopLeftX = 0.0f;
+		vp.TopLeftY = 0.0f;
+		vp.Width = (float)SHADOWMAP_SIZE;
+		vp.Height = (float)SHADOWMAP_SIZE;
+		vp.MinDepth = 0.0f;
+		vp.MaxDepth = 1.0f;
+		cmd.SetViewport(vp);
 
+		cmd.SetPipelineState(job.pso);
+		cmd.SetBufferData(job.cbuf, job.cbufData, job.cbufBytes);
+		cmd.SetConstantBuffer(job.cbufStage, job.cbufSlot, job.cbuf);
 
+		if (job.refreshStatic)
+		{
+			cmd.ClearDepthStencil(job.staticDsv->GetNative(), D3D11_CLEAR_DEPTH, 1.0f, 0xff);
+			cmd.SetRenderTargets(0, nullptr, job.staticDsv->GetNative());
+			RecordShadowCasters(job, cmd, true);
+		}
 
+		// copy the cached slices into the working map. nothing may stay bound as output while copying
+		cmd.SetRenderTargets(0, nullptr, nullptr);
 
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+		job.dsv->GetNative()->GetDesc(&dsvDesc);
+		for (uint32_t i = 0; i < dsvDesc.Texture2DArray.ArraySize; i++)
+		{
+			uint32_t subresource = D3D11CalcSubresource(0, dsvDesc.Texture2DArray.FirstArraySlice + i, 1);
+			cmd.CopySubresource(job.dsv->GetTexture2D()->GetNative(), subresource, job.staticDsv->GetTexture2D()->GetNative(), subresource);
+		}
 
+		cmd.SetRenderTargets(0, nullptr, job.dsv->GetNative());
+		RecordShadowCasters(job, cmd, false);
+	}
 
-	void LambertianRenderGraph::ResizeViews(uint32_t width, uint32_t height)
+	void LambertianRenderGraph::RecordShadowCasters(const ShadowJob& job, CommandBuffer& cmd, bool staticCasters) const
 	{
-		m_windowWidth = width;
-		m_windowHeight = height;
+		cmd.SetShaderResource(ShaderStage::Vertex, job.casterInstancesSlot, m_casterInstances.GetNativeSRV());
 
-		// main rtv
+		for (const auto& batch : m_casterBatches)
 		{
-			if (m_resLib.Exist<RenderTargetView>(RTV_MAIN))
-			{
-				m_resLib.Remove<RenderTargetView>(RTV_MAIN);
-				HRESULT hr;
-				GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->ResizeBuffers(1, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0));
-			}
+			if (batch.isStatic != staticCasters) continue;
 
-			D3D11_RENDER_TARGET_VIEW_DESC desc = {};
-			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-			desc.Texture2D.MipSlice = 0;
-			ComPtr<ID3D11Texture2D> backbuffer;
-			HRESULT hr;
-			GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->GetBuffer(0, __uuidof(ID3D11Texture2D), &backbuffer));
-			m_resLib.Add(RTV_MAIN, RenderTargetView::Create(m_context, desc, Texture2D::Create(m_context, backbuffer.Get())));
+			cmd.SetVertexBuffer(0, batch.vb, batch.stride, 0);
+			cmd.SetIndexBuffer(batch.ib, DXGI_FORMAT_R32_UINT, 0);
+			cmd.SetPrimitiveTopology(batch.topology);
+			cmd.SetConstantBuffer(ShaderStage::Vertex, job.instanceCBufSlot, job.instanceRing, batch.allocation.firstConstant, batch.allocation.numConstants);
+
+			cmd.DrawIndexedInstanced(batch.indexCount, batch.instances, batch.startIndex, batch.baseVertex, 0);
 		}
+	}
+
+
+
 
-		// scene rtv
-		{
-			if (m_resLib.Exist<RenderTargetView>(RTV_SCENE))
-			{
-				m_resLib.Remove<RenderTargetView>(RTV_SCENE);
-				m_resLib.Remove<ShaderResourceView>(RTV_SCENE);
-			}
 
-			D3D11_RENDER_TARGET_VIEW_DESC desc = {};
-			desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-			desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-			desc.Texture2D.MipSlice = 0;
 
-			D3D11_TEXTURE2D_DESC texDesc = {};
-			texDesc.Width = width;
-			texDesc.Height = height;
-			texDesc.ArraySize = 1;
-			texDesc.MipLevels = 1;
-			texDesc.Format = desc.Format;
-			texDesc.SampleDesc.Count = 1;
-			texDesc.SampleDesc.Quality = 0;
-			texDesc.Usage = D3D11_USAGE_DEFAULT;
-			texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-			texDesc.CPUAccessFlags = 0;
-			texDesc.MiscFlags = 0;
 
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
 
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = texDesc.Format;
-			srvDesc.Texture2D.MipLevels = 1;
-			srvDesc.Texture2D.MostDetailedMip = 0;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 
-			m_resLib.Add(RTV_SCENE, ShaderResourceView::Create(m_context, srvDesc, tex));
-			m_resLib.Add(RTV_SCENE, RenderTargetView::Create(m_context, desc, tex));
-		}
 
 
-		// scene dsv
-		{
-			if (m_resLib.Exist<DepthStencilView>(DSV_SCENE))
-				m_resLib.Remove<DepthStencilView>(DSV_SCENE);
 
-			D3D11_DEPTH_STENCIL_VIEW_DESC desc = {};
-			desc.Format = DXGI_FORMAT_D32_FLOAT;
-			desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-			desc.Texture2D.MipSlice = 0;
 
-			D3D11_TEXTURE2D_DESC texDesc = {};
-			texDesc.Width = width;
-			texDesc.Height = height;
-			texDesc.ArraySize = 1;
-			texDesc.MipLevels = 1;
-			texDesc.Format = desc.Format;
-			texDesc.SampleDesc.Count = 1;
-			texDesc.SampleDesc.Quality = 0;
-			texDesc.Usage = D3D11_USAGE_DEFAULT;
-			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-			texDesc.CPUAccessFlags = 0;
-			texDesc.MiscFlags = 0;
 
-			m_resLib.Add(DSV_SCENE, DepthStencilView::Create(m_context, desc, Texture2D::Create(m_context, texDesc, (void*)nullptr)));
-		}
 
-		// transparent mesh rtv
-		{
-			if (m_resLib.Exist<RenderTargetViewArray>(RTVA_TRANSPARENT_PHONG_PASS))
-			{
-				m_resLib.Remove<RenderTargetViewArray>(RTVA_TRANSPARENT_PHONG_PASS);
-				m_resLib.Remove<ShaderResourceView>(SRV_TRANSPARENT_PHONG_PASS_ACC);
-				m_resLib.Remove<ShaderResourceView>(SRV_TRANSPARENT_PHONG_PASS_REV);
-			}
 
-			auto rtvArr = std::make_shared<RenderTargetViewArray>();
 
-			// accumulation rtv
-			{
-				D3D11_RENDER_TARGET_VIEW_DESC desc = {};
-				desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-				desc.Texture2D.MipSlice = 0;
-				desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
 
-				D3D11_TEXTURE2D_DESC texDesc = {};
-				texDesc.Width = width;
-				texDesc.Height = height;
-				texDesc.ArraySize = 1;
-				texDesc.MipLevels = 1;
-				texDesc.Format = desc.Format;
-				texDesc.SampleDesc.Count = 1;
-				texDesc.SampleDesc.Quality = 0;
-				texDesc.Usage = D3D11_USAGE_DEFAULT;
-				texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-				texDesc.CPUAccessFlags = 0;
-				texDesc.MiscFlags = 0;
 
-				D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-				srvDesc.Format = texDesc.Format;
-				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-				srvDesc.Texture2D.MipLevels = 1;
-				srvDesc.Texture2D.MostDetailedMip = 0;
 
-				auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
-				auto rtv = RenderTargetView::Create(m_context, desc, tex);
-				m_resLib.Add(SRV_TRANSPARENT_PHONG_PASS_ACC, ShaderResourceView::Create(m_context, srvDesc, tex));
 
-				rtvArr->push_back(rtv);
-			}
 
-			// reveal rtv
+	void LambertianRenderGraph::ResizeViews(uint32_t width, uint32_t height)
+	{
+		// the swap chain already has that size
+		if (m_resLib.Exist<RenderTargetView>(RTV_MAIN) && width == m_windowWidth && height == m_windowHeight)
+			return;
+
+		m_windowWidth = width;
+		m_windowHeight = height;
+		SetResolutionScale(m_resolutionScale);
+
+		// last frame's passes still hold the back buffer
+		m_frameGraph.Reset();
+
+		// main rtv
+		{
+			if (m_resLib.Exist<RenderTargetView>(RTV_MAIN))
 			{
-				D3D11_RENDER_TARGET_VIEW_DESC desc = {};
-				desc.Format = DXGI_FORMAT_R8_UNORM;
-				desc.Texture2D.MipSlice = 0;
-				desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+				m_resLib.Remove<RenderTargetView>(RTV_MAIN);
+				if (m_resLib.Exist<RenderTargetView>(RTV_MAIN_SRGB))
+					m_resLib.Remove<RenderTargetView>(RTV_MAIN_SRGB);
+				HRESULT hr;
+				if (m_context->GetSwapChain())
+					GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->ResizeBuffers(1, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0));
+			}
 
+			D3D11_RENDER_TARGET_VIEW_DESC desc = {};
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+			desc.Texture2D.MipSlice = 0;
+			std::shared_ptr<Texture2D> tex;
+			if (m_context->GetSwapChain())
+			{
+				ComPtr<ID3D11Texture2D> backbuffer;
+				HRESULT hr;
+				GDX11_CONTEXT_THROW_INFO(m_context->GetSwapChain()->GetBuffer(0, __uuidof(ID3D11Texture2D), &backbuffer));
+				tex = Texture2D::Create(m_context, backbuffer.Get());
+			}
+			else
+			{
+				// headless, an offscreen texture stands in for the back buffer
 				D3D11_TEXTURE2D_DESC texDesc = {};
 				texDesc.Width = width;
 				texDesc.Height = height;
-				texDesc.ArraySize = 1;
 				texDesc.MipLevels = 1;
-				texDesc.Format = desc.Format;
+				texDesc.ArraySize = 1;
+				texDesc.Format = DXGI_FORMAT_R8G8B8A8_TYPELESS;
 				texDesc.SampleDesc.Count = 1;
 				texDesc.SampleDesc.Quality = 0;
 				texDesc.Usage = D3D11_USAGE_DEFAULT;
-				texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+				texDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
 				texDesc.CPUAccessFlags = 0;
 				texDesc.MiscFlags = 0;
-
-				D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-				srvDesc.Format = texDesc.Format;
-				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-				srvDesc.Texture2D.MipLevels = 1;
-				srvDesc.Texture2D.MostDetailedMip = 0;
-
-				auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
-				auto rtv = RenderTargetView::Create(m_context, desc, tex);
-				m_resLib.Add(SRV_TRANSPARENT_PHONG_PASS_REV, ShaderResourceView::Create(m_context, srvDesc, tex));
-
-				rtvArr->push_back(rtv);
+				tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
 			}
-
-			m_resLib.Add(RTVA_TRANSPARENT_PHONG_PASS, rtvArr);
+			m_resLib.Add(RTV_MAIN, RenderTargetView::Create(m_context, desc, tex));
+
+			// the final pass writes linear colours through an _SRGB view of the same buffer, the hardware encodes them.
+			// a blt model swap chain doesn't have to allow that view of its buffer, without it the shader keeps the gamma op
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			ComPtr<ID3D11RenderTargetView> srgbRTV;
+			if (SUCCEEDED(m_context->GetDevice()->CreateRenderTargetView(tex->GetNative(), &desc, &srgbRTV)))
+				m_resLib.Add(RTV_MAIN_SRGB, RenderTargetView::Create(m_context, srgbRTV.Get(), tex));
 		}
 	}
 
-	void LambertianRenderGraph::SetShaders()
+	void LambertianRenderGraph::SetResolutionScale(float scale)
 	{
-		m_resLib.Add(VS_PHONG, VertexShader::Create(m_context, "res/cso/phong.vs.cso"));
-		m_resLib.Add(PS_PHONG, PixelShader::Create(m_context, "res/cso/phong.ps.cso"));
-		m_resLib.Add(PS_PHONG_OIT, PixelShader::Create(m_context, "res/cso/phong_oit.ps.cso"));
-		m_resLib.Add(IL_PHONG, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_PHONG)));
+		m_resolutionScale = std::clamp(scale, 0.0f, 1.0f);
+		m_renderWidth = std::max((uint32_t)(m_windowWidth * m_resolutionScale + 0.5f), 1u);
+		m_renderHeight = std::max((uint32_t)(m_windowHeight * m_resolutionScale + 0.5f), 1u);
+	}
 
-		m_resLib.Add(VS_FS_OUT_TC_POS, VertexShader::Create(m_context, "res/cso/fullscreen_out_tc_pos.vs.cso"));
-		m_resLib.Add(IL_FS_OUT_TC_POS, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_FS_OUT_TC_POS)));
+	void LambertianRenderGraph::SetShaders()
+	{
+		// files are only loaded once a pass using them runs. an empty file is the null shader
+		auto declareVS = [this](const char* key, const char* file) { m_resLib.Declare<VertexShader>(key, [this, file]() { return m_shared->GetVertexShader(file); }); };
+		auto declarePS = [this](const char* key, const char* file) { m_resLib.Declare<PixelShader>(key, [this, file]() { return m_shared->GetPixelShader(file); }); };
+		auto declareGS = [this](const char* key, const char* file) { m_resLib.Declare<GeometryShader>(key, [this, file]() { return m_shared->GetGeometryShader(file); }); };
+		auto declareIL = [this](const char* key, const char* file) { m_resLib.Declare<InputLayout>(key, [this, file]() { return m_shared->GetInputLayout(file); }); };
 
-		m_resLib.Add(VS_FS_OUT_POS, VertexShader::Create(m_context, "res/cso/fullscreen_out_pos.vs.cso"));
-		m_resLib.Add(IL_FS_OUT_POS, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_FS_OUT_POS)));
+		declareVS(VS_PHONG, "res/cso/phong.vs.cso");
+		declarePS(PS_PHONG, "res/cso/phong.ps.cso");
+		declarePS(PS_PHONG_OIT, "res/cso/phong_oit.ps.cso");
+		declareIL(IL_PHONG, "res/cso/phong.vs.cso");
 
-		m_resLib.Add(PS_PHONG_OIT_COMPOSITE, PixelShader::Create(m_context, "res/cso/phong_oit_composite.ps.cso"));
-		m_resLib.Add(PS_GAMMA_CORRECTION, PixelShader::Create(m_context, "res/cso/gamma_correction.ps.cso"));
+		declareVS(VS_SKYBOX, "res/cso/skybox.vs.cso");
+		declarePS(PS_SKYBOX, "res/cso/skybox.ps.cso");
+		declareIL(IL_SKYBOX, "res/cso/skybox.vs.cso");
 
-		m_resLib.Add(VS_SKYBOX, VertexShader::Create(m_context, "res/cso/skybox.vs.cso"));
-		m_resLib.Add(PS_SKYBOX, PixelShader::Create(m_context, "res/cso/skybox.ps.cso"));
-		m_resLib.Add(IL_SKYBOX, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_SKYBOX)));
+		declareVS(VS_BASIC, "res/cso/basic.vs.cso");
+		declarePS(PS_NULLPTR, "");
+		declareIL(IL_BASIC, "res/cso/basic.vs.cso");
 
-		m_resLib.Add(VS_BASIC, VertexShader::Create(m_context, "res/cso/basic.vs.cso"));
-		m_resLib.Add(PS_NULLPTR, PixelShader::Create(m_context));
-		m_resLib.Add(IL_BASIC, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_BASIC)));
+		declareVS(VS_DEPTH_PREPASS, "res/cso/depth_prepass.vs.cso");
+		declareIL(IL_DEPTH_PREPASS, "res/cso/depth_prepass.vs.cso");
 
-		m_resLib.Add(VS_CUBE_SHADOW_MAP, VertexShader::Create(m_context, "res/cso/cube_shadow_map.vs.cso"));
-		m_resLib.Add(GS_CUBE_SHADOW_MAP, GeometryShader::Create(m_context, "res/cso/cube_shadow_map.gs.cso"));
-		m_resLib.Add(IL_CUBE_SHADOW_MAP, InputLayout::Create(m_context, m_resLib.Get<VertexShader>(VS_CUBE_SHADOW_MAP)));
+		declareVS(VS_CUBE_SHADOW_MAP, "res/cso/cube_shadow_map.vs.cso");
+		declareGS(GS_CUBE_SHADOW_MAP, "res/cso/cube_shadow_map.gs.cso");
+		declareIL(IL_CUBE_SHADOW_MAP, "res/cso/cube_shadow_map.vs.cso");
 
-		m_resLib.Add(GS_NULLPTR, GeometryShader::Create(m_context));
+		declareGS(GS_NULLPTR, "");
 	}
 
 	void LambertianRenderGraph::SetStates()
 	{
 		// rs
 		{
-			m_resLib.Add(S_DEFAULT, RasterizerState::Create(m_context, CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT())));
+			m_resLib.Declare<RasterizerState>(S_DEFAULT, [this]() { return m_shared->GetRasterizerState(CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT())); });
 
 			D3D11_RASTERIZER_DESC desc = CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT());
 			desc.CullMode = D3D11_CULL_NONE;
-			m_resLib.Add(RS_CULL_NONE, RasterizerState::Create(m_context, desc));
+			m_resLib.Declare<RasterizerState>(RS_CULL_NONE, [this, desc]() { return m_shared->GetRasterizerState(desc); });
 
 			desc = CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT());
 			desc.DepthBias = 40;
 			desc.SlopeScaledDepthBias = 6.0f;
 			desc.DepthBiasClamp = 1.0f;
-			m_resLib.Add(RS_DEPTH_SLOPE_SCALED_BIAS, RasterizerState::Create(m_context, desc));
+			m_resLib.Declare<RasterizerState>(RS_DEPTH_SLOPE_SCALED_BIAS, [this, desc]() { return m_shared->GetRasterizerState(desc); });
 		}
 
 		// bs
 		{
-			m_resLib.Add(S_DEFAULT, BlendState::Create(m_context, CD3D11_BLEND_DESC(CD3D11_DEFAULT())));
-
-			// over op
-			D3D11_BLEND_DESC desc = CD3D11_BLEND_DESC(CD3D11_DEFAULT());
-			desc.AlphaToCoverageEnable = FALSE;
-			desc.IndependentBlendEnable = FALSE;
-			desc.RenderTarget[0].BlendEnable = TRUE;
-			desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-			desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-			desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-			desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-			desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
-			desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-			desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-			m_resLib.Add(BS_OVER_OP, BlendState::Create(m_context, desc));
-
-
+			m_resLib.Declare<BlendState>(S_DEFAULT, [this]() { return m_shared->GetBlendState(CD3D11_BLEND_DESC(CD3D11_DEFAULT())); });
 
 			//  weighted blended oit 
-			desc = CD3D11_BLEND_DESC(CD3D11_DEFAULT());
+			D3D11_BLEND_DESC desc = CD3D11_BLEND_DESC(CD3D11_DEFAULT());
 			desc.AlphaToCoverageEnable = FALSE;
 			desc.IndependentBlendEnable = TRUE;
 
@@ -936,21 +1104,26 @@ namespace GA
 			brt1.SrcBlendAlpha = D3D11_BLEND_ZERO;
 			brt1.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
 			brt1.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-			m_resLib.Add(BS_WEIGHTED_BLENDED_OIT_OP, BlendState::Create(m_context, desc));
+			m_resLib.Declare<BlendState>(BS_WEIGHTED_BLENDED_OIT_OP, [this, desc]() { return m_shared->GetBlendState(desc); });
 		}
 
 		// dss
 		{
-			m_resLib.Add(S_DEFAULT, DepthStencilState::Create(m_context, CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT())));
+			m_resLib.Declare<DepthStencilState>(S_DEFAULT, [this]() { return m_shared->GetDepthStencilState(CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT())); });
 
 			D3D11_DEPTH_STENCIL_DESC desc = CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT());
 			desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-			m_resLib.Add(DSS_DEPTH_WRITE_ZERO, DepthStencilState::Create(m_context, desc));
+			m_resLib.Declare<DepthStencilState>(DSS_DEPTH_WRITE_ZERO, [this, desc]() { return m_shared->GetDepthStencilState(desc); });
 
 			desc = CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT());
 			desc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
 			desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-			m_resLib.Add(DSS_DEPTH_WRITE_ZERO_OP_LESS_EQUAL, DepthStencilState::Create(m_context, desc));
+			m_resLib.Declare<DepthStencilState>(DSS_DEPTH_WRITE_ZERO_OP_LESS_EQUAL, [this, desc]() { return m_shared->GetDepthStencilState(desc); });
+
+			desc = CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT());
+			desc.DepthFunc = D3D11_COMPARISON_EQUAL;
+			desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+			m_resLib.Declare<DepthStencilState>(DSS_DEPTH_WRITE_ZERO_OP_EQUAL, [this, desc]() { return m_shared->GetDepthStencilState(desc); });
 		}
 
 		// ss
@@ -964,7 +1137,7 @@ namespace GA
 				desc.BorderColor[i] = 0.0f;
 			desc.MinLOD = 0.0f;
 			desc.MaxLOD = D3D11_FLOAT32_MAX;
-			m_resLib.Add(SS_POINT_CLAMP, SamplerState::Create(m_context, desc));
+			m_resLib.Declare<SamplerState>(SS_POINT_CLAMP, [this, desc]() { return m_shared->GetSamplerState(desc); });
 
 			desc = CD3D11_SAMPLER_DESC(CD3D11_DEFAULT());
 			desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -975,47 +1148,88 @@ namespace GA
 				desc.BorderColor[i] = 0.0f;
 			desc.MinLOD = 0.0f;
 			desc.MaxLOD = D3D11_FLOAT32_MAX;
-			m_resLib.Add(SS_LINEAR_CLAMP, SamplerState::Create(m_context, desc));
+			m_resLib.Declare<SamplerState>(SS_LINEAR_CLAMP, [this, desc]() { return m_shared->GetSamplerState(desc); });
 		}
 	}
 
-	void LambertianRenderGraph::SetBuffers()
+	void LambertianRenderGraph::SetPipelineStates()
 	{
-		// fs quad
-		{
-			float vert[] =
-			{
-				-1.0f,  1.0f,
-				 1.0f,  1.0f,
-				 1.0f, -1.0f,
-				-1.0f, -1.0f
-			};
+		// every pass states all of its stages, nothing leaks over from the pass before.
+		// stages left null are unbound (gs, ps) or the runtime default. the shaders and states are only created
+		// along with the first pipeline state using them
+		PipelineStateKeys keys = {};
+		keys.rasterizerState = S_DEFAULT;
+		keys.blendState = S_DEFAULT;
+		keys.depthStencilState = S_DEFAULT;
+
+		// solid phong
+		keys.vs = VS_PHONG;
+		keys.ps = PS_PHONG;
+		keys.inputLayout = IL_PHONG;
+		DeclarePipelineState(PSO_SOLID_PHONG, keys);
+
+		// after a depth pre-pass
+		keys.depthStencilState = DSS_DEPTH_WRITE_ZERO_OP_EQUAL;
+		DeclarePipelineState(PSO_SOLID_PHONG_EQUAL, keys);
+
+		// transparent phong
+		keys.ps = PS_PHONG_OIT;
+		keys.rasterizerState = RS_CULL_NONE;
+		keys.blendState = BS_WEIGHTED_BLENDED_OIT_OP;
+		keys.depthStencilState = DSS_DEPTH_WRITE_ZERO;
+		DeclarePipelineState(PSO_TRANSPARENT_PHONG, keys);
+
+		// skybox
+		keys.vs = VS_SKYBOX;
+		keys.ps = PS_SKYBOX;
+		keys.inputLayout = IL_SKYBOX;
+		keys.blendState = S_DEFAULT;
+		keys.depthStencilState = DSS_DEPTH_WRITE_ZERO_OP_LESS_EQUAL;
+		DeclarePipelineState(PSO_SKYBOX, keys);
+
+		// shadow maps, depth only
+		keys.ps = nullptr;
+		keys.rasterizerState = RS_DEPTH_SLOPE_SCALED_BIAS;
+		keys.blendState = S_DEFAULT;
+		keys.depthStencilState = S_DEFAULT;
+
+		keys.vs = VS_BASIC;
+		keys.inputLayout = IL_BASIC;
+		DeclarePipelineState(PSO_SHADOW_MAP, keys);
+
+		// depth pre-pass, no bias
+		keys.rasterizerState = S_DEFAULT;
+		keys.vs = VS_DEPTH_PREPASS;
+		keys.inputLayout = IL_DEPTH_PREPASS;
+		DeclarePipelineState(PSO_DEPTH_PREPASS, keys);
+		keys.rasterizerState = RS_DEPTH_SLOPE_SCALED_BIAS;
+
+		keys.vs = VS_CUBE_SHADOW_MAP;
+		keys.gs = GS_CUBE_SHADOW_MAP;
+		keys.inputLayout = IL_CUBE_SHADOW_MAP;
+		DeclarePipelineState(PSO_CUBE_SHADOW_MAP, keys);
+	}
 
-			uint32_t ind[] = 
+	void LambertianRenderGraph::DeclarePipelineState(const char* key, const PipelineStateKeys& keys)
+	{
+		m_resLib.Declare<PipelineState>(key, [this, keys]()
 			{
-				0, 1, 2,
-				2, 3, 0
-			};
-
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(vert);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 2 * sizeof(float);
-			m_resLib.Add(VB_FS_QUAD, Buffer::Create(m_context, desc, vert));
-
-			desc = {};
-			desc.ByteWidth = sizeof(ind);
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(uint32_t);
-			m_resLib.Add(IB_FS_QUAD, Buffer::Create(m_context, desc, ind));
-		}
+				PipelineStateDesc desc = {};
+				desc.sampleMask = 0xff;
+				desc.stencilRef = 0xff;
+				desc.vs = m_resLib.Get<VertexShader>(keys.vs);
+				desc.gs = keys.gs ? m_resLib.Get<GeometryShader>(keys.gs) : nullptr;
+				desc.ps = keys.ps ? m_resLib.Get<PixelShader>(keys.ps) : nullptr;
+				desc.inputLayout = m_resLib.Get<InputLayout>(keys.inputLayout);
+				desc.rasterizerState = m_resLib.Get<RasterizerState>(keys.rasterizerState);
+				desc.blendState = m_resLib.Get<BlendState>(keys.blendState);
+				desc.depthStencilState = m_resLib.Get<DepthStencilState>(keys.depthStencilState);
+				return PipelineState::Create(m_context, desc);
+			});
+	}
 
+	void LambertianRenderGraph::SetBuffers()
+	{
 		// cube
 		{
 			auto vert = GA::Utils::CreateCubeVerticesCompact(-1.0f, 1.0f);
@@ -1028,7 +1242,7 @@ namespace GA
 			desc.CPUAccessFlags = 0;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = 3 * sizeof(float);
-			m_resLib.Add(VB_CUBE, Buffer::Create(m_context, desc, vert.data()));
+			m_resLib.Declare<Buffer>(VB_CUBE, [this, desc, vert]() { return m_shared->GetStaticBuffer(desc, vert.data()); });
 
 			desc = {};
 			desc.ByteWidth = (uint32_t)ind.size() * sizeof(uint32_t);
@@ -1037,7 +1251,7 @@ namespace GA
 			desc.CPUAccessFlags = 0;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = sizeof(uint32_t);
-			m_resLib.Add(IB_CUBE, Buffer::Create(m_context, desc, ind.data()));
+			m_resLib.Declare<Buffer>(IB_CUBE, [this, desc, ind]() { return m_shared->GetStaticBuffer(desc, ind.data()); });
 		}
 
 		// phong cbufs
@@ -1049,16 +1263,7 @@ namespace GA
 			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_PHONG_SYSTEM, Buffer::Create(m_context, desc, nullptr));
-
-			desc = {};
-			desc.ByteWidth = sizeof(GA::Utils::PhongVSEntityCBuf);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_PHONG_ENTITY, Buffer::Create(m_context, desc, nullptr));
+			m_resLib.Declare<Buffer>(CB_VS_PHONG_SYSTEM, [this, desc]() { return Buffer::Create(m_context, desc, nullptr); });
 
 			desc = {};
 			desc.ByteWidth = sizeof(GA::Utils::PhongPSSystemCBuf);
@@ -1067,27 +1272,7 @@ namespace GA
 			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_PS_PHONG_SYSTEM, Buffer::Create(m_context, desc, nullptr));
-
-			desc = {};
-			desc.ByteWidth = sizeof(GA::Utils::PhongPSEntityCBuf);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_PS_PHONG_ENTITY, Buffer::Create(m_context, desc, nullptr));
-		}
-
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(XMFLOAT4);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_PS_GAMMA_CORRECTION_SYSTEM, Buffer::Create(m_context, desc, nullptr));
+			m_resLib.Declare<Buffer>(CB_PS_PHONG_SYSTEM, [this, desc]() { return Buffer::Create(m_context, desc, nullptr); });
 		}
 
 		{
@@ -1098,7 +1283,7 @@ namespace GA
 			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_SKYBOX_SYSTEM, Buffer::Create(m_context, desc, nullptr));
+			m_resLib.Declare<Buffer>(CB_VS_SKYBOX_SYSTEM, [this, desc]() { return Buffer::Create(m_context, desc, nullptr); });
 		}
 
 		{
@@ -1109,31 +1294,10 @@ namespace GA
 			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_BASIC_SYSTEM, Buffer::Create(m_context, desc, nullptr));
+			m_resLib.Declare<Buffer>(CB_VS_BASIC_SYSTEM, [this, desc]() { return Buffer::Create(m_context, desc, nullptr); });
 		}
 
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(XMFLOAT4X4);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_BASIC_ENTITY, Buffer::Create(m_context, desc, nullptr));
-		}
-
-
-		{
-			D3D11_BUFFER_DESC desc = {};
-			desc.ByteWidth = sizeof(XMFLOAT4X4);
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_VS_CUBE_SHADOW_MAP_ENTITY, Buffer::Create(m_context, desc, nullptr));
-		}
+		m_resLib.Declare<ConstantRing>(CR_INSTANCE, [this]() { return ConstantRing::Create(m_context, CONSTANT_RING_SIZE); });
 
 		{
 			D3D11_BUFFER_DESC desc = {};
@@ -1143,12 +1307,14 @@ namespace GA
 			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 			desc.MiscFlags = 0;
 			desc.StructureByteStride = 0;
-			m_resLib.Add(CB_GS_CUBE_SHADOW_MAP_SYSTEM, Buffer::Create(m_context, desc, nullptr));
+			m_resLib.Declare<Buffer>(CB_GS_CUBE_SHADOW_MAP_SYSTEM, [this, desc]() { return Buffer::Create(m_context, desc, nullptr); });
 		}
 	}
 
 	void LambertianRenderGraph::SetLightDepthBuffers()
 	{
+		// the maps of a light type are created when the first light of that type renders its shadow,
+		// the views of a type all come from the same two textures
 		// dir light depth buffers
 		{
 			D3D11_TEXTURE2D_DESC texDesc = {};
@@ -1163,7 +1329,21 @@ namespace GA
 			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 			texDesc.CPUAccessFlags = 0;
 			texDesc.MiscFlags = 0;
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
+			m_resLib.Declare<ShaderResourceView>(SRV_DIRLIGHT_SHADOW_MAP, [this, texDesc]()
+				{
+					D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+					srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+					srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+					srvDesc.Texture2DArray.ArraySize = GA::Utils::s_maxLights;
+					srvDesc.Texture2DArray.FirstArraySlice = 0;
+					srvDesc.Texture2DArray.MipLevels = 1;
+					srvDesc.Texture2DArray.MostDetailedMip = 0;
+					return ShaderResourceView::Create(m_context, srvDesc, Texture2D::Create(m_context, texDesc, (void*)nullptr));
+				});
+
+			// static casters only, copied into the shadow maps before dynamic casters are drawn
+			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+			m_resLib.Declare<Texture2D>(TEX_DIRLIGHT_STATIC_SHADOW_MAP, [this, texDesc]() { return Texture2D::Create(m_context, texDesc, (void*)nullptr); });
 
 			for (int i = 0; i < GA::Utils::s_maxLights; i++)
 			{
@@ -1173,17 +1353,11 @@ namespace GA
 				dsvDesc.Texture2DArray.FirstArraySlice = i;
 				dsvDesc.Texture2DArray.ArraySize = 1;
 				dsvDesc.Texture2DArray.MipSlice = 0;
-				m_resLib.Add(DSV_DIRLIGHT_SHADOW_MAP(i), DepthStencilView::Create(m_context, dsvDesc, tex));
+				m_resLib.Declare<DepthStencilView>(DSV_DIRLIGHT_SHADOW_MAP(i), [this, dsvDesc]()
+					{ return DepthStencilView::Create(m_context, dsvDesc, m_resLib.Get<ShaderResourceView>(SRV_DIRLIGHT_SHADOW_MAP)->GetTexture2D()); });
+				m_resLib.Declare<DepthStencilView>(DSV_DIRLIGHT_STATIC_SHADOW_MAP(i), [this, dsvDesc]()
+					{ return DepthStencilView::Create(m_context, dsvDesc, m_resLib.Get<Texture2D>(TEX_DIRLIGHT_STATIC_SHADOW_MAP)); });
 			}
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-			srvDesc.Texture2DArray.ArraySize = GA::Utils::s_maxLights;
-			srvDesc.Texture2DArray.FirstArraySlice = 0;
-			srvDesc.Texture2DArray.MipLevels = 1;
-			srvDesc.Texture2DArray.MostDetailedMip = 0;
-			m_resLib.Add(SRV_DIRLIGHT_SHADOW_MAP, ShaderResourceView::Create(m_context, srvDesc, tex));
 		}
 
 		// point light depth buffers
@@ -1200,7 +1374,21 @@ namespace GA
 			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 			texDesc.CPUAccessFlags = 0;
 			texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
+			m_resLib.Declare<ShaderResourceView>(SRV_POINTLIGHT_SHADOW_MAP, [this, texDesc]()
+				{
+					D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+					srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+					srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+					srvDesc.Texture2DArray.ArraySize = GA::Utils::s_maxLights;
+					srvDesc.Texture2DArray.FirstArraySlice = 0;
+					srvDesc.Texture2DArray.MipLevels = 1;
+					srvDesc.Texture2DArray.MostDetailedMip = 0;
+					return ShaderResourceView::Create(m_context, srvDesc, Texture2D::Create(m_context, texDesc, (void*)nullptr));
+				});
+
+			// static casters only, copied into the shadow maps before dynamic casters are drawn
+			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+			m_resLib.Declare<Texture2D>(TEX_POINTLIGHT_STATIC_SHADOW_MAP, [this, texDesc]() { return Texture2D::Create(m_context, texDesc, (void*)nullptr); });
 
 			for (int i = 0; i < GA::Utils::s_maxLights; i++)
 			{
@@ -1210,20 +1398,14 @@ namespace GA
 				dsvDesc.Texture2DArray.FirstArraySlice = i * 6;
 				dsvDesc.Texture2DArray.ArraySize = 6;
 				dsvDesc.Texture2DArray.MipSlice = 0;
-				m_resLib.Add(DSV_POINTLIGHT_SHADOW_MAP(i), DepthStencilView::Create(m_context, dsvDesc, tex));
+				m_resLib.Declare<DepthStencilView>(DSV_POINTLIGHT_SHADOW_MAP(i), [this, dsvDesc]()
+					{ return DepthStencilView::Create(m_context, dsvDesc, m_resLib.Get<ShaderResourceView>(SRV_POINTLIGHT_SHADOW_MAP)->GetTexture2D()); });
+				m_resLib.Declare<DepthStencilView>(DSV_POINTLIGHT_STATIC_SHADOW_MAP(i), [this, dsvDesc]()
+					{ return DepthStencilView::Create(m_context, dsvDesc, m_resLib.Get<Texture2D>(TEX_POINTLIGHT_STATIC_SHADOW_MAP)); });
 			}
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
-			srvDesc.Texture2DArray.ArraySize = GA::Utils::s_maxLights;
-			srvDesc.Texture2DArray.FirstArraySlice = 0;
-			srvDesc.Texture2DArray.MipLevels = 1;
-			srvDesc.Texture2DArray.MostDetailedMip = 0;
-			m_resLib.Add(SRV_POINTLIGHT_SHADOW_MAP, ShaderResourceView::Create(m_context, srvDesc, tex));
 		}
 
-		// wpot light depth buffers
+		// spot light depth buffers
 		{
 			D3D11_TEXTURE2D_DESC texDesc = {};
 			texDesc.Width = SHADOWMAP_SIZE;
@@ -1237,7 +1419,21 @@ namespace GA
 			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 			texDesc.CPUAccessFlags = 0;
 			texDesc.MiscFlags = 0;
-			auto tex = Texture2D::Create(m_context, texDesc, (void*)nullptr);
+			m_resLib.Declare<ShaderResourceView>(SRV_SPOTLIGHT_SHADOW_MAP, [this, texDesc]()
+				{
+					D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+					srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+					srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+					srvDesc.Texture2DArray.ArraySize = GA::Utils::s_maxLights;
+					srvDesc.Texture2DArray.FirstArraySlice = 0;
+					srvDesc.Texture2DArray.MipLevels = 1;
+					srvDesc.Texture2DArray.MostDetailedMip = 0;
+					return ShaderResourceView::Create(m_context, srvDesc, Texture2D::Create(m_context, texDesc, (void*)nullptr));
+				});
+
+			// static casters only, copied into the shadow maps before dynamic casters are drawn
+			texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+			m_resLib.Declare<Texture2D>(TEX_SPOTLIGHT_STATIC_SHADOW_MAP, [this, texDesc]() { return Texture2D::Create(m_context, texDesc, (void*)nullptr); });
 
 			for (int i = 0; i < GA::Utils::s_maxLights; i++)
 			{
@@ -1247,17 +1443,11 @@ namespace GA
 				dsvDesc.Texture2DArray.FirstArraySlice = i;
 				dsvDesc.Texture2DArray.ArraySize = 1;
 				dsvDesc.Texture2DArray.MipSlice = 0;
-				m_resLib.Add(DSV_SPOTLIGHT_SHADOW_MAP(i), DepthStencilView::Create(m_context, dsvDesc, tex));
+				m_resLib.Declare<DepthStencilView>(DSV_SPOTLIGHT_SHADOW_MAP(i), [this, dsvDesc]()
+					{ return DepthStencilView::Create(m_context, dsvDesc, m_resLib.Get<ShaderResourceView>(SRV_SPOTLIGHT_SHADOW_MAP)->GetTexture2D()); });
+				m_resLib.Declare<DepthStencilView>(DSV_SPOTLIGHT_STATIC_SHADOW_MAP(i), [this, dsvDesc]()
+					{ return DepthStencilView::Create(m_context, dsvDesc, m_resLib.Get<Texture2D>(TEX_SPOTLIGHT_STATIC_SHADOW_MAP)); });
 			}
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-			srvDesc.Texture2DArray.ArraySize = GA::Utils::s_maxLights;
-			srvDesc.Texture2DArray.FirstArraySlice = 0;
-			srvDesc.Texture2DArray.MipLevels = 1;
-			srvDesc.Texture2DArray.MostDetailedMip = 0;
-			m_resLib.Add(SRV_SPOTLIGHT_SHADOW_MAP, ShaderResourceView::Create(m_context, srvDesc, tex));
 		}
 	}
 }
@@ -2,38 +2,201 @@
 #include "Scene/System.h"
 #include "Scene/Camera.h"
 #include "Utils/ResourceLibrary.h"
+#include "Utils/SharedResourceCache.h"
+#include "Utils/ShaderCBuf.h"
+#include "Scene/Components.h"
+#include "Scene/ComponentTracker.h"
+#include "RenderGraph/ShadowScheduler.h"
+#include "RenderGraph/LightCache.h"
+#include "RenderGraph/DrawList.h"
+#include "RenderGraph/InstanceBuffer.h"
+#include "RenderGraph/MaterialCache.h"
+#include "RenderGraph/DepthPrepass.h"
+#include "RenderGraph/FrameGraph.h"
+#include "RenderGraph/PostProcessChain.h"
+#include "RenderGraph/SceneCuller.h"
 
 namespace GA
 {
 	class LambertianRenderGraph : public System
 	{
 	public:
-		LambertianRenderGraph(Scene* scene, GDX11::GDX11Context* context, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight);
+		LambertianRenderGraph(Scene* scene, GDX11::GDX11Context* context, GA::Utils::SharedResourceCache* shared, const Camera* camera, uint32_t windowWidth, uint32_t windowHeight);
 
+		// a camera and the rectangle of the window it is drawn into, the camera's aspect should match
+		struct View
+		{
+			const Camera* camera;
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		struct ShadowRecordingStats
+		{
+			uint32_t jobs;
+			uint32_t packets;
+			uint32_t bytes;
+			uint32_t commandLists; // jobs that went through a deferred context
+			float recordMs;
+		};
+
+		// the graph's camera over the whole window
 		void Execute();
+		// lights, shadow maps, materials and bounds are done once for all views. each view culls against the shared
+		// bounds and runs its own colour passes into its own targets
+		void Execute(const std::vector<View>& views);
 
 		void ResizeViews(uint32_t width, uint32_t height);
+		// fraction of the window the scene is rendered at, the final pass upscales it
+		void SetResolutionScale(float scale);
+		float GetResolutionScale() const { return m_resolutionScale; }
+		uint32_t GetRenderWidth() const { return m_renderWidth; }
+		uint32_t GetRenderHeight() const { return m_renderHeight; }
+
+		ShadowScheduler& GetShadowScheduler() { return m_shadowScheduler; }
+		const LightCache& GetLightCache() const { return m_lightCache; }
+		const DrawList& GetSolidDrawList() const { return m_solidDrawList; }
+		const DrawList& GetTransparentDrawList() const { return m_transparentDrawList; }
+		DepthPrepass& GetDepthPrepass() { return m_depthPrepass; }
+		const FrameGraph& GetFrameGraph() const { return m_frameGraph; }
+		const SceneCuller& GetOpaqueCuller() const { return m_opaqueCuller; }
+		const ShadowRecordingStats& GetShadowRecordingStats() const { return m_shadowRecordingStats; }
 
 	private:
+		struct ShadowSlot
+		{
+			DirectX::XMFLOAT4X4 lightSpace; // light space the stored map was rendered with
+			float nearZ;
+			float farZ;
+		};
+
+		// per frame state of a view, kept until the graph has run
+		struct ViewState
+		{
+			View view;
+			uint32_t index;
+			DirectX::XMFLOAT3 viewPos;
+			DirectX::XMFLOAT4X4 viewProj; // column major
+			uint32_t renderWidth;
+			uint32_t renderHeight;
+			FrameResource scene;
+			FrameResource depth;
+			FrameResource accumulation;
+			FrameResource reveal;
+		};
+
+		// the parts of a draw key that don't depend on the view
+		struct Renderable
+		{
+			entt::entity entity;
+			uint32_t variant;
+			uint32_t material;
+			MaterialSlices slices;
+			uint32_t meshId;
+			DirectX::XMFLOAT3 center;
+		};
+
+		// resource library keys of the objects of a pipeline state, a null shader key leaves the stage unbound
+		struct PipelineStateKeys
+		{
+			const char* vs;
+			const char* gs;
+			const char* ps;
+			const char* inputLayout;
+			const char* rasterizerState;
+			const char* blendState;
+			const char* depthStencilState;
+		};
+
+		// static-only depth a shadow map starts from
+		struct StaticShadowCache
+		{
+			ShadowSlot view;
+			uint64_t version; // m_staticCasterVersion the cache was rendered at
+			bool valid;
+		};
+
+		// a caster batch with everything its draw needs, recording reads neither the registry nor the resource library
+		struct CasterBatch
+		{
+			ID3D11Buffer* vb;
+			uint32_t stride;
+			ID3D11Buffer* ib;
+			D3D11_PRIMITIVE_TOPOLOGY topology;
+			uint32_t indexCount;
+			uint32_t startIndex;
+			int32_t baseVertex;
+			uint32_t instances;
+			GDX11::ConstantAllocation allocation; // instance offset
+			bool isStatic;
+		};
+
+		// one shadow map update, resolved on the main thread and recorded on a worker
+		struct ShadowJob
+		{
+			const GDX11::PipelineState* pso;
+			ID3D11Buffer* cbuf; // light space, or the 6 cube faces for the geometry shader
+			GDX11::ShaderStage cbufStage;
+			uint32_t cbufSlot;
+			uint32_t cbufBytes;
+			DirectX::XMFLOAT4X4 cbufData[6];
+			ID3D11Buffer* instanceRing;
+			uint32_t instanceCBufSlot;
+			uint32_t casterInstancesSlot;
+			GDX11::DepthStencilView* dsv;
+			GDX11::DepthStencilView* staticDsv;
+			bool refreshStatic;
+		};
+
 		void ShadowPass();
-		void SolidPhongPass(const DirectX::XMFLOAT3& viewPos, const DirectX::XMFLOAT4X4& viewProj /*column major*/);
-		void SkyboxPass(const DirectX::XMFLOAT4X4& viewProj /*column major*/);
-		void TransparentPhongPass(const DirectX::XMFLOAT3& viewPos, const DirectX::XMFLOAT4X4& viewProj /*column major*/);
-		void CompositePass();
-		void GammaCorrectionPass();
+		void SolidPhongPass(const std::shared_ptr<GDX11::RenderTargetView>& rtv, const std::shared_ptr<GDX11::DepthStencilView>& dsv, const ViewState& view);
+		void SkyboxPass(const ViewState& view);
+		void TransparentPhongPass(const GDX11::RenderTargetViewArray& rtva, const std::shared_ptr<GDX11::DepthStencilView>& dsv, const ViewState& view);
+
+		// interns materials and mesh ids of the opaque or transparent renderables and builds their culler
+		void GatherRenderables(bool transparent);
+		// collects the gathered renderables the camera sees sorted by state and split into instanced batches
+		void BuildDrawList(DrawList& list, uint32_t pass, bool transparent, const Camera* camera);
+		// uploads the instances of the list and issues one instanced draw per batch. the pass pipeline has to be bound
+		// uncoveredPso is bound for the draws the depth pre-pass left out, null without a pre-pass
+		void DrawEntityBatches(const DrawList& list, const std::shared_ptr<GDX11::VertexShader>& vs, const std::shared_ptr<GDX11::PixelShader>& ps,
+			const std::shared_ptr<GDX11::PipelineState>& uncoveredPso = nullptr);
 
 		void SetLights();
+		// shadow maps of every light type, a type that never had a light binds nothing
+		void BindShadowMaps(const std::shared_ptr<GDX11::PixelShader>& ps);
+		void UpdateShadowCasters();
+		bool ShadowCastersChangedNear(const DirectX::XMFLOAT3& position, float range) const;
+		bool IsStaticShadowCacheValid(uint32_t slot, const ShadowSlot& view) const;
+		// queues the update of the slot's map. the static cache is refreshed if needed, copied into dsv and dynamic casters drawn on top.
+		// the cbuf of the pipeline's shader is filled with cbufData
+		void AddShadowJob(uint32_t slot, const ShadowSlot& view, const char* pso, const char* cbuf, GDX11::ShaderStage cbufStage, const void* cbufData, uint32_t cbufBytes,
+			const std::shared_ptr<GDX11::DepthStencilView>& dsv, const std::shared_ptr<GDX11::DepthStencilView>& staticDsv);
+		// records the queued jobs, in parallel when there are several, and submits them in queue order
+		void RenderShadowMaps();
+		void RecordShadowMap(const ShadowJob& job, GDX11::CommandBuffer& cmd) const;
+		void RecordShadowCasters(const ShadowJob& job, GDX11::CommandBuffer& cmd, bool staticCasters) const;
 
 		void SetShaders();
 		void SetStates();
+		void SetPipelineStates();
+		void DeclarePipelineState(const char* key, const PipelineStateKeys& keys);
 		void SetBuffers();
 		void SetLightDepthBuffers();
 
 		GDX11::GDX11Context* m_context;
+		// states, shaders and static buffers, shared with the other graphs
+		GA::Utils::SharedResourceCache* m_shared;
 		const Camera* m_camera;
 		GA::Utils::ResourceLibrary m_resLib;
+		FrameGraph m_frameGraph;
+		PostProcessChain m_postProcess;
 
 		entt::observer m_renderable;
+		entt::observer m_opaque;
+		entt::observer m_transparent;
 		entt::observer m_dirLights;
 		entt::observer m_pointLights;
 		entt::observer m_spotLights;
@@ -41,5 +204,45 @@ namespace GA
 
 		uint32_t m_windowWidth;
 		uint32_t m_windowHeight;
+		// the scene targets stay window sized, only their top left corner is rendered
+		float m_resolutionScale;
+		uint32_t m_renderWidth;
+		uint32_t m_renderHeight;
+
+		std::vector<ViewState> m_views;
+		std::vector<DirectX::XMFLOAT3> m_viewPositions;
+		std::vector<Renderable> m_opaqueRenderables;
+		std::vector<Renderable> m_transparentRenderables;
+		SceneCuller m_opaqueCuller;
+		SceneCuller m_transparentCuller;
+		std::vector<uint32_t> m_visible;
+
+		DrawList m_solidDrawList; // of the last view
+		DrawList m_transparentDrawList;
+		GA::Utils::TexturePool m_textures;
+		MaterialCache m_materials;
+		DrawIdTable m_meshIds;
+		InstanceBuffer<GA::Utils::EntityInstance> m_entityInstances;
+		DepthPrepass m_depthPrepass;
+
+		LightCache m_lightCache;
+
+		// shadow map updates
+		ShadowScheduler m_shadowScheduler;
+		ComponentTracker<TransformComponent> m_casterTransforms;
+		ComponentTracker<TransformComponent> m_staticCasterTransforms;
+		DrawList m_casterDrawList; // static casters first, batched by mesh
+		InstanceBuffer<DirectX::XMFLOAT4X4> m_casterInstances;
+		std::vector<GDX11::ConstantAllocation> m_batchAllocations;
+		std::vector<CasterBatch> m_casterBatches;
+		std::vector<ShadowJob> m_shadowJobs;
+		std::vector<std::unique_ptr<GDX11::CommandBuffer>> m_shadowCommands; // one per job of the frame
+		ShadowRecordingStats m_shadowRecordingStats;
+		std::vector<DirectX::XMFLOAT4> m_changedCasterBounds; // xyz: center, w: radius
+		uint64_t m_staticCasterTriangles;
+		uint64_t m_dynamicCasterTriangles;
+		uint64_t m_staticCasterVersion;
+		ShadowSlot m_shadowSlots[2 * GA::Utils::s_maxLights];
+		StaticShadowCache m_staticShadowCaches[3 * GA::Utils::s_maxLights]; // point, spot, dir
 	};
 }
\ No newline at end of file
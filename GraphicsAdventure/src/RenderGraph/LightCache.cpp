@@ -0,0 +1,179 @@
+#include "LightCache.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace GA
+{
+	LightCache::LightCache()
+		: m_data(), m_dirLights(), m_pointLights(), m_spotLights(), m_dirtyBegin(0), m_dirtyEnd(sizeof(GA::Utils::PhongPSSystemCBuf)), m_stats()
+	{
+	}
+
+	void LightCache::Begin()
+	{
+		m_stats = {};
+	}
+
+	template<typename T>
+	bool LightCache::Refresh(Entry<T>& entry, entt::entity e, const TransformComponent& transform, const T& params)
+	{
+		if (entry.light == e &&
+			memcmp(&entry.transform, &transform, sizeof(TransformComponent)) == 0 &&
+			memcmp(&entry.params, &params, sizeof(T)) == 0)
+			return false;
+
+		entry.light = e;
+		entry.transform = transform;
+		entry.params = params;
+		return true;
+	}
+
+	template<typename T>
+	void LightCache::Store(T& dst, const T& src)
+	{
+		if (memcmp(&dst, &src, sizeof(T)) == 0) return;
+
+		dst = src;
+
+		uint32_t offset = (uint32_t)((const uint8_t*)&dst - (const uint8_t*)&m_data);
+		m_dirtyBegin = std::min(m_dirtyBegin, offset);
+		m_dirtyEnd = std::max(m_dirtyEnd, offset + (uint32_t)sizeof(T));
+	}
+
+	bool LightCache::UpdateDirLight(uint32_t index, entt::entity e, const TransformComponent& transform, const DirectionalLightComponent& light)
+	{
+		auto& entry = m_dirLights[index];
+		if (!Refresh(entry, e, transform, light)) return false;
+
+		XMMATRIX xmLightSpace = XMMatrixInverse(nullptr, transform.GetTransform()) * XMMatrixOrthographicLH(20.0f, 20.0f, 0.1f, 500.0f);
+		XMStoreFloat4x4(&entry.lightSpace, XMMatrixTranspose(xmLightSpace));
+
+		GA::Utils::PhongPSSystemCBuf::DirectionalLight record = {};
+		XMStoreFloat3(&record.direction, transform.GetForward());
+		record.color = light.color;
+		record.ambientIntensity = light.ambientIntensity;
+		record.intensity = light.intensity;
+		record.lightSpace = entry.lightSpace;
+		Store(m_data.dirLights[index], record);
+
+		++m_stats.changedLights;
+		return true;
+	}
+
+	bool LightCache::UpdatePointLight(uint32_t index, entt::entity e, const TransformComponent& transform, const PointLightComponent& light)
+	{
+		auto& entry = m_pointLights[index];
+		if (!Refresh(entry, e, transform, light)) return false;
+
+		XMStoreFloat4x4(&entry.lightSpace, XMMatrixTranspose(XMMatrixTranslation(-transform.position.x, -transform.position.y, -transform.position.z)));
+
+		XMMATRIX xmProjection = XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 1.0f, light.shadowNearZ, light.shadowFarZ);
+		XMMATRIX xmTranslation = XMMatrixTranslation(transform.position.x, transform.position.y, transform.position.z);
+		XMMATRIX xmFaces[6] =
+		{
+			// + x
+			XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0f, XMConvertToRadians(90.0f), 0.0f)) * xmTranslation) * xmProjection,
+
+			// -x
+			XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0f, XMConvertToRadians(-90.0f), 0.0f)) * xmTranslation) * xmProjection,
+
+			// +y
+			XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(XMConvertToRadians(-90.0f), 0.0f, 0.0f)) * xmTranslation) * xmProjection,
+
+			// -y
+			XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(XMConvertToRadians(90.0f), 0.0f, 0.0f)) * xmTranslation) * xmProjection,
+
+			// +z
+			XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0, 0.0f, 0.0f)) * xmTranslation) * xmProjection,
+
+			// -z
+			XMMatrixInverse(nullptr, XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.0, XMConvertToRadians(180.0f), 0.0f)) * xmTranslation) * xmProjection,
+		};
+
+		for (int i = 0; i < 6; i++)
+			XMStoreFloat4x4(&entry.faces[i], XMMatrixTranspose(xmFaces[i]));
+
+		auto& record = m_data.pointLights[index];
+		Store(record.color, light.color);
+		Store(record.ambientIntensity, light.ambientIntensity);
+		Store(record.position, transform.position);
+		Store(record.intensity, light.intensity);
+
+		++m_stats.changedLights;
+		return true;
+	}
+
+	bool LightCache::UpdateSpotLight(uint32_t index, entt::entity e, const TransformComponent& transform, const SpotLightComponent& light)
+	{
+		auto& entry = m_spotLights[index];
+		if (!Refresh(entry, e, transform, light)) return false;
+
+		XMMATRIX xmLightSpace = XMMatrixInverse(nullptr, transform.GetTransform()) * XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 1.0f, light.shadowNearZ, light.shadowFarZ);
+		XMStoreFloat4x4(&entry.lightSpace, XMMatrixTranspose(xmLightSpace));
+
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, transform.GetForward());
+
+		auto& record = m_data.spotLights[index];
+		Store(record.direction, direction);
+		Store(record.position, transform.position);
+		Store(record.color, light.color);
+		Store(record.ambientIntensity, light.ambientIntensity);
+		Store(record.intensity, light.intensity);
+		Store(record.innerCutOffCosAngle, cosf(XMConvertToRadians(light.innerCutOffAngle)));
+		Store(record.outerCutOffCosAngle, cosf(XMConvertToRadians(light.outerCutOffAngle)));
+
+		++m_stats.changedLights;
+		return true;
+	}
+
+	void LightCache::SetPointLightShadow(uint32_t index, const DirectX::XMFLOAT4X4& lightSpace, float nearZ, float farZ)
+	{
+		auto& record = m_data.pointLights[index];
+		Store(record.lightSpace, lightSpace);
+		Store(record.nearZ, nearZ);
+		Store(record.farZ, farZ);
+	}
+
+	void LightCache::SetSpotLightShadow(uint32_t index, const DirectX::XMFLOAT4X4& lightSpace)
+	{
+		Store(m_data.spotLights[index].lightSpace, lightSpace);
+	}
+
+	void LightCache::SetActiveLights(uint32_t dirLights, uint32_t pointLights, uint32_t spotLights)
+	{
+		Store(m_data.activeDirLights, dirLights);
+		Store(m_data.activePointLights, pointLights);
+		Store(m_data.activeSpotLights, spotLights);
+	}
+
+	void LightCache::Upload(const std::shared_ptr<GDX11::Buffer>& cbuf)
+	{
+		m_stats.uploaded = m_dirtyEnd > m_dirtyBegin;
+		if (!m_stats.uploaded) return;
+
+		m_stats.dirtyOffset = m_dirtyBegin;
+		m_stats.dirtySize = m_dirtyEnd - m_dirtyBegin;
+
+		// the buffer is mapped with WRITE_DISCARD, so the whole record block goes up even for a partial change
+		cbuf->SetData(&m_data);
+
+		m_dirtyBegin = sizeof(GA::Utils::PhongPSSystemCBuf);
+		m_dirtyEnd = 0;
+	}
+
+	void LightCache::Invalidate()
+	{
+		for (auto& e : m_dirLights)
+			e.light = entt::null;
+		for (auto& e : m_pointLights)
+			e.light = entt::null;
+		for (auto& e : m_spotLights)
+			e.light = entt::null;
+
+		m_dirtyBegin = 0;
+		m_dirtyEnd = sizeof(GA::Utils::PhongPSSystemCBuf);
+	}
+}
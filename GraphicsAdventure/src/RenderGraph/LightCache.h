@@ -0,0 +1,96 @@
+#pragma once
+#include <GDX11.h>
+#include <entt/entt.hpp>
+#include "Utils/ShaderCBuf.h"
+#include "Scene/Components.h"
+
+namespace GA
+{
+	// Keeps the packed PhongPSSystemCBuf records and the shadow matrices of every light slot between frames.
+	// A slot is only rebuilt when its entity, TransformComponent or light component changed, and the cbuf
+	// is only uploaded when a byte of it changed since the last upload.
+	class LightCache
+	{
+	public:
+		struct Stats
+		{
+			uint32_t changedLights;
+			bool uploaded;
+			// byte range of the cbuf that changed since the previous upload
+			uint32_t dirtyOffset;
+			uint32_t dirtySize;
+		};
+
+		LightCache();
+
+		void Begin();
+
+		// return true if the light in that slot changed since it was last updated
+		bool UpdateDirLight(uint32_t index, entt::entity e, const TransformComponent& transform, const DirectionalLightComponent& light);
+		bool UpdatePointLight(uint32_t index, entt::entity e, const TransformComponent& transform, const PointLightComponent& light);
+		bool UpdateSpotLight(uint32_t index, entt::entity e, const TransformComponent& transform, const SpotLightComponent& light);
+
+		// shading has to use the light space the stored shadow map was rendered with, which can lag behind the light
+		void SetPointLightShadow(uint32_t index, const DirectX::XMFLOAT4X4& lightSpace, float nearZ, float farZ);
+		void SetSpotLightShadow(uint32_t index, const DirectX::XMFLOAT4X4& lightSpace);
+
+		void SetActiveLights(uint32_t dirLights, uint32_t pointLights, uint32_t spotLights);
+
+		// uploads the records if anything changed since the last upload
+		void Upload(const std::shared_ptr<GDX11::Buffer>& cbuf);
+
+		// forces every slot to rebuild and the next Upload to happen
+		void Invalidate();
+
+		// column major
+		const DirectX::XMFLOAT4X4& GetDirLightSpace(uint32_t index) const { return m_dirLights[index].lightSpace; }
+		const DirectX::XMFLOAT4X4& GetPointLightSpace(uint32_t index) const { return m_pointLights[index].lightSpace; }
+		const DirectX::XMFLOAT4X4* GetPointLightFaces(uint32_t index) const { return m_pointLights[index].faces; } // +x, -x, +y, -y, +z, -z
+		const DirectX::XMFLOAT4X4& GetSpotLightSpace(uint32_t index) const { return m_spotLights[index].lightSpace; }
+
+		const GA::Utils::PhongPSSystemCBuf& GetData() const { return m_data; }
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		template<typename T>
+		struct Entry
+		{
+			entt::entity light = entt::null;
+			TransformComponent transform;
+			T params;
+		};
+
+		struct DirLightEntry : Entry<DirectionalLightComponent>
+		{
+			DirectX::XMFLOAT4X4 lightSpace;
+		};
+
+		struct PointLightEntry : Entry<PointLightComponent>
+		{
+			DirectX::XMFLOAT4X4 lightSpace;
+			DirectX::XMFLOAT4X4 faces[6];
+		};
+
+		struct SpotLightEntry : Entry<SpotLightComponent>
+		{
+			DirectX::XMFLOAT4X4 lightSpace;
+		};
+
+		template<typename T>
+		static bool Refresh(Entry<T>& entry, entt::entity e, const TransformComponent& transform, const T& params);
+
+		// copies src into a member of m_data and widens the dirty range if the bytes differ
+		template<typename T>
+		void Store(T& dst, const T& src);
+
+		GA::Utils::PhongPSSystemCBuf m_data;
+		DirLightEntry m_dirLights[GA::Utils::s_maxLights];
+		PointLightEntry m_pointLights[GA::Utils::s_maxLights];
+		SpotLightEntry m_spotLights[GA::Utils::s_maxLights];
+
+		uint32_t m_dirtyBegin;
+		uint32_t m_dirtyEnd;
+
+		Stats m_stats;
+	};
+}
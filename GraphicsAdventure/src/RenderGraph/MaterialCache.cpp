@@ -0,0 +1,137 @@
+#include "MaterialCache.h"
+#include <cstring>
+
+using namespace GDX11;
+
+namespace GA
+{
+	bool MaterialCache::Key::operator==(const Key& rhs) const
+	{
+		return memcmp(this, &rhs, sizeof(Key)) == 0;
+	}
+
+	size_t MaterialCache::KeyHash::operator()(const Key& key) const
+	{
+		// fnv-1a
+		uint64_t hash = 0xcbf29ce484222325ull;
+		const uint8_t* bytes = (const uint8_t*)&key;
+		for (size_t i = 0; i < sizeof(Key); i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return (size_t)hash;
+	}
+
+	MaterialCache::MaterialCache(GDX11Context* context, GA::Utils::TexturePool* textures)
+		: m_context(context), m_textures(textures), m_entries(), m_free(), m_ids(), m_generation(0), m_stats()
+	{
+	}
+
+	uint32_t MaterialCache::Intern(const MaterialComponent& mat, MaterialSlices& slices)
+	{
+		slices = {};
+		auto diffuseMap = Pool(mat.diffuseMap, slices.diffuse);
+		auto normalMap = Pool(mat.normalMap, slices.normal);
+		auto depthMap = Pool(mat.depthMap, slices.depth);
+
+		// zeroed so padding never makes equal materials differ
+		Key key;
+		memset(&key, 0, sizeof(Key));
+		key.diffuseMap = diffuseMap.get();
+		key.normalMap = normalMap.get();
+		key.depthMap = depthMap.get();
+		key.samplerState = mat.samplerState.get();
+		key.params.color = mat.color;
+		key.params.tiling = mat.tiling;
+		key.params.shininess = mat.shininess;
+		key.params.enableNormalMapping = mat.normalMap ? TRUE : FALSE;
+		key.params.enableParallaxMapping = mat.normalMap && mat.depthMap ? TRUE : FALSE;
+		key.params.depthMapScale = mat.depthMapScale;
+
+		auto it = m_ids.find(key);
+		if (it != m_ids.end())
+		{
+			m_entries[it->second].generation = m_generation;
+			return it->second;
+		}
+
+		uint32_t id;
+		if (!m_free.empty())
+		{
+			id = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			id = (uint32_t)m_entries.size();
+			m_entries.emplace_back();
+		}
+
+		auto& entry = m_entries[id];
+		entry.key = key;
+		entry.generation = m_generation;
+		entry.live = true;
+		entry.material.diffuseMap = diffuseMap;
+		entry.material.normalMap = normalMap;
+		entry.material.depthMap = depthMap;
+		entry.material.samplerState = mat.samplerState;
+
+		if (entry.material.cbuf)
+		{
+			entry.material.cbuf->Update(&key.params);
+		}
+		else
+		{
+			D3D11_BUFFER_DESC desc = {};
+			desc.ByteWidth = sizeof(GA::Utils::Material);
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+			desc.StructureByteStride = 0;
+			entry.material.cbuf = Buffer::Create(m_context, desc, &key.params);
+		}
+
+		m_ids.emplace(key, id);
+		++m_stats.materials;
+		++m_stats.created;
+		return id;
+	}
+
+	void MaterialCache::Sweep()
+	{
+		m_stats.created = 0;
+		m_stats.released = 0;
+
+		for (uint32_t id = 0; id < (uint32_t)m_entries.size(); id++)
+		{
+			auto& entry = m_entries[id];
+			if (!entry.live || entry.generation == m_generation) continue;
+
+			m_ids.erase(entry.key);
+			m_free.push_back(id);
+			entry.live = false;
+
+			// the cbuf is reused, the arrays of a grown pool can go
+			entry.material.diffuseMap = nullptr;
+			entry.material.normalMap = nullptr;
+			entry.material.depthMap = nullptr;
+			entry.material.samplerState = nullptr;
+
+			--m_stats.materials;
+			++m_stats.released;
+		}
+
+		++m_generation;
+	}
+
+	std::shared_ptr<ShaderResourceView> MaterialCache::Pool(const std::shared_ptr<ShaderResourceView>& srv, uint16_t& slice)
+	{
+		if (!srv) return nullptr;
+
+		GA::Utils::TextureSlice pooled = m_textures->Add(srv);
+		slice = (uint16_t)pooled.slice;
+		return m_textures->GetSRV(pooled.array);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <GDX11.h>
+#include <unordered_map>
+#include <vector>
+#include "Scene/Components.h"
+#include "Utils/ShaderCBuf.h"
+#include "Utils/TexturePool.h"
+
+namespace GA
+{
+	// Per draw half of a material, the slices its textures occupy in the pooled arrays
+	struct MaterialSlices
+	{
+		uint16_t diffuse;
+		uint16_t normal;
+		uint16_t depth;
+	};
+
+	// Interns materials by their resources and parameters. Every unique material owns a default usage MaterialCBuf
+	// written once when it's interned, an edited MaterialComponent simply interns as another material.
+	// textures go through the TexturePool and materials are keyed by the arrays they land in, so materials that only
+	// differ by texture share an id and the slices are handed back per draw.
+	// ids are small and dense so they fit into draw keys
+	class MaterialCache
+	{
+	public:
+		// what a draw binds for the material
+		struct Material
+		{
+			std::shared_ptr<GDX11::ShaderResourceView> diffuseMap;
+			std::shared_ptr<GDX11::ShaderResourceView> normalMap;
+			std::shared_ptr<GDX11::ShaderResourceView> depthMap;
+			std::shared_ptr<GDX11::SamplerState> samplerState;
+			std::shared_ptr<GDX11::Buffer> cbuf;
+		};
+
+		struct Stats
+		{
+			uint32_t materials;
+			uint32_t created; // since the last Sweep()
+			uint32_t released;
+		};
+
+		MaterialCache(GDX11::GDX11Context* context, GA::Utils::TexturePool* textures);
+
+		uint32_t Intern(const MaterialComponent& mat, MaterialSlices& slices);
+		const Material& Get(uint32_t id) const { return m_entries[id].material; }
+
+		// releases the materials nothing interned since the previous sweep. their cbufs are reused
+		void Sweep();
+
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		// plain data, compared and hashed bytewise
+		struct Key
+		{
+			const void* diffuseMap;
+			const void* normalMap;
+			const void* depthMap;
+			const void* samplerState;
+			GA::Utils::Material params;
+
+			bool operator==(const Key& rhs) const;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		struct Entry
+		{
+			Key key;
+			Material material;
+			uint64_t generation;
+			bool live;
+		};
+
+		std::shared_ptr<GDX11::ShaderResourceView> Pool(const std::shared_ptr<GDX11::ShaderResourceView>& srv, uint16_t& slice);
+
+		GDX11::GDX11Context* m_context;
+		GA::Utils::TexturePool* m_textures;
+		std::vector<Entry> m_entries;
+		std::vector<uint32_t> m_free;
+		std::unordered_map<Key, uint32_t, KeyHash> m_ids;
+		uint64_t m_generation;
+		Stats m_stats;
+	};
+}
@@ -0,0 +1,125 @@
+#include "PostProcessChain.h"
+#include "RenderGraph/ShaderBindingIds.h"
+
+using namespace GDX11;
+using namespace DirectX;
+
+namespace GA
+{
+	PostProcessChain::PostProcessChain(GDX11Context* context, GA::Utils::SharedResourceCache* shared)
+		: m_context(context), m_shared(shared), m_variants()
+	{
+		{
+			D3D11_BUFFER_DESC desc = {};
+			desc.ByteWidth = sizeof(XMFLOAT4);
+			desc.Usage = D3D11_USAGE_DYNAMIC;
+			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			desc.MiscFlags = 0;
+			desc.StructureByteStride = 0;
+			m_cbuf = Buffer::Create(m_context, desc, nullptr);
+		}
+
+		{
+			// linear hits texel centers exactly at scale 1
+			D3D11_SAMPLER_DESC desc = CD3D11_SAMPLER_DESC(CD3D11_DEFAULT());
+			desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+			desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+			desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+			desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+			for (int i = 0; i < 4; i++)
+				desc.BorderColor[i] = 0.0f;
+			desc.MinLOD = 0.0f;
+			desc.MaxLOD = D3D11_FLOAT32_MAX;
+			m_sampler = m_shared->GetSamplerState(desc);
+		}
+
+		// fs quad, the same buffers the render graphs get
+		{
+			float vert[] =
+			{
+				-1.0f,  1.0f,
+				 1.0f,  1.0f,
+				 1.0f, -1.0f,
+				-1.0f, -1.0f
+			};
+
+			uint32_t ind[] =
+			{
+				0, 1, 2,
+				2, 3, 0
+			};
+
+			D3D11_BUFFER_DESC desc = {};
+			desc.ByteWidth = sizeof(vert);
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+			desc.StructureByteStride = 2 * sizeof(float);
+			m_vb = m_shared->GetStaticBuffer(desc, vert);
+
+			desc = {};
+			desc.ByteWidth = sizeof(ind);
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+			desc.StructureByteStride = sizeof(uint32_t);
+			m_ib = m_shared->GetStaticBuffer(desc, ind);
+		}
+	}
+
+	void PostProcessChain::Draw(uint32_t ops, const Inputs& inputs, const std::shared_ptr<RenderTargetView>& rtv, const D3D11_VIEWPORT& viewport,
+		const XMFLOAT2& uvScale, float gamma)
+	{
+		m_context->GetStateCache().SetViewport(viewport);
+
+		rtv->Bind(nullptr);
+
+		const auto& pso = GetPipelineState(ops);
+		pso->Bind();
+		const auto& ps = pso->GetDesc().ps;
+
+		inputs.scene->PSBind(ps->GetBindings().Get(Binding::tex));
+		m_sampler->PSBind(ps->GetBindings().Get(Binding::samplerState));
+
+		if (ops & Composite)
+		{
+			inputs.accumulation->PSBind(ps->GetBindings().Get(Binding::accumulationMap));
+			inputs.reveal->PSBind(ps->GetBindings().Get(Binding::revealMap));
+		}
+
+		XMFLOAT4 cbufData = { gamma, uvScale.x, uvScale.y, 0.0f };
+		m_cbuf->SetData(&cbufData);
+		m_cbuf->PSBindAsCBuf(ps->GetBindings().Get(Binding::SystemCBuf));
+
+		m_vb->BindAsVB();
+		m_ib->BindAsIB(DXGI_FORMAT_R32_UINT);
+		m_context->GetStateCache().SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		m_context->DrawIndexed(m_ib->GetDesc().ByteWidth / sizeof(uint32_t), 0, 0);
+	}
+
+	const std::shared_ptr<PipelineState>& PostProcessChain::GetPipelineState(uint32_t ops)
+	{
+		auto it = m_variants.find(ops);
+		if (it != m_variants.end())
+			return it->second;
+
+		// indexed by ops
+		static const char* s_pixelShaders[] =
+		{
+			"res/cso/post_process.ps.cso",
+			"res/cso/post_process_composite.ps.cso",
+			"res/cso/post_process_gamma.ps.cso",
+			"res/cso/post_process_composite_gamma.ps.cso"
+		};
+
+		// writes every pixel, no blending and no depth
+		PipelineStateDesc desc = {};
+		desc.vs = m_shared->GetVertexShader("res/cso/fullscreen_out_tc_pos.vs.cso");
+		desc.ps = m_shared->GetPixelShader(s_pixelShaders[ops & (Composite | Gamma)]);
+		desc.inputLayout = m_shared->GetInputLayout("res/cso/fullscreen_out_tc_pos.vs.cso");
+		return m_variants.emplace(ops, PipelineState::Create(m_context, desc)).first->second;
+	}
+}
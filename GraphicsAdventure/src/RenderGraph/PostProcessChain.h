@@ -0,0 +1,52 @@
+#pragma once
+#include <GDX11.h>
+#include <DirectXMath.h>
+#include <unordered_map>
+#include "Utils/SharedResourceCache.h"
+
+namespace GA
+{
+	// The per pixel work after the scene is drawn, done by one full screen draw. every set of ops has its own pixel shader,
+	// res/shaders/post_process.ps.hlsl compiled with the ops defined by one post_process_*.ps.hlsl file each.
+	// gamma is only needed when the output view isn't _SRGB, with an _SRGB view the hardware encodes on write
+	class PostProcessChain
+	{
+	public:
+		// applied in this order
+		enum Op : uint32_t
+		{
+			Composite = 1 << 0, // weighted blended oit accumulation and reveal over the scene
+			Gamma     = 1 << 1
+		};
+
+		struct Inputs
+		{
+			std::shared_ptr<GDX11::ShaderResourceView> scene;
+			std::shared_ptr<GDX11::ShaderResourceView> accumulation; // Composite only
+			std::shared_ptr<GDX11::ShaderResourceView> reveal;       // Composite only
+		};
+
+		PostProcessChain(GDX11::GDX11Context* context, GA::Utils::SharedResourceCache* shared);
+
+		PostProcessChain(const PostProcessChain&) = delete;
+		PostProcessChain& operator=(const PostProcessChain&) = delete;
+
+		// overwrites the viewport rectangle of rtv. uvScale maps output uvs to the rendered corner of the inputs, which are
+		// filtered bilinearly so a scene rendered smaller than the output is upscaled
+		void Draw(uint32_t ops, const Inputs& inputs, const std::shared_ptr<GDX11::RenderTargetView>& rtv, const D3D11_VIEWPORT& viewport,
+			const DirectX::XMFLOAT2& uvScale, float gamma);
+
+		uint32_t GetVariantCount() const { return (uint32_t)m_variants.size(); }
+
+	private:
+		const std::shared_ptr<GDX11::PipelineState>& GetPipelineState(uint32_t ops);
+
+		GDX11::GDX11Context* m_context;
+		GA::Utils::SharedResourceCache* m_shared;
+		std::unordered_map<uint32_t, std::shared_ptr<GDX11::PipelineState>> m_variants;
+		std::shared_ptr<GDX11::Buffer> m_cbuf;
+		std::shared_ptr<GDX11::SamplerState> m_sampler;
+		std::shared_ptr<GDX11::Buffer> m_vb;
+		std::shared_ptr<GDX11::Buffer> m_ib;
+	};
+}
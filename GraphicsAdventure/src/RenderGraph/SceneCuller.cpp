@@ -0,0 +1,157 @@
+#include "SceneCuller.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace GA
+{
+	void SceneCuller::Clear()
+	{
+		m_boxes.clear();
+		m_bounded.clear();
+		m_unbounded.clear();
+		m_cellsPerAxis = 0;
+		m_cellStart.clear();
+		m_cellEntries.clear();
+	}
+
+	uint32_t SceneCuller::Add(const BoundingBox* box)
+	{
+		uint32_t index = (uint32_t)m_boxes.size();
+		m_boxes.push_back(box ? *box : BoundingBox());
+		m_bounded.push_back(box != nullptr);
+		if (!box)
+			m_unbounded.push_back(index);
+		return index;
+	}
+
+	void SceneCuller::Build()
+	{
+		uint32_t count = (uint32_t)m_boxes.size();
+		uint32_t bounded = count - (uint32_t)m_unbounded.size();
+
+		m_stats = {};
+		m_stats.entries = count;
+		m_stamps.assign(count, m_stamp);
+
+		m_cellsPerAxis = 0;
+		m_cellStart.clear();
+		m_cellEntries.clear();
+		if (bounded == 0) return;
+
+		XMVECTOR xmMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR xmMax = XMVectorReplicate(-FLT_MAX);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!m_bounded[i]) continue;
+
+			XMVECTOR center = XMLoadFloat3(&m_boxes[i].Center);
+			XMVECTOR extents = XMLoadFloat3(&m_boxes[i].Extents);
+			xmMin = XMVectorMin(xmMin, center - extents);
+			xmMax = XMVectorMax(xmMax, center + extents);
+		}
+
+		m_cellsPerAxis = std::clamp((uint32_t)std::ceil(std::cbrt((float)bounded / s_entriesPerCell)), 1u, s_maxCellsPerAxis);
+		XMStoreFloat3(&m_gridMin, xmMin);
+		XMStoreFloat3(&m_cellSize, XMVectorMax((xmMax - xmMin) / (float)m_cellsPerAxis, XMVectorReplicate(1e-4f)));
+
+		uint32_t cells = m_cellsPerAxis * m_cellsPerAxis * m_cellsPerAxis;
+		m_stats.cells = cells;
+
+		// count per cell, prefix sum, then fill
+		m_cellStart.assign(cells + 1, 0);
+		auto forEachCell = [&](uint32_t i, auto&& f)
+		{
+			uint32_t lo[3], hi[3];
+			GetCellRange(m_boxes[i], lo, hi);
+			for (uint32_t z = lo[2]; z <= hi[2]; z++)
+				for (uint32_t y = lo[1]; y <= hi[1]; y++)
+					for (uint32_t x = lo[0]; x <= hi[0]; x++)
+						f((z * m_cellsPerAxis + y) * m_cellsPerAxis + x);
+		};
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (m_bounded[i])
+				forEachCell(i, [&](uint32_t cell) { ++m_cellStart[cell + 1]; });
+		}
+
+		for (uint32_t c = 0; c < cells; c++)
+			m_cellStart[c + 1] += m_cellStart[c];
+
+		m_cellEntries.resize(m_cellStart[cells]);
+		std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (m_bounded[i])
+				forEachCell(i, [&](uint32_t cell) { m_cellEntries[cursor[cell]++] = i; });
+		}
+	}
+
+	void SceneCuller::Cull(const BoundingFrustum& frustum, std::vector<uint32_t>& visible)
+	{
+		visible.clear();
+		m_stats.tested = 0;
+
+		if (++m_stamp == 0)
+		{
+			std::fill(m_stamps.begin(), m_stamps.end(), 0);
+			m_stamp = 1;
+		}
+
+		for (uint32_t z = 0; z < m_cellsPerAxis; z++)
+		{
+			for (uint32_t y = 0; y < m_cellsPerAxis; y++)
+			{
+				for (uint32_t x = 0; x < m_cellsPerAxis; x++)
+				{
+					uint32_t cell = (z * m_cellsPerAxis + y) * m_cellsPerAxis + x;
+					if (m_cellStart[cell] == m_cellStart[cell + 1]) continue;
+
+					BoundingBox cellBox;
+					cellBox.Extents = { m_cellSize.x * 0.5f, m_cellSize.y * 0.5f, m_cellSize.z * 0.5f };
+					cellBox.Center = { m_gridMin.x + (x + 0.5f) * m_cellSize.x, m_gridMin.y + (y + 0.5f) * m_cellSize.y, m_gridMin.z + (z + 0.5f) * m_cellSize.z };
+
+					ContainmentType containment = frustum.Contains(cellBox);
+					if (containment == DISJOINT) continue;
+
+					for (uint32_t j = m_cellStart[cell]; j < m_cellStart[cell + 1]; j++)
+					{
+						uint32_t i = m_cellEntries[j];
+						if (m_stamps[i] == m_stamp) continue;
+						m_stamps[i] = m_stamp;
+
+						if (containment == INTERSECTS)
+						{
+							++m_stats.tested;
+							if (!frustum.Intersects(m_boxes[i])) continue;
+						}
+
+						visible.push_back(i);
+					}
+				}
+			}
+		}
+
+		visible.insert(visible.end(), m_unbounded.begin(), m_unbounded.end());
+		std::sort(visible.begin(), visible.end());
+		m_stats.visible = (uint32_t)visible.size();
+	}
+
+	void SceneCuller::GetCellRange(const BoundingBox& box, uint32_t lo[3], uint32_t hi[3]) const
+	{
+		const float center[3] = { box.Center.x, box.Center.y, box.Center.z };
+		const float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+		const float gridMin[3] = { m_gridMin.x, m_gridMin.y, m_gridMin.z };
+		const float cellSize[3] = { m_cellSize.x, m_cellSize.y, m_cellSize.z };
+
+		for (int a = 0; a < 3; a++)
+		{
+			auto toCell = [&](float v) { return (uint32_t)std::clamp((int)std::floor((v - gridMin[a]) / cellSize[a]), 0, (int)m_cellsPerAxis - 1); };
+			lo[a] = toCell(center[a] - extents[a]);
+			hi[a] = toCell(center[a] + extents[a]);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <DirectXCollision.h>
+
+namespace GA
+{
+	// World bounds of a frame's renderables, built once and culled against by every view of the frame.
+	// bounded entries are bucketed in a uniform grid over their combined bounds. a frustum takes the cells it contains
+	// whole, tests the entries of the cells it cuts and skips the rest. entries without bounds are seen by every view
+	class SceneCuller
+	{
+	public:
+		struct Stats
+		{
+			uint32_t entries;
+			uint32_t cells;
+			uint32_t tested;  // entry tests of the last Cull
+			uint32_t visible; // of the last Cull
+		};
+
+		void Clear();
+		// index of the entry, null box if the extent isn't known
+		uint32_t Add(const DirectX::BoundingBox* box);
+		// after the last Add of the frame
+		void Build();
+
+		// ascending indices of the entries the frustum may see
+		void Cull(const DirectX::BoundingFrustum& frustum, std::vector<uint32_t>& visible);
+
+		uint32_t GetCount() const { return (uint32_t)m_boxes.size(); }
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		static constexpr uint32_t s_entriesPerCell = 8;
+		static constexpr uint32_t s_maxCellsPerAxis = 16;
+
+		void GetCellRange(const DirectX::BoundingBox& box, uint32_t lo[3], uint32_t hi[3]) const;
+
+		std::vector<DirectX::BoundingBox> m_boxes;
+		std::vector<bool> m_bounded;
+		std::vector<uint32_t> m_unbounded;
+
+		DirectX::XMFLOAT3 m_gridMin = {};
+		DirectX::XMFLOAT3 m_cellSize = {};
+		uint32_t m_cellsPerAxis = 0;
+		std::vector<uint32_t> m_cellStart; // entries of cell c are m_cellEntries[m_cellStart[c]..m_cellStart[c + 1]]
+		std::vector<uint32_t> m_cellEntries;
+
+		// an entry spanning several cells is only taken once per Cull
+		std::vector<uint32_t> m_stamps;
+		uint32_t m_stamp = 0;
+
+		Stats m_stats = {};
+	};
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <GDX11.h>
+
+namespace GA::Binding
+{
+	// shader resource names hashed at compile time, look slots up with shader->GetBindings().Get(Binding::name)
+	constexpr uint32_t EntityCBuf = GDX11::BindingId("EntityCBuf");
+	constexpr uint32_t InstanceCBuf = GDX11::BindingId("InstanceCBuf");
+	constexpr uint32_t MaterialCBuf = GDX11::BindingId("MaterialCBuf");
+	constexpr uint32_t SystemCBuf = GDX11::BindingId("SystemCBuf");
+	constexpr uint32_t accumulationMap = GDX11::BindingId("accumulationMap");
+	constexpr uint32_t casterInstances = GDX11::BindingId("casterInstances");
+	constexpr uint32_t depthMap = GDX11::BindingId("depthMap");
+	constexpr uint32_t diffuseMap = GDX11::BindingId("diffuseMap");
+	constexpr uint32_t dirLightShadowMaps = GDX11::BindingId("dirLightShadowMaps");
+	constexpr uint32_t dirLightShadowMapsSampler = GDX11::BindingId("dirLightShadowMapsSampler");
+	constexpr uint32_t entityInstances = GDX11::BindingId("entityInstances");
+	constexpr uint32_t normalMap = GDX11::BindingId("normalMap");
+	constexpr uint32_t pointLightShadowMaps = GDX11::BindingId("pointLightShadowMaps");
+	constexpr uint32_t pointLightShadowMapsSampler = GDX11::BindingId("pointLightShadowMapsSampler");
+	constexpr uint32_t prepassInstances = GDX11::BindingId("prepassInstances");
+	constexpr uint32_t revealMap = GDX11::BindingId("revealMap");
+	constexpr uint32_t sam = GDX11::BindingId("sam");
+	constexpr uint32_t samplerState = GDX11::BindingId("samplerState");
+	constexpr uint32_t spotLightShadowMaps = GDX11::BindingId("spotLightShadowMaps");
+	constexpr uint32_t spotLightShadowMapsSampler = GDX11::BindingId("spotLightShadowMapsSampler");
+	constexpr uint32_t tex = GDX11::BindingId("tex");
+}
@@ -0,0 +1,100 @@
+#include "ShadowScheduler.h"
+#include <algorithm>
+#include <cfloat>
+#include "Utils/Macros.h"
+
+using namespace DirectX;
+
+namespace GA
+{
+	ShadowScheduler::ShadowScheduler(uint32_t numSlots, uint64_t triangleBudget, float ageWeight)
+		: m_slots(numSlots), m_triangleBudget(triangleBudget), m_ageWeight(ageWeight), m_stats()
+	{
+		m_candidates.reserve(numSlots);
+	}
+
+	void ShadowScheduler::Begin(const std::vector<DirectX::XMFLOAT3>& viewPositions)
+	{
+		m_viewPositions = viewPositions;
+		m_candidates.clear();
+		m_stats = {};
+
+		for (auto& slot : m_slots)
+		{
+			slot.submitted = false;
+			slot.scheduled = false;
+		}
+	}
+
+	void ShadowScheduler::Submit(uint32_t slot, entt::entity light, const DirectX::XMFLOAT3& position, float range, float intensity, uint64_t triangleCost, bool dirty)
+	{
+		auto& s = m_slots[slot];
+		s.submitted = true;
+		++m_stats.submitted;
+
+		if (s.light != light)
+		{
+			s.light = light;
+			s.valid = false;
+		}
+
+		s.stale |= dirty || !s.valid;
+		if (!s.stale) return;
+
+		// rough screen contribution. a light whose range covers a camera counts as fully visible
+		float dist = FLT_MAX;
+		for (const auto& viewPos : m_viewPositions)
+			dist = std::min(dist, XMVectorGetX(XMVector3Length(XMLoadFloat3(&position) - XMLoadFloat3(&viewPos))));
+		float coverage = std::min(range / std::max(dist, GA_UTILS_EPSILONF), 1.0f);
+		float priority = intensity * coverage * coverage * (1.0f + m_ageWeight * s.age);
+
+		// maps that hold nothing usable go first
+		if (!s.valid)
+			priority += 1e6f;
+
+		m_candidates.push_back({ slot, priority, triangleCost });
+	}
+
+	void ShadowScheduler::Schedule()
+	{
+		// lights that went away leave their slot without a usable map
+		for (auto& slot : m_slots)
+		{
+			if (slot.submitted) continue;
+			slot.light = entt::null;
+			slot.valid = false;
+			slot.stale = false;
+			slot.age = 0;
+		}
+
+		std::sort(m_candidates.begin(), m_candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+		m_stats.stale = (uint32_t)m_candidates.size();
+
+		for (const auto& c : m_candidates)
+		{
+			auto& s = m_slots[c.slot];
+
+			// always let the top candidate through, otherwise a single heavy light could starve forever
+			if (m_stats.updated > 0 && m_stats.triangles + c.cost > m_triangleBudget)
+			{
+				++s.age;
+				++m_stats.deferred;
+				continue;
+			}
+
+			s.scheduled = true;
+			s.valid = true;
+			s.stale = false;
+			s.age = 0;
+
+			m_stats.triangles += c.cost;
+			++m_stats.updated;
+		}
+	}
+
+	void ShadowScheduler::InvalidateAll()
+	{
+		for (auto& slot : m_slots)
+			slot.valid = false;
+	}
+}
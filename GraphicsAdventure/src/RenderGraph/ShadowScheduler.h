@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include <entt/entt.hpp>
+
+namespace GA
+{
+	// Decides which point/spot light shadow maps get re-rendered this frame.
+	// Only lights whose map is stale (light moved, caster moved near it, slot reassigned) are candidates.
+	// Candidates are ordered by estimated screen contribution to the nearest view and how many frames they have been waiting,
+	// then accepted until the triangle budget is spent. Everything else keeps last frame's map.
+	class ShadowScheduler
+	{
+	public:
+		struct Stats
+		{
+			uint32_t submitted;
+			uint32_t stale;
+			uint32_t updated;
+			uint32_t deferred;
+			uint64_t triangles;
+		};
+
+		ShadowScheduler(uint32_t numSlots, uint64_t triangleBudget, float ageWeight = 0.5f);
+
+		void SetTriangleBudget(uint64_t budget) { m_triangleBudget = budget; }
+		uint64_t GetTriangleBudget() const { return m_triangleBudget; }
+
+		// positions of every view drawn this frame
+		void Begin(const std::vector<DirectX::XMFLOAT3>& viewPositions);
+
+		// slot: shadow map the light renders into
+		// triangleCost: estimated triangles rasterized when the map is re-rendered
+		void Submit(uint32_t slot, entt::entity light, const DirectX::XMFLOAT3& position, float range, float intensity, uint64_t triangleCost, bool dirty);
+
+		void Schedule();
+
+		bool IsScheduled(uint32_t slot) const { return m_slots[slot].scheduled; }
+
+		// forces the slot to re-render next time it is submitted
+		void Invalidate(uint32_t slot) { m_slots[slot].valid = false; }
+		void InvalidateAll();
+
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		struct Slot
+		{
+			entt::entity light = entt::null;
+			uint32_t age = 0; // frames spent waiting while stale
+			bool valid = false;
+			bool stale = false;
+			bool submitted = false;
+			bool scheduled = false;
+		};
+
+		struct Candidate
+		{
+			uint32_t slot;
+			float priority;
+			uint64_t cost;
+		};
+
+		std::vector<Slot> m_slots;
+		std::vector<Candidate> m_candidates;
+
+		std::vector<DirectX::XMFLOAT3> m_viewPositions;
+		uint64_t m_triangleBudget;
+		float m_ageWeight;
+
+		Stats m_stats;
+	};
+}
@@ -89,6 +89,13 @@ namespace GA
 		return XMQuaternionRotationRollPitchYaw(XMConvertToRadians(m_desc.rotation.x), XMConvertToRadians(m_desc.rotation.y), XMConvertToRadians(m_desc.rotation.z));
 	}
 
+	DirectX::BoundingFrustum Camera::GetFrustum() const
+	{
+		BoundingFrustum frustum(GetProjectionMatrix());
+		frustum.Transform(frustum, XMMatrixInverse(nullptr, GetViewMatrix()));
+		return frustum;
+	}
+
 	void Camera::UpdateViewMatrix()
 	{
 		XMMATRIX viewXM = XMMatrixRotationQuaternion(GetOrientation()) * XMMatrixTranslation(m_desc.position.x, m_desc.position.y, m_desc.position.z);
@@ -1,5 +1,6 @@
 #pragma once
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 
 namespace GA
 {
@@ -38,6 +39,8 @@ namespace GA
 		DirectX::XMVECTOR GetRightDirection() const;
 		DirectX::XMVECTOR GetForwardDirection() const;
 		DirectX::XMVECTOR GetOrientation() const;
+		// world space
+		DirectX::BoundingFrustum GetFrustum() const;
 
 	protected:
 		void UpdateViewMatrix();
@@ -0,0 +1,74 @@
+#pragma once
+#include <entt/entt.hpp>
+#include <unordered_map>
+#include <type_traits>
+#include <cstring>
+
+namespace GA
+{
+	// Remembers the last seen value of a component per entity so systems can detect modifications.
+	// Components are mutated in place all over the app (imgui, controllers), so entt's on_update
+	// signal can't be relied on and values are compared bytewise instead.
+	template<typename T>
+	class ComponentTracker
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "ComponentTracker compares components bytewise");
+
+	public:
+		// returns true if the entity is new or its value differs from the previous call.
+		// previous receives the old value when the entity was already tracked
+		bool Update(entt::entity e, const T& value, T* previous = nullptr, bool* existed = nullptr)
+		{
+			auto it = m_entries.find(e);
+			if (existed) *existed = it != m_entries.end();
+
+			if (it == m_entries.end())
+			{
+				m_entries.emplace(e, Entry{ value, m_generation });
+				return true;
+			}
+
+			it->second.generation = m_generation;
+			if (memcmp(&it->second.value, &value, sizeof(T)) == 0)
+				return false;
+
+			if (previous) *previous = it->second.value;
+			it->second.value = value;
+			return true;
+		}
+
+		// drops entities that were not updated since the last sweep. fn(entity, lastValue) is called for each one
+		template<typename Fn>
+		void Sweep(Fn&& fn)
+		{
+			for (auto it = m_entries.begin(); it != m_entries.end();)
+			{
+				if (it->second.generation != m_generation)
+				{
+					fn(it->first, it->second.value);
+					it = m_entries.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			++m_generation;
+		}
+
+		void Sweep() { Sweep([](entt::entity, const T&) {}); }
+
+		void Clear() { m_entries.clear(); }
+
+	private:
+		struct Entry
+		{
+			T value;
+			uint64_t generation;
+		};
+
+		std::unordered_map<entt::entity, Entry> m_entries;
+		uint64_t m_generation = 0;
+	};
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <GDX11.h>
+#include <DirectXCollision.h>
+#include "Utils/GeometryPool.h"
 
 namespace GA
 {
@@ -57,6 +59,43 @@ namespace GA
 
 		bool castShadows;
 		bool receiveShadows;
+
+		// sub range of the buffers. indexCount 0 draws the whole index buffer
+		uint32_t indexCount = 0;
+		uint32_t startIndex = 0;
+		int32_t baseVertex = 0;
+
+		// set for meshes living in a GeometryPool, the pool moves the range when it compacts
+		std::shared_ptr<GA::Utils::GeometryAllocation> geometry;
+
+		uint32_t GetIndexCount() const
+		{
+			if (geometry) return geometry->indexCount;
+			return indexCount ? indexCount : ib->GetDesc().ByteWidth / sizeof(uint32_t);
+		}
+
+		uint32_t GetStartIndex() const { return geometry ? geometry->startIndex : startIndex; }
+		int32_t GetBaseVertex() const { return geometry ? (int32_t)geometry->baseVertex : baseVertex; }
+	};
+
+	// world space bounds. entities that have it are frustum culled
+	struct BoundsComponent
+	{
+		DirectX::BoundingBox box;
+	};
+
+	// the entity never moves. shadow passes keep it in cached static-only shadow maps
+	struct StaticTag
+	{
+	};
+
+	// kept in sync with MaterialComponent by the scene, exactly one of them is on every entity with a material
+	struct OpaqueTag
+	{
+	};
+
+	struct TransparentTag
+	{
 	};
 
 	struct MaterialComponent
@@ -11,12 +11,12 @@ namespace GA
 		Entity(entt::entity handle, Scene* scene)
 			: m_handle(handle), m_scene(scene) { }
 
+		// returns void for empty (tag) components
 		template<typename T, typename... Args>
-		T& AddComponent(Args&&... args)
+		decltype(auto) AddComponent(Args&&... args)
 		{
 			GDX11_ASSERT(!HasComponent<T>(), "Component already exist!");
-			T& component = m_scene->m_registry.emplace<T>(m_handle, std::forward<Args>(args)...);
-			return component;
+			return m_scene->m_registry.emplace<T>(m_handle, std::forward<Args>(args)...);
 		}
 
 		template<typename T>
@@ -26,6 +26,14 @@ namespace GA
 			return m_scene->m_registry.get<T>(m_handle);
 		}
 
+		// edits the component in place through func(T&) and emits its update signal, use it for changes the scene reacts to
+		template<typename T, typename... Func>
+		T& PatchComponent(Func&&... func)
+		{
+			GDX11_ASSERT(HasComponent<T>(), "Component does not exist!");
+			return m_scene->m_registry.patch<T>(m_handle, std::forward<Func>(func)...);
+		}
+
 		template<typename T>
 		bool HasComponent()
 		{
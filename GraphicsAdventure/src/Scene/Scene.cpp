@@ -1,8 +1,17 @@
 #include "Scene.h"
 #include "Entity.h"
+#include "Components.h"
+#include "Utils/Macros.h"
 
 namespace GA
 {
+	Scene::Scene()
+	{
+		m_registry.on_construct<MaterialComponent>().connect<&Scene::OnMaterialChanged>();
+		m_registry.on_update<MaterialComponent>().connect<&Scene::OnMaterialChanged>();
+		m_registry.on_destroy<MaterialComponent>().connect<&Scene::OnMaterialDestroyed>();
+	}
+
 	Entity Scene::CreateEntity()
 	{
 		return Entity(m_registry.create(), this);
@@ -17,4 +26,23 @@ namespace GA
 	{
 		return m_registry.valid(entity);
 	}
+
+	void Scene::OnMaterialChanged(entt::registry& registry, entt::entity e)
+	{
+		if (registry.get<MaterialComponent>(e).color.w < (1.0f - GA_UTILS_EPSILONF))
+		{
+			registry.remove<OpaqueTag>(e);
+			registry.emplace_or_replace<TransparentTag>(e);
+		}
+		else
+		{
+			registry.remove<TransparentTag>(e);
+			registry.emplace_or_replace<OpaqueTag>(e);
+		}
+	}
+
+	void Scene::OnMaterialDestroyed(entt::registry& registry, entt::entity e)
+	{
+		registry.remove<OpaqueTag, TransparentTag>(e);
+	}
 }
\ No newline at end of file
@@ -11,7 +11,7 @@ namespace GA
 		friend class System;
 
 	public:
-		Scene() = default;
+		Scene();
 		virtual ~Scene() = default;
 
 		Scene(const Scene&) = delete;
@@ -22,6 +22,10 @@ namespace GA
 		bool EntityExists(Entity entity);
 
 	private:
+		// tags the entity opaque or transparent by its material alpha
+		static void OnMaterialChanged(entt::registry& registry, entt::entity e);
+		static void OnMaterialDestroyed(entt::registry& registry, entt::entity e);
+
 		entt::registry m_registry;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,401 @@
+#include "StaticBatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include "Core/Time.h"
+
+using namespace DirectX;
+using namespace GDX11;
+
+namespace GA
+{
+	namespace
+	{
+		struct BakeHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint64_t sceneHash;
+			uint32_t numBuffers;
+			uint32_t numChunks;
+		};
+
+		void HashBytes(uint64_t& hash, const void* data, size_t size)
+		{
+			// fnv-1a
+			const uint8_t* bytes = (const uint8_t*)data;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ull;
+			}
+		}
+
+		bool SameGroup(const MeshComponent& meshA, const MaterialComponent& matA, const MeshComponent& meshB, const MaterialComponent& matB)
+		{
+			return
+				meshA.castShadows == meshB.castShadows && meshA.receiveShadows == meshB.receiveShadows &&
+				matA.diffuseMap == matB.diffuseMap && matA.normalMap == matB.normalMap &&
+				matA.depthMap == matB.depthMap && matA.samplerState == matB.samplerState &&
+				memcmp(&matA.color, &matB.color, sizeof(XMFLOAT4)) == 0 &&
+				memcmp(&matA.tiling, &matB.tiling, sizeof(XMFLOAT2)) == 0 &&
+				matA.shininess == matB.shininess && matA.depthMapScale == matB.depthMapScale;
+		}
+	}
+
+	StaticBatcher::StaticBatcher(Scene* scene, GDX11Context* context, GA::Utils::GeometryPool* pool, float cellSize)
+		: System(scene), m_context(context), m_pool(pool), m_cellSize(cellSize), m_stats()
+	{
+	}
+
+	void StaticBatcher::Build(const std::string& bakeFile)
+	{
+		Timer timer;
+		m_stats = {};
+
+		uint64_t sceneHash;
+		Readbacks readbacks;
+		auto sources = CollectSources(sceneHash, readbacks);
+		if (sources.empty()) return;
+
+		std::vector<Geometry> geometry;
+		std::vector<Chunk> chunks;
+		m_stats.fromBake = !bakeFile.empty() && Load(bakeFile, sceneHash, (uint32_t)sources.size(), geometry, chunks);
+		if (!m_stats.fromBake)
+		{
+			Merge(sources, readbacks, geometry, chunks);
+			if (!bakeFile.empty())
+				Save(bakeFile, sceneHash, geometry, chunks);
+		}
+
+		Apply(sources, geometry, chunks);
+
+		m_stats.sourceMeshes = (uint32_t)sources.size();
+		m_stats.chunks = (uint32_t)chunks.size();
+		m_stats.buffers = (uint32_t)geometry.size();
+		for (const auto& g : geometry)
+		{
+			m_stats.vertices += (uint32_t)g.vertices.size();
+			m_stats.indices += (uint32_t)g.indices.size();
+		}
+		m_stats.ms = timer.Peek() * 1000.0f;
+	}
+
+	const std::vector<uint8_t>& StaticBatcher::Readback(Readbacks& readbacks, const std::shared_ptr<Buffer>& buffer)
+	{
+		auto [it, inserted] = readbacks.try_emplace(buffer.get());
+		if (inserted)
+		{
+			it->second.resize(buffer->GetDesc().ByteWidth);
+			buffer->GetData(it->second.data());
+		}
+		return it->second;
+	}
+
+	std::vector<StaticBatcher::Source> StaticBatcher::CollectSources(uint64_t& sceneHash, Readbacks& readbacks)
+	{
+		auto& registry = GetRegistry();
+
+		std::vector<Source> sources;
+		std::vector<entt::entity> groups; // first source of every group
+		std::map<std::pair<const Buffer*, const Buffer*>, uint32_t> meshIds;
+		std::map<std::tuple<const Buffer*, const Buffer*, uint32_t, uint32_t, int32_t>, uint64_t> contentHashes;
+
+		sceneHash = 0xcbf29ce484222325ull;
+		HashBytes(sceneHash, &m_cellSize, sizeof(float));
+
+		auto view = registry.view<StaticTag, TransformComponent, MeshComponent, MaterialComponent>();
+		for (auto e : view)
+		{
+			const auto& [transform, mesh, mat] = view.get<TransformComponent, MeshComponent, MaterialComponent>(e);
+
+			// only the vertex layout every lit pass reads can be pre-transformed
+			if (mesh.topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ||
+				mesh.vb->GetDesc().StructureByteStride != sizeof(GA::Utils::Vertex))
+				continue;
+
+			uint32_t group = 0;
+			while (group < groups.size() &&
+				!SameGroup(mesh, mat, registry.get<MeshComponent>(groups[group]), registry.get<MaterialComponent>(groups[group])))
+				++group;
+			if (group == groups.size())
+				groups.push_back(e);
+
+			sources.push_back({ e, group });
+
+			// buffers can't be compared across runs, the order they first show up in can
+			auto [it, inserted] = meshIds.try_emplace({ mesh.vb.get(), mesh.ib.get() }, (uint32_t)meshIds.size());
+			uint32_t indexCount = mesh.GetIndexCount();
+			uint32_t sizes[] = { it->second, mesh.vb->GetDesc().ByteWidth, indexCount, mesh.GetStartIndex(), (uint32_t)mesh.GetBaseVertex() };
+
+			// an edited mesh that keeps its counts still has to miss the bake. the indexed range and the vertices it
+			// spans are hashed once per mesh, a pooled mesh shares its buffers with others
+			auto [hashIt, newMesh] = contentHashes.try_emplace({ mesh.vb.get(), mesh.ib.get(), mesh.GetStartIndex(), indexCount, mesh.GetBaseVertex() });
+			if (newMesh)
+			{
+				const auto& vbData = Readback(readbacks, mesh.vb);
+				const auto* indices = (const uint32_t*)Readback(readbacks, mesh.ib).data() + mesh.GetStartIndex();
+
+				uint32_t minIndex = UINT32_MAX;
+				uint32_t maxIndex = 0;
+				for (uint32_t j = 0; j < indexCount; j++)
+				{
+					minIndex = std::min(minIndex, indices[j]);
+					maxIndex = std::max(maxIndex, indices[j]);
+				}
+
+				uint64_t contentHash = 0xcbf29ce484222325ull;
+				HashBytes(contentHash, indices, indexCount * sizeof(uint32_t));
+				if (indexCount > 0)
+				{
+					const auto* vertices = (const GA::Utils::Vertex*)vbData.data() + mesh.GetBaseVertex();
+					HashBytes(contentHash, vertices + minIndex, (maxIndex - minIndex + 1) * sizeof(GA::Utils::Vertex));
+				}
+				hashIt->second = contentHash;
+			}
+
+			HashBytes(sceneHash, &group, sizeof(group));
+			HashBytes(sceneHash, sizes, sizeof(sizes));
+			HashBytes(sceneHash, &hashIt->second, sizeof(uint64_t));
+			HashBytes(sceneHash, &transform, sizeof(TransformComponent));
+			HashBytes(sceneHash, &mat.color, sizeof(XMFLOAT4));
+			HashBytes(sceneHash, &mat.tiling, sizeof(XMFLOAT2));
+			HashBytes(sceneHash, &mat.shininess, sizeof(float));
+			HashBytes(sceneHash, &mat.depthMapScale, sizeof(float));
+		}
+
+		return sources;
+	}
+
+	void StaticBatcher::Merge(const std::vector<Source>& sources, Readbacks& readbacks, std::vector<Geometry>& geometry, std::vector<Chunk>& chunks)
+	{
+		auto& registry = GetRegistry();
+
+		// sources bucketed by group then grid cell, an ordered map keeps the output the same from run to run
+		std::map<std::tuple<uint32_t, int32_t, int32_t, int32_t>, std::vector<uint32_t>> cells;
+		for (uint32_t i = 0; i < (uint32_t)sources.size(); i++)
+		{
+			XMFLOAT3 position = registry.get<TransformComponent>(sources[i].entity).position;
+			cells[{ sources[i].group,
+				(int32_t)floorf(position.x / m_cellSize),
+				(int32_t)floorf(position.y / m_cellSize),
+				(int32_t)floorf(position.z / m_cellSize) }].push_back(i);
+		}
+
+		uint32_t prevGroup = UINT32_MAX;
+		std::unordered_map<uint32_t, uint32_t> remap;
+		for (const auto& [cell, members] : cells)
+		{
+			Chunk chunk = {};
+
+			// a new group starts new buffers, so does a full one
+			uint32_t group = std::get<0>(cell);
+			if (group != prevGroup || geometry.back().vertices.size() >= s_maxBufferVertices)
+				geometry.emplace_back();
+			prevGroup = group;
+
+			auto& g = geometry.back();
+			chunk.buffer = (uint32_t)geometry.size() - 1;
+			chunk.startIndex = (uint32_t)g.indices.size();
+			chunk.source = members.front();
+			chunk.baseVertex = (uint32_t)g.vertices.size();
+
+			for (uint32_t i : members)
+			{
+				const auto& [transform, mesh] = registry.get<TransformComponent, MeshComponent>(sources[i].entity);
+
+				XMMATRIX xmTransform = transform.GetTransform();
+				// what the vertex shader does with the normal matrix, see csm_test.vs
+				XMMATRIX xmNormalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, xmTransform));
+
+				const auto* vertices = (const GA::Utils::Vertex*)Readback(readbacks, mesh.vb).data();
+				const auto* indices = (const uint32_t*)Readback(readbacks, mesh.ib).data() + mesh.GetStartIndex();
+				uint32_t indexCount = mesh.GetIndexCount();
+
+				// only the vertices the index range references are copied
+				remap.clear();
+				for (uint32_t j = 0; j < indexCount; j++)
+				{
+					uint32_t index = indices[j] + mesh.GetBaseVertex();
+					auto [it, inserted] = remap.try_emplace(index, (uint32_t)g.vertices.size() - chunk.baseVertex);
+					if (inserted)
+					{
+						GA::Utils::Vertex v = vertices[index];
+						XMStoreFloat3(&v.position, XMVector3TransformCoord(XMLoadFloat3(&v.position), xmTransform));
+						XMStoreFloat3(&v.tangent, XMVector3TransformNormal(XMLoadFloat3(&v.tangent), xmNormalMatrix));
+						XMStoreFloat3(&v.bitangent, XMVector3TransformNormal(XMLoadFloat3(&v.bitangent), xmNormalMatrix));
+						XMStoreFloat3(&v.normal, XMVector3TransformNormal(XMLoadFloat3(&v.normal), xmNormalMatrix));
+						g.vertices.push_back(v);
+					}
+					g.indices.push_back(it->second);
+				}
+			}
+
+			chunk.vertexCount = (uint32_t)g.vertices.size() - chunk.baseVertex;
+			chunk.indexCount = (uint32_t)g.indices.size() - chunk.startIndex;
+			BoundingBox::CreateFromPoints(chunk.box, chunk.vertexCount, &g.vertices[chunk.baseVertex].position, sizeof(GA::Utils::Vertex));
+			chunks.push_back(chunk);
+		}
+	}
+
+	void StaticBatcher::Apply(const std::vector<Source>& sources, const std::vector<Geometry>& geometry, const std::vector<Chunk>& chunks)
+	{
+		auto& registry = GetRegistry();
+
+		std::vector<std::pair<std::shared_ptr<Buffer>, std::shared_ptr<Buffer>>> buffers;
+		for (size_t i = 0; i < geometry.size() && !m_pool; i++)
+		{
+			const auto& g = geometry[i];
+
+			D3D11_BUFFER_DESC desc = {};
+			desc.ByteWidth = (uint32_t)g.vertices.size() * sizeof(GA::Utils::Vertex);
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+			desc.StructureByteStride = sizeof(GA::Utils::Vertex);
+			auto vb = Buffer::Create(m_context, desc, g.vertices.data());
+
+			desc = {};
+			desc.ByteWidth = (uint32_t)g.indices.size() * sizeof(uint32_t);
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+			desc.StructureByteStride = sizeof(uint32_t);
+			auto ib = Buffer::Create(m_context, desc, g.indices.data());
+
+			buffers.emplace_back(vb, ib);
+		}
+
+		// copies first, the source components go away below
+		for (const auto& chunk : chunks)
+		{
+			const auto& [srcMesh, srcMat] = registry.get<MeshComponent, MaterialComponent>(sources[chunk.source].entity);
+
+			MeshComponent mesh = {};
+			mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			mesh.castShadows = srcMesh.castShadows;
+			mesh.receiveShadows = srcMesh.receiveShadows;
+			if (m_pool)
+			{
+				const auto& g = geometry[chunk.buffer];
+				mesh.geometry = m_pool->Allocate(&g.vertices[chunk.baseVertex], chunk.vertexCount, &g.indices[chunk.startIndex], chunk.indexCount);
+				mesh.vb = m_pool->GetVB(mesh.geometry->arena);
+				mesh.ib = m_pool->GetIB(mesh.geometry->arena);
+			}
+			else
+			{
+				mesh.vb = buffers[chunk.buffer].first;
+				mesh.ib = buffers[chunk.buffer].second;
+				mesh.indexCount = chunk.indexCount;
+				mesh.startIndex = chunk.startIndex;
+				mesh.baseVertex = (int32_t)chunk.baseVertex;
+			}
+			MaterialComponent mat = srcMat;
+
+			auto e = registry.create();
+			registry.emplace<TransformComponent>(e);
+			registry.emplace<StaticTag>(e);
+			registry.emplace<BoundsComponent>(e, chunk.box);
+			registry.emplace<MeshComponent>(e, mesh);
+			registry.emplace<MaterialComponent>(e, mat);
+		}
+
+		// the sources keep their transform and material, without a mesh nothing draws them anymore
+		for (const auto& source : sources)
+			registry.remove<MeshComponent>(source.entity);
+	}
+
+	bool StaticBatcher::Load(const std::string& file, uint64_t sceneHash, uint32_t sourceCount, std::vector<Geometry>& geometry, std::vector<Chunk>& chunks) const
+	{
+		std::ifstream in(file, std::ios::binary | std::ios::ate);
+		if (!in) return false;
+
+		// counts read from the file are checked against what's left of it before anything is allocated
+		uint64_t remaining = (uint64_t)in.tellg();
+		in.seekg(0);
+
+		auto reject = [&]()
+		{
+			geometry.clear();
+			chunks.clear();
+			return false;
+		};
+
+		BakeHeader header = {};
+		in.read((char*)&header, sizeof(header));
+		if (!in || memcmp(header.magic, "GASB", 4) != 0 || header.version != s_bakeVersion || header.sceneHash != sceneHash)
+			return false;
+		remaining -= sizeof(header);
+
+		if ((uint64_t)header.numBuffers * 2 * sizeof(uint32_t) + (uint64_t)header.numChunks * sizeof(Chunk) > remaining)
+			return reject();
+
+		geometry.resize(header.numBuffers);
+		for (auto& g : geometry)
+		{
+			uint32_t counts[2] = {};
+			in.read((char*)counts, sizeof(counts));
+			if (!in) return reject();
+			remaining -= sizeof(counts);
+
+			uint64_t bytes = (uint64_t)counts[0] * sizeof(GA::Utils::Vertex) + (uint64_t)counts[1] * sizeof(uint32_t);
+			if (bytes > remaining) return reject();
+			remaining -= bytes;
+
+			g.vertices.resize(counts[0]);
+			g.indices.resize(counts[1]);
+			in.read((char*)g.vertices.data(), g.vertices.size() * sizeof(GA::Utils::Vertex));
+			in.read((char*)g.indices.data(), g.indices.size() * sizeof(uint32_t));
+		}
+
+		chunks.resize(header.numChunks);
+		in.read((char*)chunks.data(), chunks.size() * sizeof(Chunk));
+		if (!in) return reject();
+
+		// Apply indexes the sources and the geometry with these as they are
+		for (const auto& chunk : chunks)
+		{
+			if (chunk.buffer >= geometry.size() || chunk.source >= sourceCount)
+				return reject();
+
+			const auto& g = geometry[chunk.buffer];
+			if (chunk.vertexCount == 0 || chunk.indexCount == 0 ||
+				(uint64_t)chunk.baseVertex + chunk.vertexCount > g.vertices.size() ||
+				(uint64_t)chunk.startIndex + chunk.indexCount > g.indices.size())
+				return reject();
+
+			for (uint32_t i = 0; i < chunk.indexCount; i++)
+			{
+				if (g.indices[chunk.startIndex + i] >= chunk.vertexCount)
+					return reject();
+			}
+		}
+
+		return true;
+	}
+
+	void StaticBatcher::Save(const std::string& file, uint64_t sceneHash, const std::vector<Geometry>& geometry, const std::vector<Chunk>& chunks) const
+	{
+		std::ofstream out(file, std::ios::binary | std::ios::trunc);
+		if (!out) return;
+
+		BakeHeader header = { { 'G', 'A', 'S', 'B' }, s_bakeVersion, sceneHash, (uint32_t)geometry.size(), (uint32_t)chunks.size() };
+		out.write((const char*)&header, sizeof(header));
+
+		for (const auto& g : geometry)
+		{
+			uint32_t counts[2] = { (uint32_t)g.vertices.size(), (uint32_t)g.indices.size() };
+			out.write((const char*)counts, sizeof(counts));
+			out.write((const char*)g.vertices.data(), g.vertices.size() * sizeof(GA::Utils::Vertex));
+			out.write((const char*)g.indices.data(), g.indices.size() * sizeof(uint32_t));
+		}
+
+		out.write((const char*)chunks.data(), chunks.size() * sizeof(Chunk));
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Scene/System.h"
+#include "Scene/Components.h"
+#include "Utils/BasicMesh.h"
+#include "Utils/GeometryPool.h"
+
+namespace GA
+{
+	// Merges static meshes that share a material into world space vertex/index buffers at scene load.
+	// a material's geometry is split into chunks by a uniform grid so each chunk is one draw with its own bounds.
+	// the merged geometry is written to a bake file and loaded back on the next run while the scene stays the same.
+	// with a pool the chunks are suballocated from it, otherwise every material gets buffers of its own
+	class StaticBatcher : public System
+	{
+	public:
+		struct Stats
+		{
+			uint32_t sourceMeshes;
+			uint32_t chunks;
+			uint32_t buffers;
+			uint32_t vertices;
+			uint32_t indices;
+			bool fromBake;
+			float ms;
+		};
+
+		StaticBatcher(Scene* scene, GDX11::GDX11Context* context, GA::Utils::GeometryPool* pool = nullptr, float cellSize = 16.0f);
+
+		// replaces every mergeable static mesh with chunk entities. an empty bakeFile always merges and saves nothing
+		void Build(const std::string& bakeFile);
+
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		static constexpr uint32_t s_bakeVersion = 3;
+		static constexpr uint32_t s_maxBufferVertices = 1 << 20;
+
+		struct Source
+		{
+			entt::entity entity;
+			uint32_t group; // same material and shadow flags
+		};
+
+		struct Geometry
+		{
+			std::vector<GA::Utils::Vertex> vertices;
+			std::vector<uint32_t> indices;
+		};
+
+		// plain data, written to the bake file as is
+		struct Chunk
+		{
+			uint32_t buffer;
+			uint32_t baseVertex; // indices are relative to it
+			uint32_t vertexCount;
+			uint32_t startIndex;
+			uint32_t indexCount;
+			uint32_t source; // the material and shadow flags come from this source
+			DirectX::BoundingBox box;
+		};
+
+		// cpu copies of the source buffers, read back once each
+		using Readbacks = std::unordered_map<const GDX11::Buffer*, std::vector<uint8_t>>;
+		static const std::vector<uint8_t>& Readback(Readbacks& readbacks, const std::shared_ptr<GDX11::Buffer>& buffer);
+
+		// the hash covers the geometry the sources reference, not only its size
+		std::vector<Source> CollectSources(uint64_t& sceneHash, Readbacks& readbacks);
+		void Merge(const std::vector<Source>& sources, Readbacks& readbacks, std::vector<Geometry>& geometry, std::vector<Chunk>& chunks);
+		void Apply(const std::vector<Source>& sources, const std::vector<Geometry>& geometry, const std::vector<Chunk>& chunks);
+
+		// false if the file is missing, stale or doesn't hold valid chunks for sourceCount sources
+		bool Load(const std::string& file, uint64_t sceneHash, uint32_t sourceCount, std::vector<Geometry>& geometry, std::vector<Chunk>& chunks) const;
+		void Save(const std::string& file, uint64_t sceneHash, const std::vector<Geometry>& geometry, const std::vector<Chunk>& chunks) const;
+
+		GDX11::GDX11Context* m_context;
+		GA::Utils::GeometryPool* m_pool;
+		float m_cellSize;
+		Stats m_stats;
+	};
+}
@@ -0,0 +1,245 @@
+#include "GeometryPool.h"
+#include <algorithm>
+
+using namespace GDX11;
+
+namespace GA::Utils
+{
+	GeometryPool::FreeList::FreeList(uint32_t capacity)
+		: m_capacity(capacity), m_free(capacity)
+	{
+		if (capacity > 0)
+			m_blocks.emplace(0, capacity);
+	}
+
+	bool GeometryPool::FreeList::Allocate(uint32_t size, uint32_t& offset)
+	{
+		for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+		{
+			if (it->second < size) continue;
+
+			offset = it->first;
+			uint32_t remaining = it->second - size;
+			m_blocks.erase(it);
+			if (remaining > 0)
+				m_blocks.emplace(offset + size, remaining);
+
+			m_free -= size;
+			return true;
+		}
+
+		return false;
+	}
+
+	void GeometryPool::FreeList::Free(uint32_t offset, uint32_t size)
+	{
+		if (size == 0) return;
+
+		m_free += size;
+		auto next = m_blocks.lower_bound(offset);
+
+		// merge with the block right after
+		if (next != m_blocks.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = m_blocks.erase(next);
+		}
+
+		// and the one right before
+		if (next != m_blocks.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				prev->second += size;
+				return;
+			}
+		}
+
+		m_blocks.emplace_hint(next, offset, size);
+	}
+
+	void GeometryPool::FreeList::Reset(uint32_t used)
+	{
+		m_blocks.clear();
+		m_free = m_capacity - used;
+		if (m_free > 0)
+			m_blocks.emplace(used, m_free);
+	}
+
+	uint32_t GeometryPool::FreeList::GetLargest() const
+	{
+		uint32_t largest = 0;
+		for (const auto& [offset, size] : m_blocks)
+			largest = std::max(largest, size);
+		return largest;
+	}
+
+	GeometryPool::GeometryPool(GDX11Context* context, uint32_t vertexStride, uint32_t arenaVertices, uint32_t arenaIndices)
+		: m_context(context), m_vertexStride(vertexStride), m_arenaVertices(arenaVertices), m_arenaIndices(arenaIndices), m_arenas(), m_compactions(0)
+	{
+	}
+
+	std::shared_ptr<GeometryAllocation> GeometryPool::Allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+	{
+		GeometryAllocation allocation = {};
+
+		bool allocated = false;
+		for (uint32_t i = 0; i < (uint32_t)m_arenas.size() && !allocated; i++)
+			allocated = AllocateFrom(i, vertexCount, indexCount, allocation);
+
+		// there is room, just not in one piece
+		for (uint32_t i = 0; i < (uint32_t)m_arenas.size() && !allocated; i++)
+		{
+			auto& arena = m_arenas[i];
+			if (arena.vertices.GetFree() < vertexCount || arena.indices.GetFree() < indexCount)
+				continue;
+
+			CompactArena(arena);
+			allocated = AllocateFrom(i, vertexCount, indexCount, allocation);
+		}
+
+		if (!allocated)
+		{
+			CreateArena(std::max(m_arenaVertices, vertexCount), std::max(m_arenaIndices, indexCount));
+			allocated = AllocateFrom((uint32_t)m_arenas.size() - 1, vertexCount, indexCount, allocation);
+		}
+
+		GDX11_ASSERT(allocated, "Geometry pool allocation failed");
+
+		auto& arena = m_arenas[allocation.arena];
+
+		m_context->UpdateBuffer(arena.vb->GetNative(), allocation.baseVertex * m_vertexStride, vertexCount * m_vertexStride, vertices);
+		m_context->UpdateBuffer(arena.ib->GetNative(), allocation.startIndex * (uint32_t)sizeof(uint32_t), indexCount * (uint32_t)sizeof(uint32_t), indices);
+
+		auto* live = new GeometryAllocation(allocation);
+		arena.live.push_back(live);
+		return std::shared_ptr<GeometryAllocation>(live, [this](GeometryAllocation* allocation) { Free(allocation); delete allocation; });
+	}
+
+	void GeometryPool::Compact(float threshold)
+	{
+		for (auto& arena : m_arenas)
+		{
+			if (std::max(Fragmentation(arena.vertices), Fragmentation(arena.indices)) > threshold)
+				CompactArena(arena);
+		}
+	}
+
+	GeometryPool::Stats GeometryPool::GetStats() const
+	{
+		Stats stats = {};
+		stats.arenas = (uint32_t)m_arenas.size();
+		stats.compactions = m_compactions;
+		for (const auto& arena : m_arenas)
+		{
+			stats.allocations += (uint32_t)arena.live.size();
+			stats.usedVertices += arena.vertices.GetCapacity() - arena.vertices.GetFree();
+			stats.freeVertices += arena.vertices.GetFree();
+			stats.usedIndices += arena.indices.GetCapacity() - arena.indices.GetFree();
+			stats.freeIndices += arena.indices.GetFree();
+			stats.fragmentation = std::max({ stats.fragmentation, Fragmentation(arena.vertices), Fragmentation(arena.indices) });
+		}
+
+		return stats;
+	}
+
+	void GeometryPool::CreateArena(uint32_t vertexCapacity, uint32_t indexCapacity)
+	{
+		Arena arena;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = vertexCapacity * m_vertexStride;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = m_vertexStride;
+		arena.vb = Buffer::Create(m_context, desc, nullptr);
+
+		desc = {};
+		desc.ByteWidth = indexCapacity * sizeof(uint32_t);
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = sizeof(uint32_t);
+		arena.ib = Buffer::Create(m_context, desc, nullptr);
+
+		arena.vertices = FreeList(vertexCapacity);
+		arena.indices = FreeList(indexCapacity);
+		m_arenas.push_back(std::move(arena));
+	}
+
+	bool GeometryPool::AllocateFrom(uint32_t arena, uint32_t vertexCount, uint32_t indexCount, GeometryAllocation& allocation)
+	{
+		auto& a = m_arenas[arena];
+
+		uint32_t baseVertex;
+		if (!a.vertices.Allocate(vertexCount, baseVertex))
+			return false;
+
+		uint32_t startIndex;
+		if (!a.indices.Allocate(indexCount, startIndex))
+		{
+			a.vertices.Free(baseVertex, vertexCount);
+			return false;
+		}
+
+		allocation = { arena, baseVertex, vertexCount, startIndex, indexCount };
+		return true;
+	}
+
+	void GeometryPool::CompactArena(Arena& arena)
+	{
+		// a copy can't overlap itself inside one resource, the live ranges are packed into scratch buffers and copied back
+		auto scratchVB = Buffer::Create(m_context, arena.vb->GetDesc(), nullptr);
+		auto scratchIB = Buffer::Create(m_context, arena.ib->GetDesc(), nullptr);
+
+		std::sort(arena.live.begin(), arena.live.end(), [](const GeometryAllocation* a, const GeometryAllocation* b) { return a->baseVertex < b->baseVertex; });
+
+		uint32_t vertexEnd = 0;
+		uint32_t indexEnd = 0;
+		for (auto* allocation : arena.live)
+		{
+			if (allocation->vertexCount > 0)
+			{
+				D3D11_BOX box = { allocation->baseVertex * m_vertexStride, 0, 0, (allocation->baseVertex + allocation->vertexCount) * m_vertexStride, 1, 1 };
+				m_context->CopySubresourceRegion(scratchVB->GetNative(), 0, vertexEnd * m_vertexStride, 0, 0, arena.vb->GetNative(), 0, &box);
+			}
+
+			if (allocation->indexCount > 0)
+			{
+				D3D11_BOX box = { allocation->startIndex * (uint32_t)sizeof(uint32_t), 0, 0, (allocation->startIndex + allocation->indexCount) * (uint32_t)sizeof(uint32_t), 1, 1 };
+				m_context->CopySubresourceRegion(scratchIB->GetNative(), 0, indexEnd * (uint32_t)sizeof(uint32_t), 0, 0, arena.ib->GetNative(), 0, &box);
+			}
+
+			// indices are relative to the mesh, moving its vertices only moves baseVertex
+			allocation->baseVertex = vertexEnd;
+			allocation->startIndex = indexEnd;
+			vertexEnd += allocation->vertexCount;
+			indexEnd += allocation->indexCount;
+		}
+
+		m_context->CopyResource(arena.vb->GetNative(), scratchVB->GetNative());
+		m_context->CopyResource(arena.ib->GetNative(), scratchIB->GetNative());
+
+		arena.vertices.Reset(vertexEnd);
+		arena.indices.Reset(indexEnd);
+		++m_compactions;
+	}
+
+	void GeometryPool::Free(GeometryAllocation* allocation)
+	{
+		auto& arena = m_arenas[allocation->arena];
+		arena.vertices.Free(allocation->baseVertex, allocation->vertexCount);
+		arena.indices.Free(allocation->startIndex, allocation->indexCount);
+		arena.live.erase(std::find(arena.live.begin(), arena.live.end(), allocation));
+	}
+
+	float GeometryPool::Fragmentation(const FreeList& list)
+	{
+		if (list.GetFree() == 0) return 0.0f;
+		return 1.0f - (float)list.GetLargest() / (float)list.GetFree();
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <GDX11.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace GA::Utils
+{
+	// A range of a GeometryPool arena. the pool moves it when it compacts, so read the offsets at draw time
+	struct GeometryAllocation
+	{
+		uint32_t arena;
+		uint32_t baseVertex;
+		uint32_t vertexCount;
+		uint32_t startIndex;
+		uint32_t indexCount;
+	};
+
+	// Suballocates meshes of one vertex format from a few large vertex/index buffer arenas so their draws share one binding.
+	// indices stay relative to the mesh, draws add baseVertex. an allocation frees itself when its last reference goes away,
+	// the pool has to outlive them
+	class GeometryPool
+	{
+	public:
+		struct Stats
+		{
+			uint32_t arenas;
+			uint32_t allocations;
+			uint32_t usedVertices;
+			uint32_t freeVertices;
+			uint32_t usedIndices;
+			uint32_t freeIndices;
+			float fragmentation; // 1 - largest free block / free space, worst of vertices and indices
+			uint32_t compactions;
+		};
+
+		GeometryPool(GDX11::GDX11Context* context, uint32_t vertexStride, uint32_t arenaVertices = 1 << 16, uint32_t arenaIndices = 1 << 18);
+
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		std::shared_ptr<GeometryAllocation> Allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+		// moves the live ranges of every arena more fragmented than threshold to its front
+		void Compact(float threshold = 0.5f);
+
+		const std::shared_ptr<GDX11::Buffer>& GetVB(uint32_t arena) const { return m_arenas[arena].vb; }
+		const std::shared_ptr<GDX11::Buffer>& GetIB(uint32_t arena) const { return m_arenas[arena].ib; }
+
+		Stats GetStats() const;
+
+	private:
+		// first fit over free blocks keyed by offset, neighbours merge on free
+		class FreeList
+		{
+		public:
+			FreeList(uint32_t capacity = 0);
+
+			bool Allocate(uint32_t size, uint32_t& offset);
+			void Free(uint32_t offset, uint32_t size);
+			void Reset(uint32_t used);
+
+			uint32_t GetCapacity() const { return m_capacity; }
+			uint32_t GetFree() const { return m_free; }
+			uint32_t GetLargest() const;
+
+		private:
+			std::map<uint32_t, uint32_t> m_blocks;
+			uint32_t m_capacity;
+			uint32_t m_free;
+		};
+
+		struct Arena
+		{
+			std::shared_ptr<GDX11::Buffer> vb;
+			std::shared_ptr<GDX11::Buffer> ib;
+			FreeList vertices;
+			FreeList indices;
+			std::vector<GeometryAllocation*> live;
+		};
+
+		void CreateArena(uint32_t vertexCapacity, uint32_t indexCapacity);
+		bool AllocateFrom(uint32_t arena, uint32_t vertexCount, uint32_t indexCount, GeometryAllocation& allocation);
+		void CompactArena(Arena& arena);
+		void Free(GeometryAllocation* allocation);
+
+		static float Fragmentation(const FreeList& list);
+
+		GDX11::GDX11Context* m_context;
+		uint32_t m_vertexStride;
+		uint32_t m_arenaVertices;
+		uint32_t m_arenaIndices;
+		std::vector<Arena> m_arenas;
+		uint32_t m_compactions;
+	};
+}
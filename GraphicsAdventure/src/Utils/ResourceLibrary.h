@@ -1,5 +1,6 @@
 #pragma once
 #include <GDX11.h>
+#include <functional>
 
 namespace GA::Utils
 {
@@ -17,18 +18,31 @@ namespace GA::Utils
 	X(PixelShader) \
 	X(Texture2D) \
 	X(InputLayout) \
-	X(ShaderResourceView)
+	X(ShaderResourceView) \
+	X(PipelineState) \
+	X(ConstantRing)
 
 
+	// Named resources of a render graph. a resource is either added already created or declared with a factory that runs
+	// the first time it is asked for, so passes that never run never create what only they use
 	class ResourceLibrary
 	{
 	public:
+		template<typename T>
+		using Factory = std::function<std::shared_ptr<T>()>;
+
 		template<typename T>
 		void Add(const std::string& key, const std::shared_ptr<T>& res)
 		{
 			static_assert(false);
 		}
 
+		template<typename T>
+		void Declare(const std::string& key, const Factory<T>& factory)
+		{
+			static_assert(false);
+		}
+
 		template<typename T>
 		std::shared_ptr<T> Get(const std::string& key) const
 		{
@@ -41,12 +55,19 @@ namespace GA::Utils
 			static_assert(false);
 		}
 
+		// added or declared
 		template<typename T>
 		bool Exist(const std::string& key) const
 		{
 			static_assert(false);
 		}
 
+		template<typename T>
+		bool IsCreated(const std::string& key) const
+		{
+			static_assert(false);
+		}
+
 		template<typename T>
 		void Clear()
 		{
@@ -55,7 +76,7 @@ namespace GA::Utils
 
 		void ClearAll()
 		{
-#define X(e) m_##e.clear();
+#define X(e) m_##e.clear(); m_##e##Factories.clear();
 			LEAF_ELEMENTS
 #undef X
 		}
@@ -64,7 +85,7 @@ namespace GA::Utils
 	template<> \
 	void Add<GDX11::e>(const std::string& key, const std::shared_ptr<GDX11::e>& res) \
 	{ \
-		GDX11_ASSERT(m_##e.find(key) == m_##e.end(), "Storing Duplicate"); \
+		GDX11_ASSERT(m_##e.find(key) == m_##e.end() && m_##e##Factories.find(key) == m_##e##Factories.end(), "Storing Duplicate"); \
 		m_##e[key] = res; \
 	} 
 
@@ -73,12 +94,32 @@ namespace GA::Utils
 
 
 
+#define X(e) \
+	template<> \
+	void Declare<GDX11::e>(const std::string& key, const Factory<GDX11::e>& factory) \
+	{ \
+		GDX11_ASSERT(m_##e.find(key) == m_##e.end() && m_##e##Factories.find(key) == m_##e##Factories.end(), "Storing Duplicate"); \
+		m_##e##Factories[key] = factory; \
+	} 
+
+		LEAF_ELEMENTS
+#undef X
+
+
+
 #define X(e) \
 	template<> \
 	std::shared_ptr<GDX11::e> Get<GDX11::e>(const std::string& key) const \
 	{ \
-		GDX11_ASSERT(m_##e.find(key) != m_##e.end(), "Resource does not exists"); \
-		return m_##e.at(key); \
+		auto it = m_##e.find(key); \
+		if (it != m_##e.end()) return it->second; \
+		auto factory = m_##e##Factories.find(key); \
+		GDX11_ASSERT(factory != m_##e##Factories.end(), "Resource does not exists"); \
+		auto create = std::move(factory->second); \
+		m_##e##Factories.erase(factory); \
+		auto res = create(); \
+		m_##e[key] = res; \
+		return res; \
 	} 
 
 			LEAF_ELEMENTS
@@ -90,8 +131,9 @@ namespace GA::Utils
 	template<> \
 	void Remove<GDX11::e>(const std::string& key) \
 	{ \
-		GDX11_ASSERT(m_##e.find(key) != m_##e.end(), "Resource does not exists"); \
+		GDX11_ASSERT(m_##e.find(key) != m_##e.end() || m_##e##Factories.find(key) != m_##e##Factories.end(), "Resource does not exists"); \
 		m_##e.erase(key); \
+		m_##e##Factories.erase(key); \
 	}
 
 			LEAF_ELEMENTS
@@ -102,6 +144,18 @@ namespace GA::Utils
 #define X(e) \
 	template<> \
 	bool Exist<GDX11::e>(const std::string& key) const \
+	{ \
+		return m_##e.find(key) != m_##e.end() || m_##e##Factories.find(key) != m_##e##Factories.end(); \
+	}
+
+			LEAF_ELEMENTS
+#undef X
+
+
+
+#define X(e) \
+	template<> \
+	bool IsCreated<GDX11::e>(const std::string& key) const \
 	{ \
 		return m_##e.find(key) != m_##e.end(); \
 	}
@@ -116,13 +170,17 @@ namespace GA::Utils
 	void Clear<GDX11::e>() \
 	{ \
 		m_##e.clear(); \
+		m_##e##Factories.clear(); \
 	} 
 
 			LEAF_ELEMENTS
 #undef X
 
 	private:
-#define X(e) std::unordered_map<std::string, std::shared_ptr<GDX11::e>> m_##e;
+		// declared resources move from the factories to the created ones on first Get, which stays const for callers
+#define X(e) \
+	mutable std::unordered_map<std::string, std::shared_ptr<GDX11::e>> m_##e; \
+	mutable std::unordered_map<std::string, Factory<GDX11::e>> m_##e##Factories;
 		LEAF_ELEMENTS
 #undef X
 
@@ -16,11 +16,6 @@ namespace GA::Utils
 		float p0;
 	};
 
-	struct PhongVSEntityCBuf
-	{
-		DirectX::XMFLOAT4X4 transform;
-		DirectX::XMFLOAT4X4 normalMatrix;
-	};
 
 	struct PhongPSSystemCBuf
 	{
@@ -74,26 +69,39 @@ namespace GA::Utils
 		uint32_t p0;
 	};
 
-	struct PhongPSEntityCBuf
+	// instancing.hlsli
+	struct InstanceCBuf
 	{
-		struct Material
-		{
-			DirectX::XMFLOAT4 color;
-			DirectX::XMFLOAT2 tiling;
-			float shininess;
-			BOOL enableNormalMapping;
-			BOOL enableParallaxMapping;
-			float depthMapScale;
-			int p0;
-			int p1;
-		} mat;
+		uint32_t instanceOffset;
+		uint32_t p0;
+		uint32_t p1;
+		uint32_t p2;
+	};
 
-		BOOL receiveShadows;
-		float p2;
-		float p3;
-		float p4;
+	// material.hlsli MaterialCBuf
+	struct Material
+	{
+		DirectX::XMFLOAT4 color;
+		DirectX::XMFLOAT2 tiling;
+		float shininess;
+		BOOL enableNormalMapping;
+		BOOL enableParallaxMapping;
+		float depthMapScale;
+		int p0;
+		int p1;
 	};
 
+	// structured buffer element, tightly packed
+	struct EntityInstance
+	{
+		DirectX::XMFLOAT4X4 transform;
+		DirectX::XMFLOAT4X4 normalMatrix;
+		BOOL receiveShadows;
+		// TexturePool slices of the material's textures
+		uint32_t diffuseSlice;
+		uint32_t normalSlice;
+		uint32_t depthSlice;
+	};
 
 	struct CSMTestVSSystemCBuf
 	{
@@ -103,12 +111,6 @@ namespace GA::Utils
 		float p0;
 	};
 
-	struct CSMTestVSEntityCBuf
-	{
-		DirectX::XMFLOAT4X4 transform;
-		DirectX::XMFLOAT4X4 normalMatrix;
-	};
-
 	struct CSMTestPSSystemCBuf
 	{
 		struct DirectionalLight
@@ -122,24 +124,4 @@ namespace GA::Utils
 			DirectX::XMFLOAT4 cascadeFarZDist[s_numCascades]; // arranged from lowest to highest
 		} dirLight;
 	};
-
-	struct CSMTestPSEntityCBuf
-	{
-		struct
-		{
-			DirectX::XMFLOAT4 color;
-			DirectX::XMFLOAT2 tiling;
-			float shininess;
-			BOOL enableNormalMapping;
-			BOOL enableParallaxMapping;
-			float depthMapScale;
-			int p0;
-			int p1;
-		} mat;
-
-		BOOL receiveShadows;
-		float p2;
-		float p3;
-		float p4;
-	};
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "SharedResourceCache.h"
+#include <cstring>
+
+using namespace GDX11;
+
+namespace GA::Utils
+{
+	SharedResourceCache::SharedResourceCache(GDX11Context* context)
+		: m_context(context), m_stats()
+	{
+	}
+
+	std::shared_ptr<RasterizerState> SharedResourceCache::GetRasterizerState(const D3D11_RASTERIZER_DESC& desc)
+	{
+		return Find(m_rasterizerStates, ToKey(desc), [&]() { return RasterizerState::Create(m_context, desc); });
+	}
+
+	std::shared_ptr<BlendState> SharedResourceCache::GetBlendState(const D3D11_BLEND_DESC& desc)
+	{
+		// the per target descs end in a byte, copy field by field so the padding after it is zero
+		D3D11_BLEND_DESC key;
+		std::memset(&key, 0, sizeof(key));
+		key.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+		key.IndependentBlendEnable = desc.IndependentBlendEnable;
+		for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+		{
+			const auto& src = desc.RenderTarget[i];
+			auto& dst = key.RenderTarget[i];
+			dst.BlendEnable = src.BlendEnable;
+			dst.SrcBlend = src.SrcBlend;
+			dst.DestBlend = src.DestBlend;
+			dst.BlendOp = src.BlendOp;
+			dst.SrcBlendAlpha = src.SrcBlendAlpha;
+			dst.DestBlendAlpha = src.DestBlendAlpha;
+			dst.BlendOpAlpha = src.BlendOpAlpha;
+			dst.RenderTargetWriteMask = src.RenderTargetWriteMask;
+		}
+
+		return Find(m_blendStates, ToKey(key), [&]() { return BlendState::Create(m_context, desc); });
+	}
+
+	std::shared_ptr<DepthStencilState> SharedResourceCache::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc)
+	{
+		// same for the stencil masks
+		D3D11_DEPTH_STENCIL_DESC key;
+		std::memset(&key, 0, sizeof(key));
+		key.DepthEnable = desc.DepthEnable;
+		key.DepthWriteMask = desc.DepthWriteMask;
+		key.DepthFunc = desc.DepthFunc;
+		key.StencilEnable = desc.StencilEnable;
+		key.StencilReadMask = desc.StencilReadMask;
+		key.StencilWriteMask = desc.StencilWriteMask;
+		key.FrontFace = desc.FrontFace;
+		key.BackFace = desc.BackFace;
+
+		return Find(m_depthStencilStates, ToKey(key), [&]() { return DepthStencilState::Create(m_context, desc); });
+	}
+
+	std::shared_ptr<SamplerState> SharedResourceCache::GetSamplerState(const D3D11_SAMPLER_DESC& desc)
+	{
+		return Find(m_samplerStates, ToKey(desc), [&]() { return SamplerState::Create(m_context, desc); });
+	}
+
+	std::shared_ptr<VertexShader> SharedResourceCache::GetVertexShader(const std::string& csoFile)
+	{
+		return Find(m_vertexShaders, csoFile, [&]() { return VertexShader::Create(m_context, csoFile); });
+	}
+
+	std::shared_ptr<PixelShader> SharedResourceCache::GetPixelShader(const std::string& csoFile)
+	{
+		return Find(m_pixelShaders, csoFile, [&]() { return csoFile.empty() ? PixelShader::Create(m_context) : PixelShader::Create(m_context, csoFile); });
+	}
+
+	std::shared_ptr<GeometryShader> SharedResourceCache::GetGeometryShader(const std::string& csoFile)
+	{
+		return Find(m_geometryShaders, csoFile, [&]() { return csoFile.empty() ? GeometryShader::Create(m_context) : GeometryShader::Create(m_context, csoFile); });
+	}
+
+	std::shared_ptr<InputLayout> SharedResourceCache::GetInputLayout(const std::string& vsCsoFile)
+	{
+		return Find(m_inputLayouts, vsCsoFile, [&]() { return InputLayout::Create(m_context, GetVertexShader(vsCsoFile)); });
+	}
+
+	std::shared_ptr<Buffer> SharedResourceCache::GetStaticBuffer(const D3D11_BUFFER_DESC& desc, const void* data)
+	{
+		GDX11_ASSERT(data, "Static buffers are created with their contents");
+
+		std::string key = ToKey(desc);
+		key.append(reinterpret_cast<const char*>(data), desc.ByteWidth);
+		return Find(m_staticBuffers, key, [&]() { return Buffer::Create(m_context, desc, data); });
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <GDX11.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace GA::Utils
+{
+	// Immutable gpu objects shared by everything that renders with one context. states and samplers are keyed by the bytes of
+	// their desc, shaders and input layouts by cso file, static buffers by desc and contents, so asking twice for the same
+	// thing returns the object created the first time. the cache keeps what it created alive until it is destroyed and
+	// has to outlive its context's users. anything written after creation (cbufs, targets) doesn't belong here
+	class SharedResourceCache
+	{
+	public:
+		struct Stats
+		{
+			uint32_t objects;
+			uint32_t hits;   // requests that didn't create anything
+			uint32_t misses;
+		};
+
+		SharedResourceCache(GDX11::GDX11Context* context);
+
+		SharedResourceCache(const SharedResourceCache&) = delete;
+		SharedResourceCache& operator=(const SharedResourceCache&) = delete;
+
+		std::shared_ptr<GDX11::RasterizerState> GetRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+		std::shared_ptr<GDX11::BlendState> GetBlendState(const D3D11_BLEND_DESC& desc);
+		std::shared_ptr<GDX11::DepthStencilState> GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+		std::shared_ptr<GDX11::SamplerState> GetSamplerState(const D3D11_SAMPLER_DESC& desc);
+
+		std::shared_ptr<GDX11::VertexShader> GetVertexShader(const std::string& csoFile);
+		// an empty file is the null shader, binding it unbinds the stage
+		std::shared_ptr<GDX11::PixelShader> GetPixelShader(const std::string& csoFile);
+		std::shared_ptr<GDX11::GeometryShader> GetGeometryShader(const std::string& csoFile);
+		// reflected from the vertex shader of that file
+		std::shared_ptr<GDX11::InputLayout> GetInputLayout(const std::string& vsCsoFile);
+
+		// data is never written after creation, usually a vertex or index buffer
+		std::shared_ptr<GDX11::Buffer> GetStaticBuffer(const D3D11_BUFFER_DESC& desc, const void* data);
+
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		template<typename T, typename F>
+		std::shared_ptr<T> Find(std::unordered_map<std::string, std::shared_ptr<T>>& objects, const std::string& key, F&& create)
+		{
+			auto it = objects.find(key);
+			if (it != objects.end())
+			{
+				++m_stats.hits;
+				return it->second;
+			}
+
+			++m_stats.misses;
+			++m_stats.objects;
+			return objects.emplace(key, create()).first->second;
+		}
+
+		// the desc as a key, padding has to be zeroed first
+		template<typename T>
+		static std::string ToKey(const T& desc) { return std::string(reinterpret_cast<const char*>(&desc), sizeof(T)); }
+
+		GDX11::GDX11Context* m_context;
+
+		std::unordered_map<std::string, std::shared_ptr<GDX11::RasterizerState>> m_rasterizerStates;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::BlendState>> m_blendStates;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::DepthStencilState>> m_depthStencilStates;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::SamplerState>> m_samplerStates;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::VertexShader>> m_vertexShaders;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::PixelShader>> m_pixelShaders;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::GeometryShader>> m_geometryShaders;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::InputLayout>> m_inputLayouts;
+		std::unordered_map<std::string, std::shared_ptr<GDX11::Buffer>> m_staticBuffers;
+
+		Stats m_stats;
+	};
+}
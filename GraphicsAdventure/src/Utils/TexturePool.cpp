@@ -0,0 +1,168 @@
+#include "TexturePool.h"
+#include <algorithm>
+
+using namespace GDX11;
+
+namespace GA::Utils
+{
+	TexturePool::TexturePool(GDX11Context* context, uint32_t firstSlices, uint32_t maxSlices)
+		: m_context(context), m_firstSlices(std::max(firstSlices, 1u)), m_maxSlices(std::min(std::max(maxSlices, firstSlices), (uint32_t)D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)),
+		m_arrays(), m_sources(), m_grows(0)
+	{
+	}
+
+	TextureSlice TexturePool::Add(const std::shared_ptr<ShaderResourceView>& srv)
+	{
+		GDX11_ASSERT(srv && srv->GetTexture2D(), "Only 2D textures can be pooled");
+
+		auto it = m_sources.find(srv.get());
+		if (it != m_sources.end())
+		{
+			// same address but a different view, the old one is gone and its slice can go too
+			const auto& source = it->second.srv;
+			if (!source.owner_before(srv) && !srv.owner_before(source))
+				return it->second.slice;
+
+			m_arrays[it->second.slice.array].free.push_back(it->second.slice.slice);
+			m_sources.erase(it);
+		}
+
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		srv->GetTexture2D()->GetNative()->GetDesc(&texDesc);
+		GDX11_ASSERT(texDesc.ArraySize == 1 && texDesc.SampleDesc.Count == 1, "Only single slice, single sample textures can be pooled");
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srv->GetNative()->GetDesc(&srvDesc);
+
+		Format format = { texDesc.Width, texDesc.Height, texDesc.MipLevels, texDesc.Format, srvDesc.Format };
+		TextureSlice slice = {};
+		slice.array = FindArray(format);
+
+		auto& array = m_arrays[slice.array];
+		if (!array.free.empty())
+		{
+			slice.slice = array.free.back();
+			array.free.pop_back();
+		}
+		else
+		{
+			slice.slice = array.used++;
+		}
+
+		// every mip, the source generated them when its view was created
+		for (uint32_t mip = 0; mip < texDesc.MipLevels; mip++)
+		{
+			m_context->CopySubresource(array.texture->GetNative(), D3D11CalcSubresource(mip, slice.slice, texDesc.MipLevels),
+				srv->GetTexture2D()->GetNative(), D3D11CalcSubresource(mip, 0, texDesc.MipLevels));
+		}
+
+		m_sources.emplace(srv.get(), Source{ srv, slice });
+		return slice;
+	}
+
+	TexturePool::Stats TexturePool::GetStats() const
+	{
+		Stats stats = {};
+		stats.arrays = (uint32_t)m_arrays.size();
+		stats.textures = (uint32_t)m_sources.size();
+		for (const auto& array : m_arrays)
+			stats.slices += array.capacity;
+		stats.grows = m_grows;
+		return stats;
+	}
+
+	uint32_t TexturePool::FindArray(const Format& format)
+	{
+		auto hasRoom = [](const Array& array) { return !array.free.empty() || array.used < array.capacity; };
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (uint32_t i = 0; i < (uint32_t)m_arrays.size(); i++)
+			{
+				if (m_arrays[i].format == format && hasRoom(m_arrays[i]))
+					return i;
+			}
+
+			// full, see if anything was unloaded before growing
+			if (pass == 0)
+				ReleaseExpired();
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)m_arrays.size(); i++)
+		{
+			auto& array = m_arrays[i];
+			if (array.format == format && array.capacity < m_maxSlices)
+			{
+				Grow(array, std::min(array.capacity * 2, m_maxSlices));
+				return i;
+			}
+		}
+
+		Array array = {};
+		array.format = format;
+		m_arrays.push_back(std::move(array));
+		Grow(m_arrays.back(), m_firstSlices);
+		return (uint32_t)m_arrays.size() - 1;
+	}
+
+	void TexturePool::Grow(Array& array, uint32_t capacity)
+	{
+		const auto& [width, height, mipLevels, texFormat, srvFormat] = array.format;
+
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = width;
+		texDesc.Height = height;
+		texDesc.MipLevels = mipLevels;
+		texDesc.ArraySize = capacity;
+		texDesc.Format = texFormat;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = 0;
+		auto texture = Texture2D::Create(m_context, texDesc, (void*)nullptr);
+
+		// slices handed out so far keep their index
+		if (array.texture)
+		{
+			for (uint32_t slice = 0; slice < array.used; slice++)
+			{
+				for (uint32_t mip = 0; mip < mipLevels; mip++)
+				{
+					m_context->CopySubresource(texture->GetNative(), D3D11CalcSubresource(mip, slice, mipLevels),
+						array.texture->GetNative(), D3D11CalcSubresource(mip, slice, mipLevels));
+				}
+			}
+			++m_grows;
+		}
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = srvFormat;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = mipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = capacity;
+
+		array.texture = texture;
+		array.srv = ShaderResourceView::Create(m_context, srvDesc, texture);
+		array.capacity = capacity;
+	}
+
+	void TexturePool::ReleaseExpired()
+	{
+		for (auto it = m_sources.begin(); it != m_sources.end();)
+		{
+			if (it->second.srv.expired())
+			{
+				m_arrays[it->second.slice.array].free.push_back(it->second.slice.slice);
+				it = m_sources.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+}
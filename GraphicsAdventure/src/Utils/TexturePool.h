@@ -0,0 +1,74 @@
+#pragma once
+#include <GDX11.h>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace GA::Utils
+{
+	// Where a pooled texture lives, the slice of one of the pool's arrays
+	struct TextureSlice
+	{
+		uint32_t array;
+		uint32_t slice;
+	};
+
+	// Copies 2D textures into Texture2DArrays shared by every texture of the same size, format and mip count, so materials
+	// that only differ by texture bind the same view and pick their slice per instance. an array grows by doubling until
+	// maxSlices, then another array of that format is started. a slice is reused once its source texture is gone
+	class TexturePool
+	{
+	public:
+		struct Stats
+		{
+			uint32_t arrays;
+			uint32_t textures;
+			uint32_t slices; // allocated, used or not
+			uint32_t grows;
+		};
+
+		TexturePool(GDX11::GDX11Context* context, uint32_t firstSlices = 4, uint32_t maxSlices = 64);
+
+		TexturePool(const TexturePool&) = delete;
+		TexturePool& operator=(const TexturePool&) = delete;
+
+		// the same source always maps to the same slice, the first call copies it in
+		TextureSlice Add(const std::shared_ptr<GDX11::ShaderResourceView>& srv);
+
+		const std::shared_ptr<GDX11::ShaderResourceView>& GetSRV(uint32_t array) const { return m_arrays[array].srv; }
+
+		Stats GetStats() const;
+
+	private:
+		// width, height, mip levels, texture format, view format
+		using Format = std::tuple<uint32_t, uint32_t, uint32_t, DXGI_FORMAT, DXGI_FORMAT>;
+
+		struct Array
+		{
+			Format format;
+			std::shared_ptr<GDX11::Texture2D> texture;
+			std::shared_ptr<GDX11::ShaderResourceView> srv;
+			uint32_t capacity;
+			uint32_t used; // slices below it were handed out at some point
+			std::vector<uint32_t> free;
+		};
+
+		struct Source
+		{
+			std::weak_ptr<GDX11::ShaderResourceView> srv;
+			TextureSlice slice;
+		};
+
+		uint32_t FindArray(const Format& format);
+		void Grow(Array& array, uint32_t capacity);
+		void ReleaseExpired();
+
+		GDX11::GDX11Context* m_context;
+		uint32_t m_firstSlices;
+		uint32_t m_maxSlices;
+		std::vector<Array> m_arrays;
+		std::unordered_map<const GDX11::ShaderResourceView*, Source> m_sources;
+		uint32_t m_grows;
+	};
+}